@@ -9,7 +9,7 @@ set link=-lshlwapi
 set bin=.
 set includes=
 
-set compiles=wgknife.c common.c
+set compiles=wgknife.c knife.c bank.c common.c pool.c decode.c nameidx.c synth.c midifile.c wgenc.c outbuf.c hash.c resample.c flac.c manifest.c aio.c pcmcache.c mixer.c
 set outname=wgknife.exe
 del %bin%\%outname%
 
@@ -21,6 +21,47 @@ IF %ERRORLEVEL% NEQ 0 (
 )
 popd
 
+set compiles=bench.c knife.c bank.c common.c pool.c decode.c nameidx.c synth.c midifile.c wgenc.c outbuf.c hash.c resample.c flac.c manifest.c aio.c pcmcache.c mixer.c
+set outname=wgbench.exe
+del %bin%\%outname%
+
+pushd src
+gcc -o ..\%bin%\%outname% %includes% %compiles% %opts% %link% 2>> ..\compile.log
+IF %ERRORLEVEL% NEQ 0 (
+    echo oops %outname%!
+    pause
+)
+popd
+
+::mutation fuzzer for libwgbank, see top of fuzz.c for the libFuzzer build
+set compiles=fuzz.c bank.c decode.c common.c
+set outname=wgfuzz.exe
+del %bin%\%outname%
+
+pushd src
+gcc -o ..\%bin%\%outname% %includes% %compiles% %opts% %link% 2>> ..\compile.log
+IF %ERRORLEVEL% NEQ 0 (
+    echo oops %outname%!
+    pause
+)
+popd
+
+::libwgbank, bank access and decoder for other programs
+set libcompiles=bank.c decode.c
+del %bin%\libwgbank.a %bin%\wgbank.dll %bin%\libwgbank.dll.a
+
+pushd src
+gcc -c %includes% %libcompiles% %opts% 2>> ..\compile.log
+ar rcs ..\%bin%\libwgbank.a bank.o decode.o
+gcc -shared -o ..\%bin%\wgbank.dll %includes% %libcompiles% %opts% -Wl,--out-implib,..\%bin%\libwgbank.dll.a 2>> ..\compile.log
+IF %ERRORLEVEL% NEQ 0 (
+    echo oops wgbank.dll!
+    pause
+)
+del bank.o decode.o
+popd
+
 wgknife.exe -sd WINGROOV.TPD
 wgknife.exe -sfz WINGROOV.TPD
-wgknife.exe -d WINGROOV.TPD > A5.txt
\ No newline at end of file
+wgknife.exe -d WINGROOV.TPD > A5.txt
+::wgbench.exe WINGROOV.TPD > bench.csv
\ No newline at end of file
@@ -0,0 +1,368 @@
+#if defined(__linux__)
+#define _GNU_SOURCE
+#define AIO_URING
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "aio.h"
+
+#ifdef AIO_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+#define AIO_PATH  (1024)
+#define AIO_BATCH (8)     //files queued before entering the ring
+
+static int writeWhole(const char* name, const wg_IoVec* vec, int num) {
+    int fd = fileCreate(name);
+    int isOk;
+    
+    if (fd < 0) return 0;
+    isOk = fileWriteVec(fd, vec, num);
+    return fileClose(fd) && isOk;
+}
+
+#ifdef AIO_URING
+
+enum AIO_STEP {
+    STEP_OPEN,
+    STEP_WRITE,
+    STEP_CLOSE,
+    NUM_STEPS
+};
+
+typedef struct {
+    wg_AioDone   done;
+    void*        arg;
+    wg_IoVec     vec[AIO_MAX_VECS];
+    struct iovec iov[AIO_MAX_VECS];
+    int          num;
+    size_t       total;
+    int          left;   //completions still to come
+    int          isOk;
+    char         name[AIO_PATH];
+} AioFile;
+
+struct wg_Aio {
+    int             isAsync;    //new files go to ring, ring can still be draining when 0
+    pthread_mutex_t lock;
+    int             ringFd;
+    unsigned int    depth;
+    AioFile*        files;      //slot i writes through direct descriptor i
+    unsigned int*   freeSlots;
+    unsigned int    numFree;
+    unsigned int    numQueued;  //entries kernel hasn't taken yet
+    
+    void*    sqRing;
+    void*    cqRing;
+    size_t   sqRingLen, cqRingLen, sqesLen;
+    unsigned *sqTail, *sqMask, *sqArray;
+    unsigned *cqHead, *cqTail, *cqMask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+};
+
+static int ringInit(wg_Aio* aio) {
+    struct io_uring_params p;
+    int* fds;
+    int res;
+    
+    memset(&p, 0, sizeof(p));
+    aio->ringFd = syscall(__NR_io_uring_setup, aio->depth * NUM_STEPS, &p);
+    if (aio->ringFd < 0) return 0;
+    
+    aio->sqRingLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    aio->cqRingLen = p.cq_off.cqes  + p.cq_entries * sizeof(struct io_uring_cqe);
+    aio->sqesLen   = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (aio->cqRingLen > aio->sqRingLen) aio->sqRingLen = aio->cqRingLen;
+        aio->cqRingLen = 0;
+    }
+    aio->sqRing = mmap(NULL, aio->sqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, aio->ringFd, IORING_OFF_SQ_RING);
+    if (aio->sqRing == MAP_FAILED) goto BAD;
+    aio->cqRing = aio->sqRing;
+    if (aio->cqRingLen) {
+        aio->cqRing = mmap(NULL, aio->cqRingLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, aio->ringFd, IORING_OFF_CQ_RING);
+        if (aio->cqRing == MAP_FAILED) goto BAD;
+    }
+    aio->sqes = mmap(NULL, aio->sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, aio->ringFd, IORING_OFF_SQES);
+    if (aio->sqes == MAP_FAILED) goto BAD;
+    
+    aio->sqTail  = (unsigned*)((char*)aio->sqRing + p.sq_off.tail);
+    aio->sqMask  = (unsigned*)((char*)aio->sqRing + p.sq_off.ring_mask);
+    aio->sqArray = (unsigned*)((char*)aio->sqRing + p.sq_off.array);
+    aio->cqHead  = (unsigned*)((char*)aio->cqRing + p.cq_off.head);
+    aio->cqTail  = (unsigned*)((char*)aio->cqRing + p.cq_off.tail);
+    aio->cqMask  = (unsigned*)((char*)aio->cqRing + p.cq_off.ring_mask);
+    aio->cqes    = (struct io_uring_cqe*)((char*)aio->cqRing + p.cq_off.cqes);
+    
+    //empty direct descriptor table, opens fill it in
+    if (!(fds = malloc(aio->depth * sizeof(int)))) goto BAD;
+    for (unsigned int i=0; i < aio->depth; i++) fds[i] = -1;
+    res = syscall(__NR_io_uring_register, aio->ringFd, IORING_REGISTER_FILES, fds, aio->depth);
+    free(fds);
+    if (res < 0) goto BAD;
+    return 1;
+    BAD:
+        return 0;
+}
+
+static void ringFree(wg_Aio* aio) {
+    if (aio->sqes && aio->sqes != MAP_FAILED) munmap(aio->sqes, aio->sqesLen);
+    if (aio->cqRingLen && aio->cqRing && aio->cqRing != MAP_FAILED) munmap(aio->cqRing, aio->cqRingLen);
+    if (aio->sqRing && aio->sqRing != MAP_FAILED) munmap(aio->sqRing, aio->sqRingLen);
+    if (aio->ringFd >= 0) close(aio->ringFd);
+    aio->ringFd = -1;
+    aio->sqes   = NULL;
+    aio->sqRing = aio->cqRing = NULL;
+}
+
+//lock held
+static struct io_uring_sqe* nextSqe(wg_Aio* aio, unsigned int slot, int step) {
+    unsigned tail = *aio->sqTail;
+    unsigned idx  = tail & *aio->sqMask;
+    struct io_uring_sqe* sqe = &aio->sqes[idx];
+    
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uint64_t)slot * NUM_STEPS + step;
+    aio->sqArray[idx] = idx;
+    __atomic_store_n(aio->sqTail, tail + 1, __ATOMIC_RELEASE);
+    aio->numQueued++;
+    return sqe;
+}
+
+//open into direct descriptor, write hardlinked to close so the slot always gets freed
+static void queueFile(wg_Aio* aio, unsigned int slot) {
+    AioFile* f = &aio->files[slot];
+    struct io_uring_sqe* sqe;
+    
+    sqe = nextSqe(aio, slot, STEP_OPEN);
+    sqe->opcode     = IORING_OP_OPENAT;
+    sqe->fd         = AT_FDCWD;
+    sqe->addr       = (uintptr_t)f->name;
+    sqe->len        = 0666;
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    sqe->file_index = slot + 1;
+    sqe->flags      = IOSQE_IO_LINK;
+    
+    sqe = nextSqe(aio, slot, STEP_WRITE);
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd     = slot;
+    sqe->addr   = (uintptr_t)f->iov;
+    sqe->len    = f->num;
+    sqe->off    = 0;
+    sqe->flags  = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    
+    sqe = nextSqe(aio, slot, STEP_CLOSE);
+    sqe->opcode     = IORING_OP_CLOSE;
+    sqe->file_index = slot + 1;
+}
+
+//lock held
+static void finishFile(wg_Aio* aio, unsigned int slot) {
+    AioFile* f = &aio->files[slot];
+    
+    if (!f->isOk) f->isOk = writeWhole(f->name, f->vec, f->num);
+    f->done(f->arg, f->isOk);
+    aio->freeSlots[aio->numFree++] = slot;
+}
+
+//lock held
+static void reap(wg_Aio* aio) {
+    unsigned head = *aio->cqHead;
+    unsigned tail = __atomic_load_n(aio->cqTail, __ATOMIC_ACQUIRE);
+    
+    for (; head != tail; head++) {
+        struct io_uring_cqe* cqe = &aio->cqes[head & *aio->cqMask];
+        unsigned int slot = cqe->user_data / NUM_STEPS;
+        int step = cqe->user_data % NUM_STEPS;
+        AioFile* f = &aio->files[slot];
+        
+        //short write counts as failed too
+        if (cqe->res < 0 || (step == STEP_WRITE && (size_t)cqe->res != f->total)) f->isOk = 0;
+        //kernel older than direct descriptor opens, rest goes direct
+        if (step == STEP_OPEN && cqe->res == -EINVAL) aio->isAsync = 0;
+        if (!--f->left) finishFile(aio, slot);
+    }
+    __atomic_store_n(aio->cqHead, head, __ATOMIC_RELEASE);
+}
+
+//submits queued entries, waits for minComplete completions, lock held
+//ring that errors out for good is dropped, unfinished files then get blocking writes
+static void enterRing(wg_Aio* aio, unsigned int minComplete) {
+    for (;;) {
+        int res = syscall(__NR_io_uring_enter, aio->ringFd, aio->numQueued, minComplete,
+                          minComplete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        
+        if (res >= 0) {
+            aio->numQueued -= res;
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EBUSY) {
+            reap(aio);
+            continue;
+        }
+        break;
+    }
+    
+    printf("aio: io_uring failed, writing the rest directly.\n");
+    ringFree(aio);
+    aio->isAsync   = 0;
+    aio->numQueued = 0;
+    for (unsigned int i=0; i < aio->depth; i++) {
+        if (aio->files[i].left) {
+            aio->files[i].left = 0;
+            aio->files[i].isOk = 0;
+            finishFile(aio, i);
+        }
+    }
+}
+
+static void waitAll(wg_Aio* aio) {
+    pthread_mutex_lock(&aio->lock);
+    while (aio->ringFd >= 0 && aio->numFree < aio->depth) {
+        enterRing(aio, 1);
+        if (aio->ringFd >= 0) reap(aio);
+    }
+    pthread_mutex_unlock(&aio->lock);
+}
+
+wg_Aio* aioCreate(unsigned int depth, int isSync) {
+    wg_Aio* aio;
+    
+    if (!(aio = calloc(1, sizeof(wg_Aio)))) goto OOM;
+    aio->ringFd = -1;
+    pthread_mutex_init(&aio->lock, NULL);
+    if (isSync || !depth) return aio;
+    
+    aio->depth = depth;
+    if (!(aio->files     = calloc(depth, sizeof(AioFile)))) goto OOM;
+    if (!(aio->freeSlots = malloc(depth * sizeof(unsigned int)))) goto OOM;
+    for (unsigned int i=0; i < depth; i++) aio->freeSlots[i] = depth-1 - i;
+    aio->numFree = depth;
+    //no io_uring, or not allowed to use it
+    if (!ringInit(aio)) {
+        ringFree(aio);
+        return aio;
+    }
+    aio->isAsync = 1;
+    return aio;
+    OOM:
+        printf("aioCreate(): Out of memory!\n");
+        aioDestroy(aio);
+        return NULL;
+}
+
+int aioIsAsync(wg_Aio* aio) {
+    int isAsync;
+    
+    pthread_mutex_lock(&aio->lock);
+    isAsync = aio->isAsync;
+    pthread_mutex_unlock(&aio->lock);
+    return isAsync;
+}
+
+void aioWriteFile(wg_Aio* aio, const char* name, const wg_IoVec* vec, int num, wg_AioDone done, void* arg) {
+    unsigned int slot;
+    AioFile* f;
+    
+    if (num > AIO_MAX_VECS || strlen(name) >= AIO_PATH) goto DIRECT;
+    
+    pthread_mutex_lock(&aio->lock);
+    while (aio->isAsync && !aio->numFree) {
+        enterRing(aio, 1);
+        if (aio->ringFd >= 0) reap(aio);
+    }
+    if (!aio->isAsync) {
+        pthread_mutex_unlock(&aio->lock);
+        goto DIRECT;
+    }
+    
+    slot = aio->freeSlots[--aio->numFree];
+    f = &aio->files[slot];
+    f->done  = done;
+    f->arg   = arg;
+    f->num   = num;
+    f->total = 0;
+    f->left  = NUM_STEPS;
+    f->isOk  = 1;
+    strcpy(f->name, name);
+    for (int i=0; i < num; i++) {
+        f->vec[i] = vec[i];
+        f->iov[i].iov_base = (void*)vec[i].buf;
+        f->iov[i].iov_len  = vec[i].len;
+        f->total += vec[i].len;
+    }
+    queueFile(aio, slot);
+    
+    if (aio->numQueued >= AIO_BATCH * NUM_STEPS) enterRing(aio, 0);
+    if (aio->ringFd >= 0) reap(aio);
+    pthread_mutex_unlock(&aio->lock);
+    return;
+    
+    DIRECT:
+        done(arg, writeWhole(name, vec, num));
+}
+
+void aioWait(wg_Aio* aio) {
+    waitAll(aio);
+}
+
+void aioDestroy(wg_Aio* aio) {
+    if (!aio) return;
+    
+    waitAll(aio);
+    ringFree(aio);
+    pthread_mutex_destroy(&aio->lock);
+    free(aio->files);
+    free(aio->freeSlots);
+    free(aio);
+}
+
+#else
+
+//no io_uring here, everything goes through the pool like before
+struct wg_Aio {
+    int isAsync;
+};
+
+wg_Aio* aioCreate(unsigned int depth, int isSync) {
+    wg_Aio* aio = calloc(1, sizeof(wg_Aio));
+    
+    (void)depth;
+    (void)isSync;
+    if (!aio) printf("aioCreate(): Out of memory!\n");
+    return aio;
+}
+
+int aioIsAsync(wg_Aio* aio) {
+    return aio->isAsync;
+}
+
+void aioWriteFile(wg_Aio* aio, const char* name, const wg_IoVec* vec, int num, wg_AioDone done, void* arg) {
+    (void)aio;
+    done(arg, writeWhole(name, vec, num));
+}
+
+void aioWait(wg_Aio* aio) {
+    (void)aio;
+}
+
+void aioDestroy(wg_Aio* aio) {
+    free(aio);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef AIO_H
+#define AIO_H
+
+#include "common.h"
+
+//whole files written with many of them in flight, for exports of lots of small files
+//Linux: io_uring, open, write and close of a file are one linked chain on a direct descriptor,
+//chains are queued up and handed to the kernel in batches, callers only block when the ring is full
+//elsewhere, or if the kernel says no: not async, callers keep writing from their pool tasks
+//a chain that fails is redone with blocking writes, so results never depend on the backend
+
+#define AIO_MAX_VECS (4)   //per file
+
+typedef struct wg_Aio wg_Aio;
+//file written or failed to, runs on whichever thread noticed, don't call aio from it
+typedef void (*wg_AioDone)(void* arg, int isOk);
+
+//depth is files in flight, isSync skips io_uring
+wg_Aio* aioCreate(unsigned int depth, int isSync);
+//0 means aioWriteFile() would only do blocking writes
+int aioIsAsync(wg_Aio* aio);
+//buffers of vec must stay as they are until done is called, vec itself and name are copied
+//safe from several threads at once
+void aioWriteFile(wg_Aio* aio, const char* name, const wg_IoVec* vec, int num, wg_AioDone done, void* arg);
+//every file handed over so far is done
+void aioWait(wg_Aio* aio);
+//waits first
+void aioDestroy(wg_Aio* aio);
+
+#endif
@@ -0,0 +1,210 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "bank.h"
+
+int bankOpen(wg_Bank* bank, void* base, size_t len) {
+    return bankOpenPart(bank, base, len, len);
+}
+
+int bankOpenPart(wg_Bank* bank, void* base, size_t len, size_t fileLen) {
+    bank->base    = base;
+    bank->len     = len;
+    bank->fileLen = fileLen < len ? len : fileLen;
+    bankValidate(bank);
+    return bankIsIn(bank, MIDIMAP_OFF, sizeof(wg_PatchMap));
+}
+
+int bankIsIn(const wg_Bank* bank, uint64_t off, uint64_t size) {
+    return off <= bank->len && size <= bank->len - off;
+}
+
+//-----------------------------------------------
+//VALIDATION
+
+//data has to end by limit
+static int isSampleOk(const wg_SampleHdr* smpHdr, size_t limit) {
+    const wg_SampleHdr* p = smpHdr;
+    
+    if (p->offEnd < p->offStart || p->offEnd > limit) return 0;
+    return !p->offLoop || (p->offLoop >= p->offStart && p->offLoop <= p->offEnd);
+}
+
+static int bankFail(wg_Bank* bank, const char* err, uint64_t off) {
+    bank->err    = err;
+    bank->errOff = off;
+    return 0;
+}
+
+int bankValidate(wg_Bank* bank) {
+    const wg_PatchMap* midiMap;
+    
+    bank->isValid = 0;
+    bank->err     = NULL;
+    bank->errOff  = 0;
+    if (!bankIsIn(bank, MIDIMAP_OFF, sizeof(wg_PatchMap))) return bankFail(bank, "PatchMap", 0);
+    midiMap = (const wg_PatchMap*)(bank->base + MIDIMAP_OFF);
+    
+    //dummies and patches shared by several slots get checked again, still only a few KB
+    for (unsigned int i=0; i < 256; i++) {
+        uint64_t off = midiMap->t[i];
+        const wg_Patch* patch;
+        const wg_Split* spBase;
+        
+        if (!bankIsIn(bank, off, sizeof(wg_Patch))) return bankFail(bank, "patch", MIDIMAP_OFF + i*4);
+        patch = (const wg_Patch*)(bank->base + off);
+        off  += sizeof(wg_Patch);
+        if (patch->isDrumKit) {
+            if (!bankIsIn(bank, off, sizeof(wg_DrumTable))) return bankFail(bank, "drum table", off);
+            off += sizeof(wg_DrumTable);
+        }
+        if (!bankIsIn(bank, off, (uint64_t)patch->splitNum * sizeof(wg_Split))) return bankFail(bank, "splits", off);
+        spBase = (const wg_Split*)(bank->base + off);
+        
+        for (unsigned int j=0; j < patch->splitNum; j++) {
+            uint32_t hdrOff = spBase[j].smpHeadOff;
+            
+            if (!bankIsIn(bank, hdrOff, sizeof(wg_SampleHdr))) return bankFail(bank, "sample header", off + j*sizeof(wg_Split));
+            if (!isSampleOk((const wg_SampleHdr*)(bank->base + hdrOff), bank->fileLen)) return bankFail(bank, "sample data", hdrOff);
+        }
+    }
+    
+    bank->isValid = 1;
+    return 1;
+}
+
+size_t bankStructLen(const wg_Bank* bank) {
+    const wg_PatchMap* midiMap;
+    uint64_t end = MIDIMAP_OFF + sizeof(wg_PatchMap);
+    
+    if (!bankIsIn(bank, 0, end)) return end;
+    midiMap = (const wg_PatchMap*)(bank->base + MIDIMAP_OFF);
+    
+    for (unsigned int i=0; i < 256; i++) {
+        uint64_t off = midiMap->t[i], splitEnd;
+        const wg_Patch* patch;
+        const wg_Split* spBase;
+        
+        //broken, reading more won't fix it
+        if (off + sizeof(wg_Patch) > bank->fileLen) continue;
+        if (off + sizeof(wg_Patch) > end) end = off + sizeof(wg_Patch);
+        if (!bankIsIn(bank, off, sizeof(wg_Patch))) continue;
+        
+        patch    = (const wg_Patch*)(bank->base + off);
+        off     += sizeof(wg_Patch) + (patch->isDrumKit ? sizeof(wg_DrumTable) : 0);
+        splitEnd = off + (uint64_t)patch->splitNum * sizeof(wg_Split);
+        if (splitEnd > bank->fileLen) continue;
+        if (splitEnd > end) end = splitEnd;
+        if (splitEnd > bank->len) continue;
+        
+        spBase = (const wg_Split*)(bank->base + off);
+        for (unsigned int j=0; j < patch->splitNum; j++) {
+            uint64_t hdrEnd = (uint64_t)spBase[j].smpHeadOff + sizeof(wg_SampleHdr);
+            
+            if (hdrEnd <= bank->fileLen && hdrEnd > end) end = hdrEnd;
+        }
+    }
+    return end;
+}
+
+//-----------------------------------------------
+//ACCESS
+
+wg_Patch* bankPatch(const wg_Bank* bank, unsigned int idx) {
+    uint32_t off;
+    
+    if (idx > 255) return NULL;
+    off = ((wg_PatchMap*)(bank->base + MIDIMAP_OFF))->t[idx];
+    if (!bank->isValid && !bankIsIn(bank, off, sizeof(wg_Patch))) return NULL;
+    return (wg_Patch*)(bank->base + off);
+}
+
+wg_DrumTable* bankDrums(const wg_Bank* bank, const wg_Patch* patch) {
+    uint64_t off = (uint8_t*)patch - bank->base + sizeof(wg_Patch);
+    
+    if (!patch->isDrumKit) return NULL;
+    if (!bank->isValid && !bankIsIn(bank, off, sizeof(wg_DrumTable))) return NULL;
+    return (wg_DrumTable*)(bank->base + off);
+}
+
+wg_Split* bankSplits(const wg_Bank* bank, const wg_Patch* patch) {
+    uint64_t off = (uint8_t*)patch - bank->base + sizeof(wg_Patch) + (patch->isDrumKit ? sizeof(wg_DrumTable) : 0);
+    
+    if (!bank->isValid && !bankIsIn(bank, off, (uint64_t)patch->splitNum * sizeof(wg_Split))) return NULL;
+    return (wg_Split*)(bank->base + off);
+}
+
+//offset may come from anywhere, so this one always checks
+wg_SampleHdr* bankSampleHdr(const wg_Bank* bank, uint32_t off) {
+    return bankIsIn(bank, off, sizeof(wg_SampleHdr)) ? (wg_SampleHdr*)(bank->base + off) : NULL;
+}
+
+uint8_t* bankSampleData(const wg_Bank* bank, const wg_SampleHdr* smpHdr, size_t* len) {
+    if (!isSampleOk(smpHdr, bank->len)) return NULL;
+    *len = smpHdr->offEnd - smpHdr->offStart;
+    return bank->base + smpHdr->offStart;
+}
+
+size_t bankDataOff(const wg_Bank* bank) {
+    wg_BankIter it;
+    size_t dataOff = bank->len;
+    
+    bankIterInit(&it, bank, WG_ITER_DUMMIES);
+    while (bankNextPatch(&it)) {
+        while (bankNextSplit(&it)) {
+            if (it.smpHdr && it.smpHdr->offStart && it.smpHdr->offStart < dataOff) dataOff = it.smpHdr->offStart;
+        }
+    }
+    
+    return dataOff;
+}
+
+//-----------------------------------------------
+//ITERATOR
+
+void bankIterInit(wg_BankIter* it, const wg_Bank* bank, int flags) {
+    memset(it, 0, sizeof(wg_BankIter));
+    it->bank  = bank;
+    it->flags = flags;
+}
+
+int bankNextPatch(wg_BankIter* it) {
+    const wg_Bank* bank = it->bank;
+    
+    it->split  = NULL;
+    it->smpHdr = NULL;
+    while (it->nextPatch < 256) {
+        unsigned int idx = it->nextPatch++;
+        wg_Patch* patch = bankPatch(bank, idx);
+        
+        if (!patch || (!patch->volume && !(it->flags & WG_ITER_DUMMIES))) continue;
+        if (patch->isDrumKit && !bankDrums(bank, patch)) continue;
+        it->patchIdx  = idx;
+        it->patchOff  = (uint8_t*)patch - bank->base;
+        it->patch     = patch;
+        it->drums     = bankDrums(bank, patch);
+        it->splits    = bankSplits(bank, patch);
+        //splits that don't fit make patch look empty
+        it->nextSplit = it->splits ? 0 : patch->splitNum;
+        return 1;
+    }
+    it->patch = NULL;
+    return 0;
+}
+
+int bankNextSplit(wg_BankIter* it) {
+    if (!it->patch || it->nextSplit >= it->patch->splitNum) {
+        it->split  = NULL;
+        it->smpHdr = NULL;
+        return 0;
+    }
+    it->splitIdx = it->nextSplit++;
+    it->split    = it->splits + it->splitIdx;
+    it->splitOff = (uint8_t*)it->split - it->bank->base;
+    if (it->bank->isValid) {
+        it->smpHdr = (wg_SampleHdr*)(it->bank->base + it->split->smpHeadOff);
+    } else {
+        it->smpHdr = bankSampleHdr(it->bank, it->split->smpHeadOff);
+    }
+    return 1;
+}
@@ -0,0 +1,74 @@
+#ifndef BANK_H
+#define BANK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wgbank.h"
+
+//bounds checked access to a bank in memory, built as libwgbank
+//everything returned points into the buffer given to bankOpen(), nothing is copied
+//bankOpen() checks every offset in the bank once, if all of them fit the accessors
+//and iterators below stop checking, otherwise they check each access and skip what doesn't fit
+//base can hold just the structures of a bigger file, see bankOpenPart()
+
+typedef struct {
+    uint8_t*    base;
+    size_t      len;      //bytes at base
+    size_t      fileLen;  //whole bank, more than len when only structures were read
+    int         isValid;  //every PatchMap slot, split and sample header fits
+    const char* err;      //first thing that didn't, NULL if valid
+    uint32_t    errOff;   //offset of the structure holding it
+} wg_Bank;
+
+enum WG_ITER_FLAGS {
+    WG_ITER_DUMMIES = 1<<0 //visit dummy patches too
+};
+
+//walks PatchMap slots in order, then splits of current patch
+//slots and splits that point outside the bank are skipped
+typedef struct {
+    const wg_Bank* bank;
+    int            flags;
+    unsigned int   patchIdx;  //PatchMap slot, drums are 128 and up
+    uint32_t       patchOff;
+    wg_Patch*      patch;
+    wg_DrumTable*  drums;     //NULL unless drumkit
+    unsigned int   splitIdx;
+    uint32_t       splitOff;
+    wg_Split*      split;
+    wg_SampleHdr*  smpHdr;    //NULL if split points outside bank
+    //private
+    wg_Split*      splits;
+    unsigned int   nextPatch;
+    unsigned int   nextSplit;
+} wg_BankIter;
+
+//0 only if there's no room for a PatchMap, a bank that isn't valid can still be read
+int bankOpen(wg_Bank* bank, void* base, size_t len);
+//base holds the first len bytes of a fileLen byte bank, every structure has to be in there
+//sample data only has to be in the file, bankSampleData() gives NULL for what isn't at base
+int bankOpenPart(wg_Bank* bank, void* base, size_t len, size_t fileLen);
+//single pass over everything reachable from the PatchMap, done by bankOpen()
+//sample data has to fit too, loop point has to be 0 or inside it
+int bankValidate(wg_Bank* bank);
+//bytes at start of file that hold every structure, as far as the first len bytes tell
+//more than len means read that much and ask again, pointers past fileLen don't count
+size_t bankStructLen(const wg_Bank* bank);
+int bankIsIn(const wg_Bank* bank, uint64_t off, uint64_t size);
+//NULL if it doesn't fit
+wg_Patch* bankPatch(const wg_Bank* bank, unsigned int idx);
+wg_DrumTable* bankDrums(const wg_Bank* bank, const wg_Patch* patch);
+//array of patch->splitNum, NULL if it doesn't fit
+wg_Split* bankSplits(const wg_Bank* bank, const wg_Patch* patch);
+wg_SampleHdr* bankSampleHdr(const wg_Bank* bank, uint32_t off);
+//bytes from offStart to offEnd, NULL if they or the loop point don't fit
+uint8_t* bankSampleData(const wg_Bank* bank, const wg_SampleHdr* smpHdr, size_t* len);
+//sample data block follows all the structures, lowest offStart of them all
+size_t bankDataOff(const wg_Bank* bank);
+
+void bankIterInit(wg_BankIter* it, const wg_Bank* bank, int flags);
+int bankNextPatch(wg_BankIter* it);
+int bankNextSplit(wg_BankIter* it);
+
+#endif
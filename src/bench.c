@@ -0,0 +1,573 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "decode.h"
+#include "wgenc.h"
+#include "synth.h"
+#include "pool.h"
+#include "knife.h"
+#include "bank.h"
+#include "manifest.h"
+#include "mixer.h"
+
+//results go to stdout as CSV, one row per bench and bank:
+//bench,bank,reps,median_ms,p99_ms,mb_s,voices_per_core
+//mb_s is empty where throughput makes no sense, voices_per_core everywhere but mixer rows
+
+#define DECODE_LEN   (16<<20)
+#define SYNTH_RATE   44100
+#define SYNTH_BLOCK  64
+#define SYNTH_BLOCKS 20000
+#define MIX_VOICES   32
+#define MIX_BLOCKS   2000    //of SYNTH_BLOCK frames, a rep is this much audio
+#define MAX_SCALES   8
+#define TMP_DIR      "wgbench.tmp"
+
+#ifdef _WIN32
+    #define NULL_DEV "NUL"
+#else
+    #define NULL_DEV "/dev/null"
+#endif
+
+int numReps = 9;
+
+int cmpDouble(const void* a, const void* b) {
+    double dA = *(double*)a;
+    double dB = *(double*)b;
+    
+    return (dA > dB) - (dA < dB);
+}
+
+//voices is how many voices each rep plays for audio seconds, 0 leaves voices_per_core empty
+void reportVoices(const char* bench, const char* bank, double* times, int num, double bytes, double voices, double audio) {
+    double median, p99;
+    
+    qsort(times, num, sizeof(double), cmpDouble);
+    median = times[num/2];
+    p99    = times[(num*99 + 99)/100 - 1];
+    
+    printf("%s,%s,%i,%.4f,%.4f,", bench, bank, num, median * 1e3, p99 * 1e3);
+    if (bytes > 0) printf("%.1f", bytes / median / 1e6);
+    printf(",");
+    if (voices > 0) printf("%.0f", voices * audio / median);
+    printf("\n");
+    fflush(stdout);
+}
+
+void report(const char* bench, const char* bank, double* times, int num, double bytes) {
+    reportVoices(bench, bank, times, num, bytes, 0, 0);
+}
+
+//-----------------------------------------------
+//BANK
+
+typedef struct {
+    char*      label;
+    char       fileName[MAXPATH];
+    MappedFile bank;
+    size_t     dataOff;
+    int16_t*   pcm;
+    wg_Pool*   pool;
+    wg_ExportOpts opts48k;
+    wg_ExportOpts optsFlac;
+    wg_ExportOpts optsSync;
+    wg_ExportOpts optsPcm;
+    char        cacheName[MAXPATH];
+    wg_PcmCache cache;
+} BankCtx;
+
+typedef void (*BenchFn)(BankCtx* ctx);
+
+void timeBench(const char* bench, BenchFn fn, BankCtx* ctx, double bytes) {
+    double* times = malloc(numReps * sizeof(double));
+    
+    if (!times) {
+        printf("timeBench(): Out of memory!\n");
+        return;
+    }
+    for (int i=0; i < numReps; i++) {
+        double t = getTime();
+        
+        fn(ctx);
+        times[i] = getTime() - t;
+    }
+    report(bench, ctx->label, times, numReps, bytes);
+    free(times);
+}
+
+void benchOpen(BankCtx* ctx) {
+    MappedFile mf;
+    
+    if (mapfile(ctx->fileName, &mf)) {
+        checkWgbankHeader(mf.base, mf.len);
+        unmapfile(&mf);
+    }
+}
+
+//walks structures only, throughput is per bank byte like open
+void benchValidate(BankCtx* ctx) {
+    wg_Bank bank;
+    
+    bankOpen(&bank, ctx->bank.base, ctx->bank.len);
+    if (!bank.isValid) fprintf(stderr, "validate: %s out of bounds at %08Xh\n", bank.err, bank.errOff);
+}
+
+void benchLoad(BankCtx* ctx) {
+    size_t len;
+    
+    free(loadfile(ctx->fileName, &len));
+}
+
+void benchDescribe(BankCtx* ctx) {
+    FILE* out = fopen(NULL_DEV, "w");
+    
+    if (!out) return;
+    describeWgbank(out, ctx->bank.base, ctx->bank.len, ctx->bank.len);
+    fclose(out);
+}
+
+//what -d does: structures read from file, no mapping, sample data never touched
+void benchDescribeHead(BankCtx* ctx) {
+    FILE* out = fopen(NULL_DEV, "w");
+    MappedFile mf;
+    size_t fileLen;
+    
+    if (!out) return;
+    if (loadBankHead(ctx->fileName, &mf, &fileLen)) {
+        describeWgbank(out, mf.base, mf.len, fileLen);
+        unmapfile(&mf);
+    }
+    fclose(out);
+}
+
+//what -cache does the first time and whenever the bank changed
+void benchPcmBuild(BankCtx* ctx) {
+    pcmCacheBuild(ctx->cacheName, ctx->bank.base, ctx->bank.len);
+}
+
+//every later time, whole bank gets hashed to see it's still the same
+void benchPcmOpen(BankCtx* ctx) {
+    wg_PcmCache c;
+    
+    if (pcmCacheOpen(&c, ctx->cacheName, ctx->bank.base, ctx->bank.len)) pcmCacheClose(&c);
+}
+
+void benchDecodeBlock(BankCtx* ctx) {
+    wg_decode((uint8_t*)ctx->bank.base + ctx->dataOff, ctx->pcm, ctx->bank.len - ctx->dataOff);
+}
+
+//without manifest every export is a full one
+void forgetExport(BankCtx* ctx, const char* suffix) {
+    char name[MAXPATH + 32];
+    
+    sprintf(name, "%s%s/"MANIFEST_NAME, ctx->fileName, suffix);
+    remove(name);
+}
+
+void benchWav(BankCtx* ctx) {
+    forgetExport(ctx, "_dmp");
+    dumpSamples(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, NULL);
+}
+
+//nothing changed since last rep
+void benchWavAgain(BankCtx* ctx) {
+    dumpSamples(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, NULL);
+}
+
+void benchSfz(BankCtx* ctx) {
+    forgetExport(ctx, "_sfz");
+    dumpSfz(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, NULL);
+}
+
+void benchSfzSync(BankCtx* ctx) {
+    forgetExport(ctx, "_sfz");
+    dumpSfz(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, &ctx->optsSync);
+}
+
+//decoded samples come from cache, opening it isn't counted
+void benchWavPcm(BankCtx* ctx) {
+    forgetExport(ctx, "_dmp");
+    dumpSamples(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, &ctx->optsPcm);
+}
+
+void benchWav48k(BankCtx* ctx) {
+    forgetExport(ctx, "_dmp");
+    dumpSamples(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, &ctx->opts48k);
+}
+
+void benchFlac(BankCtx* ctx) {
+    forgetExport(ctx, "_dmp");
+    dumpSamples(ctx->fileName, ctx->bank.base, ctx->bank.len, ctx->pool, &ctx->optsFlac);
+}
+
+//copy of bank where every sample's data is repeated k times
+//loop goes into the last copy, so sample plays the same, just k times longer
+uint8_t* makeScaledBank(uint8_t* base, size_t len, unsigned int k, size_t* outLen) {
+    wg_BankIter it;
+    wg_Bank bank;
+    size_t dataOff;
+    uint32_t* hdrOffs = malloc(4096 * sizeof(uint32_t));
+    unsigned int numHdrs = 0;
+    size_t newLen, cur;
+    wg_BankHeader* head;
+    uint8_t* out = NULL;
+    
+    if (!hdrOffs) goto OOM;
+    bankOpen(&bank, base, len);
+    newLen = cur = dataOff = bankDataOff(&bank);
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        while (bankNextSplit(&it)) {
+            unsigned int h = 0;
+            
+            if (!it.smpHdr) continue;
+            while (h < numHdrs && hdrOffs[h] != it.split->smpHeadOff) h++;
+            if (h < numHdrs || numHdrs == 4096) continue;
+            hdrOffs[numHdrs++] = it.split->smpHeadOff;
+        }
+    }
+    for (unsigned int h=0; h < numHdrs; h++) {
+        wg_SampleHdr* smpHdr = (wg_SampleHdr*)(base + hdrOffs[h]);
+        
+        newLen += (size_t)k * (smpHdr->offEnd - smpHdr->offStart);
+    }
+    
+    if (!(out = malloc(newLen))) goto OOM;
+    memcpy(out, base, dataOff);
+    for (unsigned int h=0; h < numHdrs; h++) {
+        wg_SampleHdr* smpHdr = (wg_SampleHdr*)(out + hdrOffs[h]);
+        uint32_t smpLen = smpHdr->offEnd - smpHdr->offStart;
+        
+        for (unsigned int i=0; i < k; i++) memcpy(out + cur + i*smpLen, base + smpHdr->offStart, smpLen);
+        if (smpHdr->offLoop) smpHdr->offLoop = cur + (k-1)*smpLen + (smpHdr->offLoop - smpHdr->offStart);
+        smpHdr->offStart = cur;
+        smpHdr->offEnd   = cur + k*smpLen;
+        cur += k*smpLen;
+    }
+    //size field is only 24 bits, wraps past 16MB but still passes checkWgbankHeader()
+    head = (wg_BankHeader*)out;
+    head->fileSizeAndFlag = (head->fileSizeAndFlag & 0xFF000000) | (newLen & 0x00FFFFFF);
+    
+    free(hdrOffs);
+    *outLen = newLen;
+    return out;
+    OOM:
+        printf("makeScaledBank(): Out of memory!\n");
+        free(hdrOffs);
+        return NULL;
+}
+
+void benchBank(char* label, void* bankBuf, size_t bankLen) {
+    BankCtx ctx = {0};
+    wg_Resampler rs = {0};
+    wg_Bank wb;
+    double dataLen;
+    
+    ctx.label = label;
+    sprintf(ctx.fileName, TMP_DIR"/%s.TPD", label);
+    if (!writefile(ctx.fileName, bankBuf, bankLen)) return;
+    if (!mapfile(ctx.fileName, &ctx.bank)) return;
+    bankOpen(&wb, ctx.bank.base, ctx.bank.len);
+    ctx.dataOff = bankDataOff(&wb);
+    dataLen     = ctx.bank.len - ctx.dataOff;
+    if (!(ctx.pcm = malloc((ctx.bank.len - ctx.dataOff + 1) * sizeof(int16_t)))) goto END;
+    if (!(ctx.pool = poolCreate(1))) goto END;
+    if (!resamplerInit(&rs, SAMPLE_RATE, 48000)) goto END;
+    ctx.opts48k.rs = &rs;
+    ctx.optsFlac.isFlac = 1;
+    ctx.optsSync.isSyncIo = 1;
+    sprintf(ctx.cacheName, "%.*s"PCM_CACHE_EXT, MAXPATH - 8, ctx.fileName);
+    
+    timeBench("open",       benchOpen,        &ctx, ctx.bank.len);
+    timeBench("validate",   benchValidate,    &ctx, ctx.bank.len);
+    timeBench("loadfile",   benchLoad,        &ctx, ctx.bank.len);
+    timeBench("describe",   benchDescribe,    &ctx, 0);
+    timeBench("describe_head", benchDescribeHead, &ctx, 0);
+    timeBench("decode",     benchDecodeBlock, &ctx, dataLen);
+    timeBench("pcm_cache_build", benchPcmBuild, &ctx, ctx.bank.len);
+    timeBench("pcm_cache_open",  benchPcmOpen,  &ctx, ctx.bank.len);
+    timeBench("export_wav", benchWav,         &ctx, dataLen * 2);
+    timeBench("export_wav_again", benchWavAgain, &ctx, dataLen * 2);
+    if (pcmCacheOpen(&ctx.cache, ctx.cacheName, ctx.bank.base, ctx.bank.len)) {
+        ctx.optsPcm.pcm = &ctx.cache;
+        timeBench("export_wav_pcm", benchWavPcm, &ctx, dataLen * 2);
+        pcmCacheClose(&ctx.cache);
+    }
+    timeBench("export_sfz", benchSfz,         &ctx, dataLen * 2);
+    timeBench("export_sfz_syncio", benchSfzSync, &ctx, dataLen * 2);
+    timeBench("export_wav_48k", benchWav48k,  &ctx, dataLen * 2 * 48000 / SAMPLE_RATE);
+    timeBench("export_flac", benchFlac,       &ctx, dataLen * 2);
+    
+    END:
+        resamplerFree(&rs);
+        poolDestroy(ctx.pool);
+        free(ctx.pcm);
+        unmapfile(&ctx.bank);
+}
+
+//-----------------------------------------------
+//DECODE
+
+//every implementation against scalar on the same input
+void benchDecode(const char* label, uint8_t* src, size_t len) {
+    static const char* implNames[] = {"decode_auto", "decode_scalar", "decode_sse4.1", "decode_avx2"};
+    double* times = malloc(numReps * sizeof(double));
+    int16_t* ref = malloc(len * sizeof(int16_t));
+    int16_t* out = malloc(len * sizeof(int16_t));
+    
+    if (!times || !ref || !out) {
+        printf("benchDecode(): Out of memory!\n");
+        goto END;
+    }
+    wg_decodeWith(WG_DECODE_SCALAR, src, ref, len);
+    
+    for (int impl=WG_DECODE_SCALAR; impl <= WG_DECODE_AVX2; impl++) {
+        if (!wg_decodeSupported(impl)) continue;
+        
+        for (int i=0; i < numReps; i++) {
+            double t = getTime();
+            
+            wg_decodeWith(impl, src, out, len);
+            times[i] = getTime() - t;
+        }
+        if (memcmp(ref, out, len * sizeof(int16_t))) fprintf(stderr, "%s: MISMATCH\n", implNames[impl]);
+        report(implNames[impl], label, times, numReps, len);
+    }
+    
+    END:
+        free(times);
+        free(ref);
+        free(out);
+}
+
+//-----------------------------------------------
+//ENCODE
+
+//decoded noise through the reverse table, must come back unchanged
+void benchEncode(const char* label, uint8_t* src, size_t len) {
+    double* times = malloc(numReps * sizeof(double));
+    int16_t* pcm = malloc(len * sizeof(int16_t));
+    uint8_t* out = malloc(len);
+    
+    if (!times || !pcm || !out) {
+        printf("benchEncode(): Out of memory!\n");
+        goto END;
+    }
+    wg_decode(src, pcm, len);
+    wg_encodeInit();
+    
+    for (int i=0; i < numReps; i++) {
+        double t = getTime();
+        
+        wg_encode(pcm, out, len);
+        times[i] = getTime() - t;
+    }
+    if (memcmp(src, out, len)) fprintf(stderr, "encode: MISMATCH\n");
+    report("encode", label, times, numReps, len * sizeof(int16_t));
+    
+    END:
+        free(times);
+        free(pcm);
+        free(out);
+}
+
+//-----------------------------------------------
+//SYNTH
+
+//keeps every voice busy with long notes, retriggering as they die
+//times are per SYNTH_BLOCK frames, throughput is output audio
+//pcm can be NULL, same notes either way
+void benchSynth(const char* label, void* base, size_t len, const wg_PcmCache* pcm) {
+    int16_t out[SYNTH_BLOCK*2];
+    double* times = malloc(SYNTH_BLOCKS * sizeof(double));
+    wg_Synth* syn = synthCreate(base, len, SYNTH_RATE);
+    uint32_t seed = 0x9E3779B9;
+    
+    if (!times || !syn) {
+        printf("benchSynth(): Could not create synth.\n");
+        goto END;
+    }
+    synthSetPcm(syn, pcm);
+    for (int ch=0; ch < SYNTH_CHANNELS; ch++) {
+        synthProgram(syn, ch, ch * 7);
+        synthControl(syn, ch, 64, 127);
+    }
+    
+    for (int b=0; b < SYNTH_BLOCKS; b++) {
+        double t = getTime();
+        
+        while (synthActiveVoices(syn) < SYNTH_VOICES) {
+            int before = synthActiveVoices(syn);
+            
+            seed = seed * 1664525 + 1013904223;
+            synthNoteOn(syn, (seed >> 8) % SYNTH_CHANNELS, 36 + (seed >> 16) % 60, 100);
+            if (synthActiveVoices(syn) == before) break;
+        }
+        synthRender(syn, out, SYNTH_BLOCK);
+        times[b] = getTime() - t;
+    }
+    report(pcm ? "synth_block64_32v_pcm" : "synth_block64_32v", label, times, SYNTH_BLOCKS, sizeof(out));
+    
+    END:
+        synthDestroy(syn);
+        free(times);
+}
+
+//-----------------------------------------------
+//MIX
+
+//MIX_VOICES samples of the bank from its cache at uneven pitches, a voice that ends starts over
+//every interpolation on every implementation, checked against scalar through a sum of the mix
+//voices_per_core is how many voices one thread could keep up with in real time
+void benchMix(const char* label, void* base, size_t len, const wg_PcmCache* pcm) {
+    static const char* interpNames[] = {"linear", "nearest", "cubic", "sinc"};
+    static const char* implNames[]   = {"auto", "scalar", "sse4.1", "avx2"};
+    wg_MixVoice start[MIX_VOICES];
+    int32_t mix[SYNTH_BLOCK*2];
+    double* times = malloc(numReps * sizeof(double));
+    uint32_t seed = 0x9E3779B9;
+    int num = 0;
+    wg_BankIter it;
+    wg_Bank bank;
+    
+    if (!times || !bankOpen(&bank, base, len)) {
+        printf("benchMix(): Could not open bank.\n");
+        goto END;
+    }
+    bankIterInit(&it, &bank, 0);
+    while (num < MIX_VOICES && bankNextPatch(&it)) {
+        while (num < MIX_VOICES && bankNextSplit(&it)) {
+            const int16_t* smp = it.smpHdr ? pcmCacheFind(pcm, it.smpHdr) : NULL;
+            
+            if (!smp) continue;
+            seed = seed * 1664525 + 1013904223;
+            mixVoiceInit(&start[num], it.smpHdr, smp);
+            //0.35 to 1.35 frames per output frame, fractions all over
+            start[num].step = ((uint64_t)1 << 32) * 35 / 100 + seed;
+            mixVoiceGains(&start[num], it.patch, it.split, it.smpHdr, 100, 1.0f, -1.0f / (SYNTH_BLOCK * MIX_BLOCKS));
+            num++;
+        }
+    }
+    if (!num) goto END;
+    mixInit();
+    
+    for (int interp=0; interp < WG_MIX_NUM_INTERP; interp++) {
+        uint64_t ref = 0;
+        
+        for (int impl=WG_MIX_SCALAR; impl <= WG_MIX_AVX2; impl++) {
+            char name[32];
+            uint64_t sum = 0;
+            
+            if (!mixSupported(impl)) continue;
+            for (int r=0; r < numReps; r++) {
+                wg_MixVoice voices[MIX_VOICES];
+                double t = getTime();
+                
+                memcpy(voices, start, num * sizeof(wg_MixVoice));
+                sum = 0;
+                for (int b=0; b < MIX_BLOCKS; b++) {
+                    memset(mix, 0, sizeof(mix));
+                    for (int i=0; i < num; i++) {
+                        if (mixVoiceWith(impl, &voices[i], mix, SYNTH_BLOCK, interp) < SYNTH_BLOCK) voices[i].pos = 0;
+                    }
+                    for (int i=0; i < SYNTH_BLOCK*2; i++) sum = sum*31 + (uint32_t)mix[i];
+                }
+                times[r] = getTime() - t;
+            }
+            if (impl == WG_MIX_SCALAR) ref = sum;
+            if (sum != ref) fprintf(stderr, "mix_%s_%s: MISMATCH\n", interpNames[interp], implNames[impl]);
+            sprintf(name, "mix_%s_%s", interpNames[interp], implNames[impl]);
+            reportVoices(name, label, times, numReps, 0, num, (double)SYNTH_BLOCK * MIX_BLOCKS / SYNTH_RATE);
+        }
+    }
+    
+    END:
+        free(times);
+}
+
+//-----------------------------------------------
+//MAIN
+
+int main(int argc, char *argv[]) {
+    unsigned int scales[MAX_SCALES] = {1, 8};
+    int numScales = 0;
+    char* bankName = NULL;
+    MappedFile bank = {0};
+    wg_PcmCache cache;
+    uint8_t* noise;
+    uint32_t seed = 0x12345678;
+
+    #define O(X) (!strcmp(argv[i], X))
+    for (int i=1; i < argc; i++) {
+        if (O("-r") && i+1 < argc) {
+            numReps = atoi(argv[++i]);
+            if (numReps < 1) numReps = 1;
+        } else if (O("-x") && i+1 < argc && numScales < MAX_SCALES) {
+            scales[numScales] = atoi(argv[++i]);
+            if (scales[numScales] >= 1) numScales++;
+        } else if (argv[i][0] != '-' && !bankName) {
+            bankName = argv[i];
+        } else {
+            printf(
+                "usage:\n"
+                "  wgbench [-r REPS] [-x SCALE]... [BANKFILE]\n"
+                "  -r REPS: Runs per measurement. Default is 9.\n"
+                "  -x SCALE: Also bench a synthetic bank with samples SCALE times longer, repeatable.\n"
+                "    Default is 1 and 8.\n"
+                "  Without BANKFILE only decode runs, on noise.\n"
+            );
+            return 1;
+        }
+    }
+    #undef O
+    if (!numScales) numScales = 2;
+    
+    printf("bench,bank,reps,median_ms,p99_ms,mb_s,voices_per_core\n");
+    
+    if (!(noise = malloc(DECODE_LEN))) {
+        printf("Out of memory!\n");
+        return 2;
+    }
+    for (size_t i=0; i < DECODE_LEN; i++) {
+        seed = seed * 1664525 + 1013904223;
+        noise[i] = seed >> 24;
+    }
+    benchDecode("noise", noise, DECODE_LEN);
+    benchEncode("noise", noise, DECODE_LEN);
+    free(noise);
+    
+    if (!bankName) return 0;
+    if (!mapfile(bankName, &bank)) return 2;
+    if (!checkWgbankHeader(bank.base, bank.len)) {
+        printf("Not a WinGroove bank.\n");
+        unmapfile(&bank);
+        return 3;
+    }
+    nameIndexInit(&smpNameIdx);
+    if (!nameIndexAdd(&smpNameIdx, SMPNAMES)) return 2;
+    makeDir(TMP_DIR);
+    
+    benchSynth("x1", bank.base, bank.len, NULL);
+    if (pcmCacheLoad(&cache, TMP_DIR"/synth"PCM_CACHE_EXT, bank.base, bank.len)) {
+        benchSynth("x1", bank.base, bank.len, &cache);
+        benchMix("x1", bank.base, bank.len, &cache);
+        pcmCacheClose(&cache);
+    }
+    for (int s=0; s < numScales; s++) {
+        char label[16];
+        size_t len;
+        uint8_t* buf;
+        
+        if (!(buf = makeScaledBank(bank.base, bank.len, scales[s], &len))) continue;
+        sprintf(label, "x%u", scales[s]);
+        benchBank(label, buf, len);
+        free(buf);
+    }
+    
+    nameIndexFree(&smpNameIdx);
+    unmapfile(&bank);
+    return 0;
+}
@@ -1,11 +1,18 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <sys/stat.h>
 
 #include "common.h"
 
-void* loadfile(char* name, unsigned int* buflen) {
+void* loadfile(char* name, size_t* buflen) {
     char* buf;
+    long size;
 	FILE* fin = fopen(name, "rb");
     
 	if (!fin) {
@@ -13,33 +20,62 @@ void* loadfile(char* name, unsigned int* buflen) {
 		return NULL;
 	}
 
-    fseek(fin, 0, SEEK_END);
-    *buflen = ftell(fin);
+    if (fseek(fin, 0, SEEK_END) || (size = ftell(fin)) < 0) {
+        //pipes and such, slurp it in chunks
+        size_t cap = 0;
+        
+        buf = NULL;
+        *buflen = 0;
+        do {
+            char* tmp;
+            
+            if (*buflen == cap) {
+                cap = cap ? cap*2 : 1<<20;
+                if (!(tmp = realloc(buf, cap))) goto OOM;
+                buf = tmp;
+            }
+            *buflen += fread(buf + *buflen, 1, cap - *buflen, fin);
+        } while (!feof(fin) && !ferror(fin));
+        fclose(fin);
+        
+        return buf;
+    }
+    *buflen = size;
     fseek(fin, 0, SEEK_SET);
 
     buf = malloc(*buflen);
-    if(!buf) {
-        fclose(fin);
-        printf("loadfile(): Out of memory!\n");
-        return NULL;
-    }
+    if(!buf) goto OOM;
 
     fread(buf, 1, *buflen, fin);
 	fclose(fin);
 
     return buf;
+    OOM:
+        free(buf);
+        fclose(fin);
+        printf("loadfile(): Out of memory!\n");
+        return NULL;
 }
 
-int writefile(char* name, void* buf, unsigned int buflen) {
-	FILE* fout = fopen(name, "wb");
+//a failed write leaves no file behind
+int writefile(char* name, void* buf, size_t buflen) {
+    wg_IoVec vec;
+    int fout = fileCreate(name);
+    int isOk;
     
-	if (!fout) {
+    if (fout < 0) {
         printf("writefile(): Could not open the file.\n");
-		return 0;
-	}
-    fwrite(buf, 1, buflen, fout);
-    fclose(fout);
-    return 1;
+        return 0;
+    }
+    vec.buf = buf;
+    vec.len = buflen;
+    isOk = fileWriteVec(fout, &vec, 1);
+    isOk = fileClose(fout) && isOk;
+    if (!isOk) {
+        printf("writefile(): Could not write the file.\n");
+        remove(name);
+    }
+    return isOk;
 }
 
 int isFileExist(char* name) {
@@ -71,9 +107,42 @@ int isFileExist(char* name) {
 //if fail: return 0
 //otherwise: return number of characters written to buff, without null
 
+//* int mapfile(char* name, MappedFile* mf)
+//maps file read-only, mf->base stays valid until unmapfile()
+//if file can't be mapped(pipes, empty files, etc), falls back to loadfile()
+//if fail: return 0
+//
+//* int fileCreate(const char* name)
+//creates/truncates file for writing, returns descriptor
+//if fail: return -1
+//
+//* int fileOpenRead(const char* name, uint64_t* size)
+//opens regular file for fileReadAt(), size is its length
+//if fail: return -1
+//
+//* int fileReadAt(int fd, void* buf, size_t len, uint64_t off)
+//reads len bytes at off, file position isn't guaranteed to stay put
+//if fail or file ends early: return 0
+//
+//* int fileLink(const char* from, const char* to)
+//hardlinks existing file from as new name to, fails if to exists
+//if fail: return 0
+//
+//* int fileWriteVec(int fd, const wg_IoVec* vec, int num)
+//writes all buffers in order, gathered into as few syscalls as the OS allows
+//if fail: return 0
+//
+//* double getTime(void)
+//monotonic clock in seconds, for benchmarks
+//
+//* void adviseMapping(MappedFile* mf, size_t off, size_t len, int advice)
+//hints expected access pattern of a mapped range, no-op for loaded files
+
 // Fully qualified name of the directory being deleted, without trailing backslash
 #ifdef _WIN32
 #include <windows.h>
+#include <io.h>
+#include <fcntl.h>
 
 /*
 int clearPathIfOccupied(const char* path) {
@@ -110,7 +179,125 @@ int retrieveWorkingPath(unsigned int nBufferLength, char* lpBuffer) {
 int makeDir(const char *path) {
     return mkdir(path);
 }
+
+int fileCreate(const char* name) {
+    return _open(name, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+int fileOpenRead(const char* name, uint64_t* size) {
+    struct _stati64 st;
+    int fd = _open(name, _O_RDONLY | _O_BINARY);
+    
+    if (fd < 0) return -1;
+    if (_fstati64(fd, &st) || !(st.st_mode & _S_IFREG)) {
+        _close(fd);
+        return -1;
+    }
+    *size = st.st_size;
+    return fd;
+}
+
+int fileReadAt(int fd, void* buf, size_t len, uint64_t off) {
+    char* p = buf;
+    
+    if (_lseeki64(fd, off, SEEK_SET) < 0) return 0;
+    while (len) {
+        int n = _read(fd, p, len > 0x40000000 ? 0x40000000 : len);
+        
+        if (n <= 0) return 0;
+        p   += n;
+        len -= n;
+    }
+    return 1;
+}
+
+int fileLink(const char* from, const char* to) {
+    return CreateHardLinkA(to, from, NULL) != 0;
+}
+
+int fileWriteVec(int fd, const wg_IoVec* vec, int num) {
+    //no writev(), WriteFileGather() wants page aligned unbuffered io
+    for (int i=0; i < num; i++) {
+        const char* p = vec[i].buf;
+        size_t left = vec[i].len;
+        
+        while (left) {
+            int n = _write(fd, p, left > 0x40000000 ? 0x40000000 : left);
+            
+            if (n <= 0) return 0;
+            p    += n;
+            left -= n;
+        }
+    }
+    return 1;
+}
+
+int fileClose(int fd) {
+    return !_close(fd);
+}
+
+int mapfile(char* name, MappedFile* mf) {
+    HANDLE hFile, hMap;
+    LARGE_INTEGER size;
+    
+    mf->base     = NULL;
+    mf->len      = 0;
+    mf->isMapped = 0;
+    
+    hFile = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) goto FALLBACK;
+    if (GetFileType(hFile) != FILE_TYPE_DISK || !GetFileSizeEx(hFile, &size) || !size.QuadPart || (uint64_t)size.QuadPart > SIZE_MAX) {
+        CloseHandle(hFile);
+        goto FALLBACK;
+    }
+    
+    hMap = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hFile);
+    if (!hMap) goto FALLBACK;
+    
+    //view keeps the mapping alive
+    mf->base = MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hMap);
+    if (!mf->base) goto FALLBACK;
+    
+    mf->len      = size.QuadPart;
+    mf->isMapped = 1;
+    return 1;
+    
+    FALLBACK:
+        mf->base = loadfile(name, &mf->len);
+        return mf->base != NULL;
+}
+
+void adviseMapping(MappedFile* mf, size_t off, size_t len, int advice) {
+    //PrefetchVirtualMemory() is Win8+, let the cache manager guess
+    (void)mf; (void)off; (void)len; (void)advice;
+}
+
+double getTime(void) {
+    LARGE_INTEGER freq, now;
+    
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart / freq.QuadPart;
+}
+
+void unmapfile(MappedFile* mf) {
+    if (!mf->base) return;
+    if (mf->isMapped) {
+        UnmapViewOfFile(mf->base);
+    } else {
+        free(mf->base);
+    }
+    mf->base = NULL;
+}
 #else
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+
 /*
 int clearPathIfOccupied(const char* path) {
     //TODO
@@ -130,4 +317,134 @@ int retrieveWorkingPath() {
 int makeDir(const char *path) {
     return mkdir(path, 0777);
 }
+int fileCreate(const char* name) {
+    return open(name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+}
+
+int fileOpenRead(const char* name, uint64_t* size) {
+    struct stat st;
+    int fd = open(name, O_RDONLY);
+    
+    if (fd < 0) return -1;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+    *size = st.st_size;
+    return fd;
+}
+
+int fileReadAt(int fd, void* buf, size_t len, uint64_t off) {
+    char* p = buf;
+    
+    while (len) {
+        ssize_t n = pread(fd, p, len, off);
+        
+        if (n <= 0) return 0;
+        p   += n;
+        off += n;
+        len -= n;
+    }
+    return 1;
+}
+
+int fileLink(const char* from, const char* to) {
+    return !link(from, to);
+}
+
+int fileWriteVec(int fd, const wg_IoVec* vec, int num) {
+    struct iovec iov[16];
+    int i = 0;
+    
+    while (i < num) {
+        int nIov = 0;
+        ssize_t n;
+        
+        for (; i+nIov < num && nIov < 16; nIov++) {
+            iov[nIov].iov_base = (void*)vec[i+nIov].buf;
+            iov[nIov].iov_len  = vec[i+nIov].len;
+        }
+        
+        //short writes are rare, but legal
+        for (;;) {
+            n = writev(fd, iov, nIov);
+            if (n < 0) return 0;
+            while (nIov && (size_t)n >= iov[0].iov_len) {
+                n -= iov[0].iov_len;
+                memmove(iov, iov+1, --nIov * sizeof(struct iovec));
+                i++;
+            }
+            if (!nIov) break;
+            iov[0].iov_base  = (char*)iov[0].iov_base + n;
+            iov[0].iov_len  -= n;
+        }
+    }
+    return 1;
+}
+
+int fileClose(int fd) {
+    return !close(fd);
+}
+
+int mapfile(char* name, MappedFile* mf) {
+    struct stat st;
+    void* p;
+    int fd;
+    
+    mf->base     = NULL;
+    mf->len      = 0;
+    mf->isMapped = 0;
+    
+    fd = open(name, O_RDONLY);
+    if (fd < 0) goto FALLBACK;
+    if (fstat(fd, &st) || !S_ISREG(st.st_mode) || !st.st_size || (uint64_t)st.st_size > SIZE_MAX) {
+        close(fd);
+        goto FALLBACK;
+    }
+    
+    p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) goto FALLBACK;
+    
+    mf->base     = p;
+    mf->len      = st.st_size;
+    mf->isMapped = 1;
+    return 1;
+    
+    FALLBACK:
+        mf->base = loadfile(name, &mf->len);
+        return mf->base != NULL;
+}
+
+void adviseMapping(MappedFile* mf, size_t off, size_t len, int advice) {
+    static const int adv[] = {
+        POSIX_MADV_NORMAL, POSIX_MADV_WILLNEED, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM
+    };
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t head;
+    
+    if (!mf->isMapped || off >= mf->len) return;
+    if (len > mf->len - off) len = mf->len - off;
+    
+    //range has to start on a page boundary
+    head = off % page;
+    posix_madvise((char*)mf->base + off - head, len + head, adv[advice]);
+}
+
+double getTime(void) {
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void unmapfile(MappedFile* mf) {
+    if (!mf->base) return;
+    if (mf->isMapped) {
+        munmap(mf->base, mf->len);
+    } else {
+        free(mf->base);
+    }
+    mf->base = NULL;
+}
 #endif
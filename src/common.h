@@ -1,11 +1,40 @@
 #ifndef COMMON_H
 #define COMMON_H
 
-#include "common.h"
+#include <stddef.h>
+#include <stdint.h>
 
-void* loadfile(char* name, unsigned int* buflen);
-int writefile(char* name, void* buf, unsigned int buflen);
+enum MAP_ADVICE {
+    MAP_ADV_NORMAL,
+    MAP_ADV_WILLNEED,   //will be read soon, start reading ahead
+    MAP_ADV_SEQUENTIAL, //aggressive readahead, drop pages behind
+    MAP_ADV_RANDOM      //no readahead
+};
+
+typedef struct {
+    const void* buf;
+    size_t      len;
+} wg_IoVec;
+
+typedef struct {
+    void*  base;
+    size_t len;
+    int    isMapped; //0 if contents were loaded into heap instead
+} MappedFile;
+
+void* loadfile(char* name, size_t* buflen);
+int mapfile(char* name, MappedFile* mf);
+void adviseMapping(MappedFile* mf, size_t off, size_t len, int advice);
+void unmapfile(MappedFile* mf);
+double getTime(void);
+int writefile(char* name, void* buf, size_t buflen);
 int isFileExist(char* name);
 int makeDir(const char *path);
+int fileCreate(const char* name);
+int fileOpenRead(const char* name, uint64_t* size);
+int fileReadAt(int fd, void* buf, size_t len, uint64_t off);
+int fileLink(const char* from, const char* to);
+int fileWriteVec(int fd, const wg_IoVec* vec, int num);
+int fileClose(int fd);
 
 #endif
\ No newline at end of file
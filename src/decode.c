@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wgbank.h"
+#include "decode.h"
+
+//Every row of 16 entries in wg_pcmTable(same high nibble) is a straight line,
+//the few odd steps in rows 3 and 4 are just rounding of a fractional slope.
+//So entry = base[hi] + (lo * slope[hi]) >> 4, slope being 12.4 fixed-point;
+//vector kernels look base and slope up with byte shuffles and do one multiply.
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define DECODE_X86
+#include <immintrin.h>
+#endif
+
+static void decodeScalar(const uint8_t* in, int16_t* out, size_t len) {
+    for (size_t i=0; i < len; i++) out[i] = wg_pcmTable[in[i]];
+}
+
+#ifdef DECODE_X86
+//wg_pcmTable[h*16] and slope per high nibble, split in byte planes for shuffles
+#define ROWTABLES(TYPE, SETR) \
+    const TYPE baseLo  = SETR(0x00,0x00,0x00,0x02,0x08,0x21,0x87,0x1F,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00); \
+    const TYPE baseHi  = SETR(0x00,0x01,0x02,0x04,0x08,0x10,0x20,0x42,0x80,0xC0,0xE0,0xF0,0xF8,0xFC,0xFE,0xFF); \
+    const TYPE slopeLo = SETR(0x00,0x00,0x00,0x02,0x08,0x20,0x80,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00); \
+    const TYPE slopeHi = SETR(0x01,0x01,0x02,0x04,0x08,0x10,0x20,0x42,0x40,0x20,0x10,0x08,0x04,0x02,0x01,0x01);
+
+//same rows in both 128-bit lanes, shuffles can't cross them
+#define SETR256(...) _mm256_setr_epi8(__VA_ARGS__, __VA_ARGS__)
+
+__attribute__((target("sse4.1")))
+static void decodeSse41(const uint8_t* in, int16_t* out, size_t len) {
+    ROWTABLES(__m128i, _mm_setr_epi8)
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i zero   = _mm_setzero_si128();
+    size_t i = 0;
+    
+    for (; i + 16 <= len; i += 16) {
+        __m128i x   = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i hi  = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+        __m128i lo  = _mm_andnot_si128(nibble, _mm_slli_epi16(x, 4));
+        __m128i bLo = _mm_shuffle_epi8(baseLo,  hi);
+        __m128i bHi = _mm_shuffle_epi8(baseHi,  hi);
+        __m128i sLo = _mm_shuffle_epi8(slopeLo, hi);
+        __m128i sHi = _mm_shuffle_epi8(slopeHi, hi);
+        //low nibble lands in top 4 bits of word, mulhi then does the >>4
+        __m128i a   = _mm_add_epi16(_mm_unpacklo_epi8(bLo, bHi),
+                        _mm_mulhi_epu16(_mm_unpacklo_epi8(zero, lo), _mm_unpacklo_epi8(sLo, sHi)));
+        __m128i b   = _mm_add_epi16(_mm_unpackhi_epi8(bLo, bHi),
+                        _mm_mulhi_epu16(_mm_unpackhi_epi8(zero, lo), _mm_unpackhi_epi8(sLo, sHi)));
+        
+        _mm_storeu_si128((__m128i*)(out + i),     a);
+        _mm_storeu_si128((__m128i*)(out + i + 8), b);
+    }
+    decodeScalar(in + i, out + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static void decodeAvx2(const uint8_t* in, int16_t* out, size_t len) {
+    ROWTABLES(__m256i, SETR256)
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero   = _mm256_setzero_si256();
+    size_t i = 0;
+    
+    for (; i + 32 <= len; i += 32) {
+        //unpacks work per 128-bit lane, put 64-bit quarters in 0,2,1,3 order so output comes out straight
+        __m256i x   = _mm256_permute4x64_epi64(_mm256_loadu_si256((const __m256i*)(in + i)), 0xD8);
+        __m256i hi  = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+        __m256i lo  = _mm256_andnot_si256(nibble, _mm256_slli_epi16(x, 4));
+        __m256i bLo = _mm256_shuffle_epi8(baseLo,  hi);
+        __m256i bHi = _mm256_shuffle_epi8(baseHi,  hi);
+        __m256i sLo = _mm256_shuffle_epi8(slopeLo, hi);
+        __m256i sHi = _mm256_shuffle_epi8(slopeHi, hi);
+        __m256i a   = _mm256_add_epi16(_mm256_unpacklo_epi8(bLo, bHi),
+                        _mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, lo), _mm256_unpacklo_epi8(sLo, sHi)));
+        __m256i b   = _mm256_add_epi16(_mm256_unpackhi_epi8(bLo, bHi),
+                        _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, lo), _mm256_unpackhi_epi8(sLo, sHi)));
+        
+        _mm256_storeu_si256((__m256i*)(out + i),      a);
+        _mm256_storeu_si256((__m256i*)(out + i + 16), b);
+    }
+    decodeSse41(in + i, out + i, len - i);
+}
+#endif
+
+int wg_decodeSupported(int impl) {
+    switch (impl) {
+        case WG_DECODE_AUTO:
+        case WG_DECODE_SCALAR:
+            return 1;
+        #ifdef DECODE_X86
+        case WG_DECODE_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case WG_DECODE_AVX2:
+            return __builtin_cpu_supports("avx2");
+        #endif
+        default:
+            return 0;
+    }
+}
+
+void wg_decodeWith(int impl, const uint8_t* in, int16_t* out, size_t len) {
+    if (impl == WG_DECODE_AUTO) {
+        impl = wg_decodeSupported(WG_DECODE_AVX2)  ? WG_DECODE_AVX2  :
+               wg_decodeSupported(WG_DECODE_SSE41) ? WG_DECODE_SSE41 : WG_DECODE_SCALAR;
+    }
+    if (!wg_decodeSupported(impl)) impl = WG_DECODE_SCALAR;
+    
+    switch (impl) {
+        #ifdef DECODE_X86
+        case WG_DECODE_SSE41:
+            decodeSse41(in, out, len);
+            break;
+        case WG_DECODE_AVX2:
+            decodeAvx2(in, out, len);
+            break;
+        #endif
+        default:
+            decodeScalar(in, out, len);
+            break;
+    }
+}
+
+void wg_decode(const uint8_t* in, int16_t* out, size_t len) {
+    wg_decodeWith(WG_DECODE_AUTO, in, out, len);
+}
@@ -0,0 +1,23 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//WinGroove 8-bit sample data to int16, same results as wg_pcmTable lookup
+//picks the widest kernel the CPU supports at runtime
+
+enum WG_DECODE_IMPL {
+    WG_DECODE_AUTO,
+    WG_DECODE_SCALAR,
+    WG_DECODE_SSE41,
+    WG_DECODE_AVX2
+};
+
+void wg_decode(const uint8_t* in, int16_t* out, size_t len);
+
+//for benchmarks and testing, unsupported impl falls back to scalar
+int wg_decodeSupported(int impl);
+void wg_decodeWith(int impl, const uint8_t* in, int16_t* out, size_t len);
+
+#endif
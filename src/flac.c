@@ -0,0 +1,608 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "common.h"
+#include "pool.h"
+#include "flac.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define FLAC_BLOCK      (4096)  //frames per FLAC frame
+#define BLOCKS_PER_TASK (8)
+#define MAX_FIXED       (4)
+#define MAX_LPC         (8)
+#define LPC_PRECISION   (12)    //bits per quantized coefficient
+#define MAX_PART_ORDER  (8)
+#define MAX_RICE        (14)    //15 is the escape code
+//verbatim 17-bit side channel plus subframe and frame headers
+#define FRAME_BOUND(CH) ((CH) * (FLAC_BLOCK*17/8 + 8) + 32)
+
+enum SUBFRAME_TYPE {
+    SUB_CONSTANT,
+    SUB_VERBATIM,
+    SUB_FIXED,
+    SUB_LPC
+};
+
+//channel assignment codes of frame header
+enum CHANNEL_MODE {
+    CH_LEFT_SIDE  = 8,
+    CH_RIGHT_SIDE = 9,
+    CH_MID_SIDE   = 10
+};
+
+typedef struct {
+    uint8_t* buf;
+    size_t   pos;   //whole bytes written
+    uint64_t acc;
+    int      nBits; //not yet written, always < 8 between calls
+} BitWriter;
+
+typedef struct {
+    int      type;
+    int      wasted;    //low zero bits shared by all samples
+    int      order;
+    int      shift;     //of LPC sum
+    int32_t  coefs[MAX_LPC];
+    int      partOrder;
+    int      params[1 << MAX_PART_ORDER];
+    uint64_t bits;
+} Subframe;
+
+//per task, so workers never share anything
+typedef struct {
+    int32_t ch[4][FLAC_BLOCK];  //left, right, mid, side
+    int32_t x[FLAC_BLOCK];      //wasted bits shifted out
+    int32_t res[FLAC_BLOCK];
+    double  win[FLAC_BLOCK];
+} Scratch;
+
+typedef struct {
+    const int16_t* pcm;
+    size_t         len;
+    int            numChans;
+    uint32_t       first, num;  //blocks
+    uint8_t*       out;         //FRAME_BOUND() bytes per block
+    size_t*        frameLen;
+    int            isFailed;
+} FlacTask;
+
+static void putBits(BitWriter* bw, uint32_t v, int n) {
+    if (!n) return;
+    bw->acc    = (bw->acc << n) | ((uint64_t)v & (((uint64_t)1 << n) - 1));
+    bw->nBits += n;
+    while (bw->nBits >= 8) {
+        bw->nBits -= 8;
+        bw->buf[bw->pos++] = (uint8_t)(bw->acc >> bw->nBits);
+    }
+}
+
+static void alignBits(BitWriter* bw) {
+    if (bw->nBits) putBits(bw, 0, 8 - bw->nBits);
+}
+
+//zigzag, then unary quotient and k low bits
+static void putRice(BitWriter* bw, int32_t r, int k) {
+    uint32_t u = ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+    uint32_t q = u >> k;
+    
+    for (; q >= 24; q -= 24) putBits(bw, 0, 24);
+    putBits(bw, 1, q + 1);
+    putBits(bw, u, k);
+}
+
+//frame numbers are coded like UTF-8
+static void putUtf8(BitWriter* bw, uint32_t v) {
+    int nMore;
+    
+    if (v < 0x80) {
+        putBits(bw, v, 8);
+        return;
+    }
+    nMore = v < 0x800 ? 1 : (v < 0x10000 ? 2 : (v < 0x200000 ? 3 : (v < 0x4000000 ? 4 : 5)));
+    //nMore+1 ones and a zero, then top bits of v
+    putBits(bw, ((1u << (nMore+1)) - 1) << 1, nMore + 2);
+    putBits(bw, v >> (6*nMore), 6 - nMore);
+    while (nMore--) putBits(bw, 0x80 | ((v >> (6*nMore)) & 0x3F), 8);
+}
+
+static uint8_t crc8(const uint8_t* p, size_t len) {
+    uint8_t crc = 0;
+    
+    while (len--) {
+        crc ^= *p++;
+        for (int i=0; i < 8; i++) crc = crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t* p, size_t len) {
+    uint16_t crc = 0;
+    
+    while (len--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int i=0; i < 8; i++) crc = crc & 0x8000 ? (crc << 1) ^ 0x8005 : crc << 1;
+    }
+    return crc;
+}
+
+//-----------------------------------------------
+//ANALYSIS
+
+//res[order..n) of fixed or LPC predictor
+static void residual(const Subframe* sf, const int32_t* x, unsigned n, int32_t* res) {
+    unsigned o = sf->order;
+    
+    if (sf->type == SUB_FIXED) {
+        static const int32_t fixed[MAX_FIXED+1][MAX_FIXED] = {
+            { 0,  0, 0,  0},
+            { 1,  0, 0,  0},
+            { 2, -1, 0,  0},
+            { 3, -3, 1,  0},
+            { 4, -6, 4, -1}
+        };
+        const int32_t* c = fixed[o];
+        
+        for (unsigned i=o; i < n; i++) {
+            int32_t pred = 0;
+            
+            for (unsigned j=0; j < o; j++) pred += c[j] * x[i-1-j];
+            res[i] = x[i] - pred;
+        }
+        return;
+    }
+    for (unsigned i=o; i < n; i++) {
+        int64_t sum = 0;
+        
+        for (unsigned j=0; j < o; j++) sum += (int64_t)sf->coefs[j] * x[i-1-j];
+        res[i] = x[i] - (int32_t)(sum >> sf->shift);
+    }
+}
+
+//bits of partitioned Rice coded res[order..n), best partition order and parameters go to sf
+//sum(u>>k) <= sum(u)>>k, so the cost never comes out lower than what gets written
+static uint64_t riceBits(const int32_t* res, unsigned n, Subframe* sf) {
+    uint64_t sums[1 << MAX_PART_ORDER];
+    uint64_t best = UINT64_MAX;
+    int maxOrder = 0;
+    
+    while (maxOrder < MAX_PART_ORDER && !(n % (2u << maxOrder)) && (n >> (maxOrder+1)) > (unsigned)sf->order) maxOrder++;
+    
+    for (unsigned j=0; j < (1u << maxOrder); j++) {
+        unsigned size = n >> maxOrder;
+        unsigned i    = j ? j*size : (unsigned)sf->order;
+        uint64_t sum  = 0;
+        
+        for (; i < (j+1)*size; i++) sum += ((uint32_t)res[i] << 1) ^ (uint32_t)(res[i] >> 31);
+        sums[j] = sum;
+    }
+    
+    for (int p=maxOrder; p >= 0; p--) {
+        int params[1 << MAX_PART_ORDER];
+        uint64_t bits = 2 + 4;  //coding method, partition order
+        
+        for (unsigned j=0; j < (1u << p); j++) {
+            unsigned num = (n >> p) - (j ? 0 : sf->order);
+            uint64_t partBest = UINT64_MAX;
+            
+            for (int k=0; k <= MAX_RICE; k++) {
+                uint64_t b = 4 + (uint64_t)num*(k+1) + (sums[j] >> k);
+                
+                if (b < partBest) {
+                    partBest  = b;
+                    params[j] = k;
+                }
+            }
+            bits += partBest;
+        }
+        if (bits < best) {
+            best = bits;
+            sf->partOrder = p;
+            memcpy(sf->params, params, (1u << p) * sizeof(int));
+        }
+        //merge pairs for next order down
+        for (unsigned j=0; j < (1u << p)/2; j++) sums[j] = sums[2*j] + sums[2*j+1];
+    }
+    return best;
+}
+
+static int quantizeLpc(const double* lpc, int order, Subframe* sf) {
+    const int32_t qMax = (1 << (LPC_PRECISION-1)) - 1;
+    double cMax = 0, err = 0;
+    int log2cMax;
+    
+    for (int i=0; i < order; i++) cMax = fabs(lpc[i]) > cMax ? fabs(lpc[i]) : cMax;
+    if (cMax <= 0) return 0;
+    frexp(cMax, &log2cMax);
+    sf->shift = LPC_PRECISION-1 - log2cMax;
+    if (sf->shift > 15) sf->shift = 15;
+    //coefficients too big, fixed predictors will do
+    if (sf->shift < 0) return 0;
+    
+    //rounding error carried over to next coefficient
+    for (int i=0; i < order; i++) {
+        long q;
+        
+        err += lpc[i] * (1 << sf->shift);
+        q = lround(err);
+        q = q > qMax ? qMax : (q < -qMax-1 ? -qMax-1 : q);
+        sf->coefs[i] = q;
+        err -= q;
+    }
+    return 1;
+}
+
+//Tukey(0.5) windowed autocorrelation, Levinson-Durbin, order picked by expected residual bits
+static void tryLpc(Scratch* s, const int32_t* x, unsigned n, int bps, Subframe* best) {
+    double autoc[MAX_LPC+1], lpc[MAX_LPC], coefs[MAX_LPC][MAX_LPC], errs[MAX_LPC];
+    double err, bestBits = HUGE_VAL;
+    unsigned taper = n / 4;
+    int maxOrder = n > MAX_LPC ? MAX_LPC : (int)n - 1;
+    Subframe sf;
+    uint64_t bits;
+    
+    if (maxOrder < 1) return;
+    for (unsigned i=0; i < n; i++) {
+        double w = 1;
+        
+        if (i < taper)         w = 0.5 - 0.5*cos(M_PI * i / taper);
+        else if (i >= n-taper) w = 0.5 - 0.5*cos(M_PI * (n-1-i) / taper);
+        s->win[i] = x[i] * w;
+    }
+    for (int l=0; l <= maxOrder; l++) {
+        double sum = 0;
+        
+        for (unsigned i=l; i < n; i++) sum += s->win[i] * s->win[i-l];
+        autoc[l] = sum;
+    }
+    if (autoc[0] <= 0) return;
+    
+    err = autoc[0];
+    for (int i=0; i < maxOrder; i++) {
+        double r = -autoc[i+1];
+        
+        for (int j=0; j < i; j++) r -= lpc[j] * autoc[i-j];
+        r /= err;
+        lpc[i] = r;
+        for (int j=0; j < i/2; j++) {
+            double tmp = lpc[j];
+            
+            lpc[j]     += r * lpc[i-1-j];
+            lpc[i-1-j] += r * tmp;
+        }
+        if (i & 1) lpc[i/2] += lpc[i/2] * r;
+        err *= 1 - r*r;
+        for (int j=0; j <= i; j++) coefs[i][j] = -lpc[j];
+        errs[i] = err > 0 ? err : 0;
+    }
+    
+    sf.type  = SUB_LPC;
+    sf.order = 0;
+    for (int o=1; o <= maxOrder; o++) {
+        double perRes = errs[o-1] > 0 ? 0.5 * log2(0.5 * errs[o-1] / n) : 0;
+        double b = (perRes > 0 ? perRes : 0) * (n - o) + o * (bps + LPC_PRECISION);
+        
+        if (b < bestBits) {
+            bestBits = b;
+            sf.order = o;
+        }
+    }
+    if (!quantizeLpc(coefs[sf.order-1], sf.order, &sf)) return;
+    
+    residual(&sf, x, n, s->res);
+    bits = 8 + sf.order*bps + 4 + 5 + sf.order*LPC_PRECISION + riceBits(s->res, n, &sf);
+    if (bits < best->bits) {
+        sf.bits   = bits;
+        sf.wasted = best->wasted;
+        *best = sf;
+    }
+}
+
+//picks cheapest subframe for in, shifted samples are left in s->x
+//useLpc 0 is a quick estimate for choosing stereo mode
+static void analyzeSubframe(Scratch* s, const int32_t* in, unsigned n, int bps, int useLpc, Subframe* best) {
+    uint32_t bitsOr = 0;
+    unsigned i;
+    
+    for (i=1; i < n && in[i] == in[0]; i++);
+    best->wasted = 0;
+    if (i == n) {
+        best->type = SUB_CONSTANT;
+        best->bits = 8 + bps;
+        return;
+    }
+    
+    for (i=0; i < n; i++) bitsOr |= (uint32_t)in[i];
+    while (!(bitsOr & 1)) {
+        bitsOr >>= 1;
+        best->wasted++;
+    }
+    for (i=0; i < n; i++) s->x[i] = in[i] >> best->wasted;
+    bps -= best->wasted;
+    
+    best->type = SUB_VERBATIM;
+    best->bits = 8 + best->wasted + (uint64_t)n*bps;
+    for (int o=0; o <= MAX_FIXED && (unsigned)o < n; o++) {
+        Subframe sf;
+        uint64_t bits;
+        
+        sf.type  = SUB_FIXED;
+        sf.order = o;
+        residual(&sf, s->x, n, s->res);
+        bits = 8 + best->wasted + o*bps + riceBits(s->res, n, &sf);
+        if (bits < best->bits) {
+            sf.bits   = bits;
+            sf.wasted = best->wasted;
+            *best = sf;
+        }
+    }
+    if (useLpc) tryLpc(s, s->x, n, bps, best);
+}
+
+static void writeSubframe(Scratch* s, const Subframe* sf, const int32_t* in, unsigned n, int bps, BitWriter* bw) {
+    static const int typeCode[] = {0x00, 0x01, 0x08, 0x20};
+    const int32_t* x = s->x;
+    
+    if (sf->type == SUB_CONSTANT) {
+        putBits(bw, 0, 8);
+        putBits(bw, in[0], bps);
+        return;
+    }
+    
+    putBits(bw, typeCode[sf->type] + (sf->type == SUB_VERBATIM ? 0 : sf->order - (sf->type == SUB_LPC)), 7);
+    putBits(bw, sf->wasted ? 1 : 0, 1);
+    if (sf->wasted) putBits(bw, 1, sf->wasted);
+    bps -= sf->wasted;
+    
+    if (sf->type == SUB_VERBATIM) {
+        for (unsigned i=0; i < n; i++) putBits(bw, x[i], bps);
+        return;
+    }
+    for (int i=0; i < sf->order; i++) putBits(bw, x[i], bps);
+    if (sf->type == SUB_LPC) {
+        putBits(bw, LPC_PRECISION-1, 4);
+        putBits(bw, sf->shift, 5);
+        for (int i=0; i < sf->order; i++) putBits(bw, sf->coefs[i], LPC_PRECISION);
+    }
+    
+    residual(sf, x, n, s->res);
+    putBits(bw, 0, 2);
+    putBits(bw, sf->partOrder, 4);
+    for (unsigned j=0; j < (1u << sf->partOrder); j++) {
+        unsigned size = n >> sf->partOrder;
+        
+        putBits(bw, sf->params[j], 4);
+        for (unsigned i = j ? j*size : (unsigned)sf->order; i < (j+1)*size; i++) putRice(bw, s->res[i], sf->params[j]);
+    }
+}
+
+//-----------------------------------------------
+//FRAMES
+
+static size_t encodeFrame(Scratch* s, const int16_t* pcm, unsigned n, int numChans, uint32_t frameNum, uint8_t* out) {
+    BitWriter bw = {out, 0, 0, 0};
+    Subframe sf[4];
+    int mode = numChans - 1;
+    int use[2] = {0, 1};
+    uint16_t crc;
+    
+    for (unsigned i=0; i < n; i++) {
+        for (int c=0; c < numChans; c++) s->ch[c][i] = pcm[i*numChans + c];
+    }
+    
+    //cheapest pair out of left, right, mid and side, by fixed predictor estimate
+    if (numChans == 2) {
+        uint64_t bits[4], bestBits;
+        
+        for (unsigned i=0; i < n; i++) {
+            s->ch[2][i] = (s->ch[0][i] + s->ch[1][i]) >> 1;
+            s->ch[3][i] =  s->ch[0][i] - s->ch[1][i];
+        }
+        for (int c=0; c < 4; c++) {
+            analyzeSubframe(s, s->ch[c], n, c == 3 ? 17 : 16, 0, &sf[c]);
+            bits[c] = sf[c].bits;
+        }
+        bestBits = bits[0] + bits[1];
+        if (bits[0] + bits[3] < bestBits) {
+            bestBits = bits[0] + bits[3];
+            mode = CH_LEFT_SIDE;
+            use[1] = 3;
+        }
+        if (bits[3] + bits[1] < bestBits) {
+            bestBits = bits[3] + bits[1];
+            mode = CH_RIGHT_SIDE;
+            use[0] = 3;
+            use[1] = 1;
+        }
+        if (bits[2] + bits[3] < bestBits) {
+            mode = CH_MID_SIDE;
+            use[0] = 2;
+            use[1] = 3;
+        }
+    }
+    
+    putBits(&bw, 0xFFF8, 16);                   //sync, fixed blocksize
+    putBits(&bw, n == FLAC_BLOCK ? 12 : 7, 4);  //4096 or 16-bit size at end of header
+    putBits(&bw, 0, 4);                         //rate from STREAMINFO
+    putBits(&bw, mode, 4);
+    putBits(&bw, 4, 3);                         //16 bits
+    putBits(&bw, 0, 1);
+    putUtf8(&bw, frameNum);
+    if (n != FLAC_BLOCK) putBits(&bw, n-1, 16);
+    putBits(&bw, crc8(out, bw.pos), 8);
+    
+    for (int c=0; c < numChans; c++) {
+        const int32_t* in = s->ch[use[c]];
+        int bps = use[c] == 3 ? 17 : 16;
+        Subframe best;
+        
+        analyzeSubframe(s, in, n, bps, 1, &best);
+        writeSubframe(s, &best, in, n, bps, &bw);
+    }
+    alignBits(&bw);
+    crc = crc16(out, bw.pos);
+    putBits(&bw, crc, 16);
+    return bw.pos;
+}
+
+static void flacTask(void* arg) {
+    FlacTask* t = arg;
+    Scratch* s;
+    
+    if (!(s = malloc(sizeof(Scratch)))) {
+        t->isFailed = 1;
+        return;
+    }
+    for (uint32_t b=t->first; b < t->first + t->num; b++) {
+        size_t pos = (size_t)b * FLAC_BLOCK;
+        unsigned n = t->len - pos < FLAC_BLOCK ? t->len - pos : FLAC_BLOCK;
+        
+        t->frameLen[b] = encodeFrame(s, t->pcm + pos*t->numChans, n, t->numChans, b,
+                                     t->out + (size_t)b * FRAME_BOUND(t->numChans));
+    }
+    free(s);
+}
+
+//-----------------------------------------------
+//METADATA
+
+static void putLE32(uint8_t* p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+//"fLaC" and every metadata block, NULL buf just counts bytes
+static size_t makeMeta(uint8_t* buf, const wg_FlacInfo* info, size_t len, size_t minFrame, size_t maxFrame) {
+    static const char vendor[] = "WG-Knife";
+    BitWriter bw = {buf, 0, 0, 0};
+    size_t vcLen = 4 + sizeof(vendor)-1 + 4;
+    uint32_t blockSize = len < FLAC_BLOCK ? (len < 16 ? 16 : len) : FLAC_BLOCK;
+    size_t pos;
+    
+    for (int i=0; i < info->numTags; i++) vcLen += 4 + strlen(info->tags[i]);
+    if (!buf) {
+        size_t total = 4 + 4+34 + 4+vcLen;
+        
+        for (int i=0; i < info->numRiff; i++) total += 4 + 4 + info->riff[i].len;
+        return total;
+    }
+    
+    memcpy(buf, "fLaC", 4);
+    bw.pos = 4;
+    putBits(&bw, 0, 8);     //STREAMINFO, never last
+    putBits(&bw, 34, 24);
+    putBits(&bw, blockSize, 16);
+    putBits(&bw, blockSize, 16);
+    putBits(&bw, minFrame, 24);
+    putBits(&bw, maxFrame, 24);
+    putBits(&bw, info->rate, 20);
+    putBits(&bw, info->numChans - 1, 3);
+    putBits(&bw, 16 - 1, 5);
+    putBits(&bw, (uint32_t)((uint64_t)len >> 32), 4);
+    putBits(&bw, (uint32_t)len, 32);
+    for (int i=0; i < 4; i++) putBits(&bw, 0, 32);
+    
+    putBits(&bw, (info->numRiff ? 0 : 0x80) | 4, 8);
+    putBits(&bw, vcLen, 24);
+    pos = bw.pos;
+    //Vorbis comment lengths are little endian
+    putLE32(buf + pos, sizeof(vendor)-1);
+    memcpy(buf + pos + 4, vendor, sizeof(vendor)-1);
+    pos += 4 + sizeof(vendor)-1;
+    putLE32(buf + pos, info->numTags);
+    pos += 4;
+    for (int i=0; i < info->numTags; i++) {
+        size_t tagLen = strlen(info->tags[i]);
+        
+        putLE32(buf + pos, tagLen);
+        memcpy(buf + pos + 4, info->tags[i], tagLen);
+        pos += 4 + tagLen;
+    }
+    
+    //one APPLICATION block per wav chunk
+    for (int i=0; i < info->numRiff; i++) {
+        bw.pos = pos;
+        putBits(&bw, (i == info->numRiff-1 ? 0x80 : 0) | 2, 8);
+        putBits(&bw, 4 + info->riff[i].len, 24);
+        memcpy(buf + bw.pos, "riff", 4);
+        memcpy(buf + bw.pos + 4, info->riff[i].buf, info->riff[i].len);
+        pos = bw.pos + 4 + info->riff[i].len;
+    }
+    return pos;
+}
+
+int flacWrite(int fd, const int16_t* pcm, size_t len, const wg_FlacInfo* info, wg_Pool* pool) {
+    wg_TaskGroup group = {0};
+    uint32_t numBlocks = (len + FLAC_BLOCK-1) / FLAC_BLOCK;
+    uint32_t numTasks  = (numBlocks + BLOCKS_PER_TASK-1) / BLOCKS_PER_TASK;
+    size_t bound = FRAME_BOUND(info->numChans);
+    size_t minFrame = SIZE_MAX, maxFrame = 0, metaLen;
+    uint8_t* out = NULL;
+    uint8_t* meta = NULL;
+    size_t* frameLen = NULL;
+    FlacTask* tasks = NULL;
+    wg_IoVec vec[64];
+    int nVec = 0;
+    
+    if (!(out      = malloc(numBlocks * bound + 1))) goto OOM;
+    if (!(frameLen = malloc((numBlocks + 1) * sizeof(size_t)))) goto OOM;
+    if (!(tasks    = calloc(numTasks + 1, sizeof(FlacTask)))) goto OOM;
+    
+    for (uint32_t i=0; i < numTasks; i++) {
+        FlacTask* t = &tasks[i];
+        
+        t->pcm      = pcm;
+        t->len      = len;
+        t->numChans = info->numChans;
+        t->first    = i * BLOCKS_PER_TASK;
+        t->num      = numBlocks - t->first < BLOCKS_PER_TASK ? numBlocks - t->first : BLOCKS_PER_TASK;
+        t->out      = out;
+        t->frameLen = frameLen;
+        if (!pool || !poolSubmitGroup(pool, &group, flacTask, t)) flacTask(t);
+    }
+    if (pool) poolWaitGroup(pool, &group);
+    for (uint32_t i=0; i < numTasks; i++) {
+        if (tasks[i].isFailed) goto OOM;
+    }
+    
+    for (uint32_t b=0; b < numBlocks; b++) {
+        if (frameLen[b] < minFrame) minFrame = frameLen[b];
+        if (frameLen[b] > maxFrame) maxFrame = frameLen[b];
+    }
+    if (!numBlocks) minFrame = 0;
+    if (!(meta = malloc(makeMeta(NULL, info, len, 0, 0)))) goto OOM;
+    metaLen = makeMeta(meta, info, len, minFrame, maxFrame);
+    
+    vec[nVec].buf = meta;
+    vec[nVec].len = metaLen;
+    nVec++;
+    for (uint32_t b=0; b < numBlocks; b++) {
+        vec[nVec].buf = out + b*bound;
+        vec[nVec].len = frameLen[b];
+        if (++nVec < 64 && b+1 < numBlocks) continue;
+        if (!fileWriteVec(fd, vec, nVec)) goto ERR;
+        nVec = 0;
+    }
+    if (nVec && !fileWriteVec(fd, vec, nVec)) goto ERR;
+    
+    free(out);
+    free(frameLen);
+    free(tasks);
+    free(meta);
+    return 1;
+    OOM:
+        printf("flacWrite(): Out of memory!\n");
+    ERR:
+        free(out);
+        free(frameLen);
+        free(tasks);
+        free(meta);
+        return 0;
+}
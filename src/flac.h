@@ -0,0 +1,28 @@
+#ifndef FLAC_H
+#define FLAC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+#include "pool.h"
+
+//FLAC encoder for whole 16-bit samples, 1 or 2 channels
+//fixed 4096 frame blocks, every block is encoded on its own so they go to the pool
+//fixed and LPC predictors, stereo decorrelation, partitioned Rice residuals
+//MD5 in STREAMINFO is left unset, the format allows that
+
+typedef struct {
+    uint32_t        rate;
+    int             numChans;
+    const char**    tags;    //"NAME=value" Vorbis comments
+    int             numTags;
+    const wg_IoVec* riff;    //chunks of the same wav, kept like flac --keep-foreign-metadata does
+    int             numRiff;
+} wg_FlacInfo;
+
+//pcm is len interleaved frames, pool can be NULL
+//from inside a pool task is fine, waiting task helps encode
+int flacWrite(int fd, const int16_t* pcm, size_t len, const wg_FlacInfo* info, wg_Pool* pool);
+
+#endif
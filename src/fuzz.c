@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "common.h"
+#include "bank.h"
+#include "decode.h"
+
+//fuzzing harness for libwgbank, bank.c and decode.c are all it exercises
+//every input is walked twice when bankOpen() says it's valid: once on the unchecked
+//fast paths and once with the checks forced back on, both have to see the same bank
+//bankStructLen() bytes of it have to validate the same as all of it
+//
+//libFuzzer with ASan, corpus is any number of .TPD files:
+//  clang -fsanitize=fuzzer,address -DWG_LIBFUZZER -o wgfuzz fuzz.c bank.c decode.c common.c
+//without it, main() below mutates one bank over and over, -fsanitize=address still helps
+
+#define FUZZ_DECODE (4096) //bytes decoded from the start of every sample
+
+static void fuzzFail(const char* what) {
+    fprintf(stderr, "fuzz: %s\n", what);
+    abort();
+}
+
+//touches everything a bank user can reach, returns a sum of what it saw
+static uint64_t walkBank(const wg_Bank* bank) {
+    static int16_t pcm[FUZZ_DECODE];
+    wg_BankIter it;
+    uint64_t sum = bankDataOff(bank);
+    
+    bankIterInit(&it, bank, WG_ITER_DUMMIES);
+    while (bankNextPatch(&it)) {
+        sum = sum*31 + it.patchOff + it.patch->volume + it.patch->splitNum;
+        if (it.drums) sum += it.drums->tab[0] + it.drums->tab[127];
+        
+        while (bankNextSplit(&it)) {
+            uint8_t* data;
+            size_t len;
+            
+            sum = sum*31 + it.splitOff + it.split->rangeEnd;
+            if (!it.smpHdr) {
+                if (bank->isValid) fuzzFail("valid bank, split without sample header");
+                continue;
+            }
+            sum += it.smpHdr->volume + it.smpHdr->offLoop;
+            if (!(data = bankSampleData(bank, it.smpHdr, &len))) {
+                if (bank->isValid && bank->len == bank->fileLen) fuzzFail("valid bank, sample data doesn't fit");
+                continue;
+            }
+            if (!len) continue;
+            wg_decode(data, pcm, len < FUZZ_DECODE ? len : FUZZ_DECODE);
+            sum = sum*31 + (uint16_t)pcm[0] + data[len-1];
+        }
+    }
+    return sum;
+}
+
+//buf must hold exactly len bytes so ASan sees every overrun
+static int fuzzBank(uint8_t* buf, size_t len) {
+    wg_Bank bank, checked, part;
+    size_t partLen;
+    uint64_t sum;
+    
+    if (!bankOpen(&bank, buf, len)) return 0;
+    sum = walkBank(&bank);
+    
+    //structures only, like loadBankHead() reads them, has to come out just as valid
+    partLen = bankStructLen(&bank);
+    if (partLen < len) {
+        uint8_t* head = malloc(partLen);
+        
+        if (!head) return 0;
+        memcpy(head, buf, partLen);
+        if (!bankOpenPart(&part, head, partLen, len) || part.isValid != bank.isValid) fuzzFail("structures alone don't validate the same");
+        walkBank(&part);
+        free(head);
+    }
+    if (!bank.isValid) return 0;
+    
+    checked = bank;
+    checked.isValid = 0;
+    if (walkBank(&checked) != sum) fuzzFail("fast and checked walks differ");
+    return 1;
+}
+
+#ifdef WG_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    uint8_t* buf = malloc(size ? size : 1);
+    
+    if (!buf) return 0;
+    memcpy(buf, data, size);
+    fuzzBank(buf, size);
+    free(buf);
+    return 0;
+}
+
+#else
+
+static uint32_t seed = 0x2545F491;
+
+static uint32_t fuzzRand(void) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+//offsets that tend to be just in or just out
+static uint32_t fuzzValue(size_t len) {
+    switch (fuzzRand() % 8) {
+        case 0:  return 0;
+        case 1:  return len - 1;
+        case 2:  return len;
+        case 3:  return len + 1;
+        case 4:  return 0x7FFFFFFF;
+        case 5:  return 0xFFFFFFFF;
+        case 6:  return len - fuzzRand() % 64;
+        default: return fuzzRand() % (len + 1);
+    }
+}
+
+//offsets and counts of the seed bank, the fields worth hitting on purpose
+typedef struct {
+    uint32_t off;
+    int      size;
+} Field;
+
+#define MAX_FIELDS (1<<16)
+static Field fields[MAX_FIELDS];
+static unsigned int numFields;
+
+static size_t fieldsEnd;
+
+//only what gets restored between runs
+static void addField(uint32_t off, int size) {
+    if (numFields < MAX_FIELDS && off + size <= fieldsEnd) fields[numFields++] = (Field){off, size};
+}
+
+static void findFields(const wg_Bank* bank, size_t dataOff) {
+    wg_BankIter it;
+    
+    fieldsEnd = dataOff;
+    for (int i=0; i < 256; i++) addField(MIDIMAP_OFF + i*4, 4);
+    bankIterInit(&it, bank, WG_ITER_DUMMIES);
+    while (bankNextPatch(&it)) {
+        addField(it.patchOff + offsetof(wg_Patch, isDrumKit), 1);
+        addField(it.patchOff + offsetof(wg_Patch, splitNum), 2);
+        while (bankNextSplit(&it)) {
+            uint32_t hdrOff = it.split->smpHeadOff;
+            
+            addField(it.splitOff + offsetof(wg_Split, smpHeadOff), 4);
+            addField(hdrOff + offsetof(wg_SampleHdr, offStart), 4);
+            addField(hdrOff + offsetof(wg_SampleHdr, offLoop), 4);
+            addField(hdrOff + offsetof(wg_SampleHdr, offEnd), 4);
+        }
+    }
+}
+
+//structures are where the offsets are, all mutations but cuts go there
+static size_t mutate(uint8_t* buf, size_t len, size_t dataOff) {
+    int num = 1 + fuzzRand() % 8;
+    
+    for (int i=0; i < num; i++) {
+        size_t off = MIDIMAP_OFF + fuzzRand() % (dataOff - MIDIMAP_OFF);
+        Field* f;
+        uint32_t v;
+        
+        switch (fuzzRand() % 4) {
+            case 0:
+                buf[off] ^= 1 << (fuzzRand() % 8);
+                break;
+            case 1:
+                buf[off] = fuzzRand();
+                break;
+            case 2:
+                f = &fields[fuzzRand() % numFields];
+                v = f->size == 4 ? fuzzValue(len) : fuzzRand();
+                memcpy(buf + f->off, &v, f->size);
+                break;
+            default:
+                //cut into structures or sample data
+                if (fuzzRand() % 4 == 0) len = fuzzRand() % (len + 1);
+                break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char *argv[]) {
+    uint8_t *orig, *buf;
+    size_t origLen, dataOff;
+    unsigned long runs = 10000;
+    unsigned long numValid = 0, numOpen = 0;
+    wg_Bank bank;
+    double t;
+    
+    if (argc < 2) {
+        printf(
+            "usage:\n"
+            "  wgfuzz BANKFILE [RUNS] [SEED]\n"
+            "  Mutates BANKFILE RUNS times, default is 10000, and walks every result.\n"
+            "  Aborts on the first one that breaks a promise of bankOpen().\n"
+        );
+        return 1;
+    }
+    if (argc > 2) runs = strtoul(argv[2], NULL, 0);
+    if (argc > 3) seed = strtoul(argv[3], NULL, 0) | 1;
+    if (!(orig = loadfile(argv[1], &origLen))) return 2;
+    if (!bankOpen(&bank, orig, origLen) || !bank.isValid) {
+        printf("Seed bank has to be a valid one.\n");
+        free(orig);
+        return 3;
+    }
+    dataOff = bankDataOff(&bank);
+    if (dataOff <= MIDIMAP_OFF) dataOff = origLen;
+    findFields(&bank, dataOff);
+    
+    if (!(buf = malloc(origLen))) return 2;
+    memcpy(buf, orig, origLen);
+    
+    t = getTime();
+    for (unsigned long r=0; r < runs; r++) {
+        size_t len;
+        
+        //mutations stay below dataOff, that's all that needs restoring
+        memcpy(buf, orig, dataOff);
+        len = mutate(buf, origLen, dataOff);
+        if (len < origLen) {
+            //exact size copy, so a read past len is a read past the block
+            uint8_t* cut = malloc(len ? len : 1);
+            
+            if (!cut) return 2;
+            memcpy(cut, buf, len);
+            numOpen  += bankOpen(&bank, cut, len);
+            numValid += fuzzBank(cut, len);
+            free(cut);
+        } else {
+            numOpen  += bankOpen(&bank, buf, len);
+            numValid += fuzzBank(buf, len);
+        }
+    }
+    printf("%lu runs, %lu opened, %lu valid, %.1f ms\n", runs, numOpen, numValid, (getTime() - t) * 1000);
+    
+    free(buf);
+    free(orig);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "hash.h"
+
+#define P1 0x9E3779B185EBCA87ULL
+#define P2 0xC2B2AE3D27D4EB4FULL
+#define P3 0x165667B19E3779F9ULL
+#define P4 0x85EBCA77C2B2AE63ULL
+#define P5 0x27D4EB2F165667C5ULL
+
+#define ROTL(X, R) (((X) << (R)) | ((X) >> (64 - (R))))
+
+//little endian loads, memcpy keeps unaligned reads legal
+static uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t round64(uint64_t acc, uint64_t in) {
+    acc += in * P2;
+    acc  = ROTL(acc, 31);
+    return acc * P1;
+}
+
+static uint64_t merge64(uint64_t acc, uint64_t v) {
+    acc ^= round64(0, v);
+    return acc * P1 + P4;
+}
+
+uint64_t wg_hash64(const void* buf, size_t len, uint64_t seed) {
+    const uint8_t* p   = buf;
+    const uint8_t* end = p + len;
+    uint64_t h;
+    
+    if (len >= 32) {
+        uint64_t v1 = seed + P1 + P2;
+        uint64_t v2 = seed + P2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - P1;
+        
+        //four independent lanes, 32 bytes per step
+        do {
+            v1 = round64(v1, read64(p));
+            v2 = round64(v2, read64(p+8));
+            v3 = round64(v3, read64(p+16));
+            v4 = round64(v4, read64(p+24));
+            p += 32;
+        } while (end - p >= 32);
+        
+        h = ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+        h = merge64(h, v1);
+        h = merge64(h, v2);
+        h = merge64(h, v3);
+        h = merge64(h, v4);
+    } else {
+        h = seed + P5;
+    }
+    h += len;
+    
+    for (; end - p >= 8; p += 8) {
+        h ^= round64(0, read64(p));
+        h  = ROTL(h, 27) * P1 + P4;
+    }
+    if (end - p >= 4) {
+        h ^= (uint64_t)read32(p) * P1;
+        h  = ROTL(h, 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * P5;
+        h  = ROTL(h, 11) * P1;
+    }
+    
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
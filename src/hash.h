@@ -0,0 +1,12 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//fast non-cryptographic 64-bit hash, XXH64 algorithm, same values as reference xxhash
+//for telling sample data apart, not for anything an attacker controls
+
+uint64_t wg_hash64(const void* buf, size_t len, uint64_t seed);
+
+#endif
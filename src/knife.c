@@ -0,0 +1,2010 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include <stdarg.h>
+
+#include "common.h"
+#include "wgbank.h"
+#include "wavfile.h"
+#include "names.h"
+#include "knife.h"
+#include "decode.h"
+#include "pool.h"
+#include "synth.h"
+#include "midifile.h"
+#include "wgenc.h"
+#include "outbuf.h"
+#include "bank.h"
+#include "hash.h"
+#include "sf2file.h"
+#include "flac.h"
+#include "manifest.h"
+#include "aio.h"
+
+#define PATNAMES b00A5_patNames
+
+int checkWgbankHeader(void* base, size_t len) {
+    wg_BankHeader* head;
+    
+    //magic isn't terminated, strcmp() used to run into the size field and never matched
+    head = base;
+    if (len < sizeof(wg_BankHeader) || memcmp(head->magic, "WgTPDHdr", sizeof(head->magic))) return 0;
+    if ((head->fileSizeAndFlag & 0x00FFFFFF) > len) return 0;
+    
+    return 1;
+}
+
+//first read is enough for every bank seen so far
+#define HEAD_READ (64<<10)
+int loadBankHead(char* name, MappedFile* mf, size_t* fileLen) {
+    uint8_t* buf = NULL;
+    size_t have = 0, want;
+    uint64_t size;
+    wg_Bank bank;
+    int fd;
+    
+    mf->base     = NULL;
+    mf->len      = 0;
+    mf->isMapped = 0;
+    if ((fd = fileOpenRead(name, &size)) < 0 || size > SIZE_MAX) goto ERR;
+    want = size < HEAD_READ ? size : HEAD_READ;
+    
+    //structures can point further in, read up to there and look again
+    for (;;) {
+        uint8_t* tmp;
+        
+        if (!(tmp = realloc(buf, want ? want : 1))) goto OOM;
+        buf = tmp;
+        if (!fileReadAt(fd, buf + have, want - have, have)) goto ERR;
+        have = want;
+        bankOpenPart(&bank, buf, have, size);
+        want = bankStructLen(&bank);
+        if (want <= have || have == size) break;
+        //at least double, so banks with structures all over take few rounds
+        if (want < have*2) want = have*2;
+        if (want > size) want = size;
+    }
+    
+    fileClose(fd);
+    mf->base = buf;
+    mf->len  = have;
+    *fileLen = size;
+    return 1;
+    OOM:
+        printf("loadBankHead(): Out of memory!\n");
+    ERR:
+        if (fd >= 0) fileClose(fd);
+        free(buf);
+        return 0;
+}
+
+wg_NameIndex smpNameIdx;
+
+void getSampleName(char* outName, size_t size, wg_SampleHdr* smpHdr, const wg_NameIndex* names) {
+    const char* name = nameIndexFind(names, smpHdr->offStart, smpHdr->offEnd);
+    
+    if (name) {
+        snprintf(outName, size, "%s", name);
+        return;
+    }
+    
+    snprintf(outName, size, "%010u-%010u-%08X-%08X", smpHdr->offStart, smpHdr->offEnd, smpHdr->offStart, smpHdr->offEnd);
+}
+
+#define BITS_PER_SAMPLE (16)
+#define WAV_CHUNK       (16384) //samples decoded per write
+//wav headers and smpl chunk for sample, returns length of smpl part
+static size_t makeWavChunks(wg_SampleHdr* smpHdr, int isTuned, const wg_Resampler* rs, wav_PcmHead* wHead, wav_SmplTail* wTail) {
+    int numLoops     = smpHdr->offLoop?1:0;
+    int numChannels  = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+    uint32_t rate    = rs ? rs->outRate : SAMPLE_RATE;
+    size_t smpSize   = numChannels * BITS_PER_SAMPLE/8;
+    size_t inLen     = (smpHdr->offEnd - smpHdr->offStart) / numChannels;
+    size_t smpLen    = rs ? resampleLen(rs, inLen) : inLen;
+    size_t outLen    = smpLen * smpSize;
+    uint32_t loopStart = (smpHdr->offLoop - smpHdr->offStart) / numChannels;
+    size_t tailLen   = sizeof(wav_SmplHeader) + numLoops*sizeof(wav_SampleLoop);
+    
+    wHead->file.id_RIFF    = IFFID_RIFF;
+    wHead->file.filesize   = 4 + sizeof(wav_FormatHeader) + sizeof(wav_DataHeader);
+    wHead->file.filesize  += tailLen + outLen;
+    wHead->file.id_WAVE    = IFFID_WAVE;
+    
+    wHead->form.id_fmt         = IFFID_fmt;
+    wHead->form.hdrlen         = 16;
+    wHead->form.format         = 1;
+    wHead->form.channels       = numChannels;
+    wHead->form.freqHz         = rate;
+    wHead->form.bytessec       = rate * smpSize;
+    wHead->form.samplesize     = smpSize;
+    wHead->form.bitspersample  = BITS_PER_SAMPLE;
+    
+    wHead->data.id_data = IFFID_data;
+    wHead->data.length  = outLen;
+    
+    uint32_t absTune = 49*0x100 - smpHdr->tuning;
+    
+    wTail->smpl.smpl_id         = IFFID_smpl;
+    wTail->smpl.smpl_len        = sizeof(wav_SmplHeader) + sizeof(wav_SampleLoop) - 4;
+    wTail->smpl.dwManufacturer  = 0;
+    wTail->smpl.dwProduct       = 0;
+    wTail->smpl.dwSamplePeriod  = 1000000000 / rate;
+    //not quite correct
+    wTail->smpl.dwBaseNote      = !isTuned ? 60 :  (absTune) >> 8;
+    //positive only pitch correction
+    wTail->smpl.dwPitchFraction = !isTuned ?  0 :  (~absTune) << 24;
+    wTail->smpl.dwSMPTEFormat   = 0;
+    wTail->smpl.dwSMPTEOffset   = 0;
+    wTail->smpl.dwSampleLoops   = numLoops; // number of Loop structs
+    wTail->smpl.cbSamplerData   = 0;
+    
+    if (wTail->smpl.dwPitchFraction && smpHdr->tuning < 0) wTail->smpl.dwBaseNote--;
+    
+    if (numLoops) {
+        wTail->loop.dwIdentifier   = 0x00000000;
+        wTail->loop.dwLoopType     = 0;
+        wTail->loop.dwLoopStart    = rs ? resamplePos(rs, loopStart) : loopStart;
+        wTail->loop.dwLoopEnd      = smpLen;
+        wTail->loop.dwFraction     = 0;
+        wTail->loop.dwPlayCount    = 0;
+    }
+    return tailLen;
+}
+
+//whole sample as interleaved int16, resampled if rs isn't NULL
+//cached is the sample already decoded, NULL decodes it from base
+static int16_t* decodeSample(wg_SampleHdr* smpHdr, void* base, const int16_t* cached, const wg_Resampler* rs, size_t* outFrames) {
+    int numChannels = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+    size_t inLen    = (smpHdr->offEnd - smpHdr->offStart) / numChannels;
+    uint32_t loopStart = (smpHdr->offLoop - smpHdr->offStart) / numChannels;
+    uint8_t* inBuf  = (uint8_t*)base + smpHdr->offStart;
+    int16_t* decoded = NULL;
+    int16_t* pcm = NULL;
+    
+    *outFrames = rs ? resampleLen(rs, inLen) : inLen;
+    if (!cached || !rs) {
+        if (!(decoded = malloc((inLen * numChannels + 1) * sizeof(int16_t)))) return NULL;
+        if (cached) {
+            memcpy(decoded, cached, inLen * numChannels * sizeof(int16_t));
+        } else {
+            wg_decode(inBuf, decoded, inLen * numChannels);
+        }
+        if (!rs) return decoded;
+        cached = decoded;
+    }
+    
+    if ((pcm = malloc(*outFrames * numChannels * sizeof(int16_t) + 1))) {
+        if (!resample(rs, cached, inLen, numChannels, smpHdr->offLoop ? loopStart : SIZE_MAX, pcm)) {
+            free(pcm);
+            pcm = NULL;
+        }
+    }
+    free(decoded);
+    return pcm;
+}
+
+//whole sample at once, straight from cache when it's there and wanted at bank rate
+//*owned is NULL or what has to be freed once done with it
+static const int16_t* wholeSample(wg_SampleHdr* smpHdr, void* base, const wg_PcmCache* cache, const wg_Resampler* rs, size_t* outFrames, int16_t** owned) {
+    const int16_t* cached = pcmCacheFind(cache, smpHdr);
+    
+    *owned = NULL;
+    if (cached && !rs) {
+        *outFrames = (smpHdr->offEnd - smpHdr->offStart) / (smpHdr->flags & WG_FLG_STEREO ? 2 : 1);
+        return cached;
+    }
+    return *owned = decodeSample(smpHdr, base, cached, rs, outFrames);
+}
+
+int writeWav(wg_SampleHdr* smpHdr, void* base, const wg_PcmCache* cache, char* dest, int isTuned, const wg_Resampler* rs) {
+    wav_PcmHead  wHead;
+    wav_SmplTail wTail;
+    wg_IoVec vec[3];
+    int16_t outBuf[WAV_CHUNK];
+    const int16_t* whole = NULL;
+    int16_t* pcm = NULL;
+    uint8_t* inBuf;
+    size_t smpLen, tailLen;
+    int fout;
+    
+    int numChannels  = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+    
+    inBuf   = (uint8_t*)((char*)base + smpHdr->offStart);
+    tailLen = makeWavChunks(smpHdr, isTuned, rs, &wHead, &wTail);
+    smpLen  = (smpHdr->offEnd - smpHdr->offStart) / numChannels;
+    
+    if ((rs || pcmCacheFind(cache, smpHdr)) && !(whole = wholeSample(smpHdr, base, cache, rs, &smpLen, &pcm))) {
+        printf("writeWav(): Out of memory!\n");
+        return 0;
+    }
+    
+    if ((fout = fileCreate(dest)) < 0) goto ERR;
+    
+    //resampled data was made in one go, cached one is all there already
+    if (whole) {
+        vec[0].buf = &wHead;
+        vec[0].len = sizeof(wav_PcmHead);
+        vec[1].buf = whole;
+        vec[1].len = wHead.data.length;
+        vec[2].buf = &wTail;
+        vec[2].len = tailLen;
+        if (!fileWriteVec(fout, vec, 3)) goto ERR;
+        free(pcm);
+        return fileClose(fout);
+    }
+    
+    //headers ride along with first chunk, smpl with the last one
+    for (size_t done = 0, total = smpLen * numChannels;;) {
+        size_t num = total - done < WAV_CHUNK ? total - done : WAV_CHUNK;
+        int nVec = 0;
+        
+        if (!done) {
+            vec[nVec].buf = &wHead;
+            vec[nVec].len = sizeof(wav_PcmHead);
+            nVec++;
+        }
+        wg_decode(inBuf + done, outBuf, num);
+        vec[nVec].buf = outBuf;
+        vec[nVec].len = num * sizeof(int16_t);
+        nVec++;
+        done += num;
+        if (done == total) {
+            vec[nVec].buf = &wTail;
+            vec[nVec].len = tailLen;
+            nVec++;
+        }
+        
+        if (!fileWriteVec(fout, vec, nVec)) goto ERR;
+        if (done == total) break;
+    }
+    
+    return fileClose(fout);
+    ERR:
+        if (fout >= 0) fileClose(fout);
+        free(pcm);
+        return 0;
+}
+
+//same sample as writeWav() would write, smpl and other wav chunks ride along as foreign metadata
+//loop is also in LOOPSTART/LOOPLENGTH tags, most samplers reading FLAC look for those
+//frames get encoded on pool
+int writeFlac(wg_SampleHdr* smpHdr, void* base, const wg_PcmCache* cache, char* dest, int isTuned, const wg_Resampler* rs, wg_Pool* pool) {
+    wav_PcmHead  wHead;
+    wav_SmplTail wTail;
+    wg_IoVec riff[4];
+    wg_FlacInfo info;
+    char loopTags[2][32];
+    const char* tags[2] = {loopTags[0], loopTags[1]};
+    const int16_t* whole;
+    int16_t* pcm;
+    size_t smpLen;
+    int fout = -1;
+    
+    riff[3].len = makeWavChunks(smpHdr, isTuned, rs, &wHead, &wTail);
+    riff[0].buf = &wHead.file;
+    riff[0].len = sizeof(wav_FileHeader);
+    riff[1].buf = &wHead.form;
+    riff[1].len = sizeof(wav_FormatHeader);
+    riff[2].buf = &wHead.data;
+    riff[2].len = sizeof(wav_DataHeader);
+    riff[3].buf = &wTail;
+    
+    if (!(whole = wholeSample(smpHdr, base, cache, rs, &smpLen, &pcm))) {
+        printf("writeFlac(): Out of memory!\n");
+        return 0;
+    }
+    
+    info.rate     = wHead.form.freqHz;
+    info.numChans = wHead.form.channels;
+    info.tags     = tags;
+    info.numTags  = 0;
+    info.riff     = riff;
+    info.numRiff  = 4;
+    //loop is only filled in for samples that loop
+    if (wTail.smpl.dwSampleLoops) {
+        sprintf(loopTags[0], "LOOPSTART=%u",  wTail.loop.dwLoopStart);
+        sprintf(loopTags[1], "LOOPLENGTH=%u", wTail.loop.dwLoopEnd - wTail.loop.dwLoopStart);
+        info.numTags = 2;
+    }
+    
+    if ((fout = fileCreate(dest)) < 0) goto ERR;
+    if (!flacWrite(fout, whole, smpLen, &info, pool)) goto ERR;
+    free(pcm);
+    return fileClose(fout);
+    ERR:
+        if (fout >= 0) fileClose(fout);
+        free(pcm);
+        return 0;
+}
+
+//-----------------------------------------------
+//DESCRIBE
+
+#define TABWIDTH 4
+#define obTabs(OB, N) obSpaces(OB, TABWIDTH*(N))
+
+void describeUnkBytes(int nTabs, wg_OutBuf* ob, void* base, void* p, size_t len) {
+    unsigned int off = (char*)p - (char*)base;
+    
+    for (unsigned int i=0; i<len; i++) {
+        uint8_t u8 = ((uint8_t*)p)[i]; 
+        
+        obTabs(ob, nTabs);
+        obStr(ob, "???? ");  obHex(ob, u8, 2);
+        obStr(ob, "h, U8 "); obUint(ob, u8, 3);
+        obStr(ob, ", I8 ");  obInt(ob, (int8_t)u8, 4);
+        obStr(ob, " ");
+        if (!((off+i)&1) && len-i >= 2) {
+            uint16_t u16 = *(uint16_t*)((char*)p+i);
+            
+            obStr(ob, "-┬-> ");
+            obHex(ob, u16, 4);
+            obStr(ob, "h, U16 "); obUint(ob, u16, 5);
+            obStr(ob, ", I16 ");  obInt(ob, (int16_t)u16, 6);
+        } else {
+            if (i != 0) obStr(ob, "-┘");
+        }
+        obStr(ob, "\n");
+    }
+}
+
+//"TABS* LABEL: NUM\n", most common line of them all
+static void describeUint(int nTabs, wg_OutBuf* ob, const char* label, uint32_t v) {
+    obTabs(ob, nTabs);
+    obStr(ob, label);
+    obUint(ob, v, 0);
+    obStr(ob, "\n");
+}
+
+static void describeOff(int nTabs, wg_OutBuf* ob, const char* label, uint32_t v) {
+    obTabs(ob, nTabs);
+    obStr(ob, label);
+    obHex(ob, v, 8);
+    obStr(ob, "h\n");
+}
+
+static void describeSemis(int nTabs, wg_OutBuf* ob, const char* label, int16_t v) {
+    obTabs(ob, nTabs);
+    obStr(ob, label);
+    obFix8(ob, v);
+    obStr(ob, " semitones\n");
+}
+
+void describeSampleHdr(int nTabs, wg_OutBuf* ob, void* base, wg_SampleHdr* p) {
+    char sampleName[SAMPLE_NAME_LEN];
+    char* flagNameTable[8] = {
+        "WG_FLG_BIT1", "WG_FLG_BIT2",    "WG_FLG_FIXEDNOTE", "WG_FLG_BIT4",
+        "WG_FLG_BIT5", "WG_FLG_STEREO",  "WG_FLG_ATONAL",    "WG_FLG_BIT8"
+    };
+    uint32_t lenLoop = (p->offEnd - p->offLoop)  / (p->flags & WG_FLG_STEREO ? 2 : 1);
+    uint32_t lenSamp = (p->offEnd - p->offStart) / (p->flags & WG_FLG_STEREO ? 2 : 1);
+    
+    getSampleName(sampleName, sizeof(sampleName), p, &smpNameIdx);
+    obTabs(ob, nTabs);
+    obStr(ob, "Sample known as \"");
+    obStr(ob, sampleName);
+    obStr(ob, ".wav\"\n");
+    
+    describeOff(nTabs, ob, "* U32 Sample start: ", p->offStart);
+    obTabs(ob, nTabs);
+    if (!p->offLoop) {
+        obStr(ob, "* U32 Sample loop:  DISABLED\n");
+    } else {
+        obStr(ob, "* U32 Sample loop:  "); obHex(ob, p->offLoop, 8);
+        obStr(ob, "h (loop len ");         obUint(ob, lenLoop, 0);
+        obStr(ob, " samples)\n");
+    }
+    obTabs(ob, nTabs);
+    obStr(ob, "* U32 Sample end:   "); obHex(ob, p->offEnd, 8);
+    obStr(ob, "h (samp len ");         obUint(ob, lenSamp, 0);
+    obStr(ob, " samples)\n");
+    describeUint(nTabs, ob, "* U16 Volume: ", p->volume);
+    describeSemis(nTabs, ob, "* I16 Relative tuning: ", p->tuning);
+    describeUint(nTabs, ob, "* U16 Envelope attack  len:    ", p->lenAttack);
+    describeUint(nTabs, ob, "* U16 Envelope decay   len:    ", p->lenDecay);
+    describeUint(nTabs, ob, "* U16 Envelope sustain volume: ", p->volSustain);
+    describeUint(nTabs, ob, "* U16 Envelope release len:    ", p->lenRelease);
+    obTabs(ob, nTabs);
+    obStr(ob, "* U8  Flags:\n");
+    for (unsigned int i=0; i<8; i++) {
+        if (!(p->flags & (1<<i))) continue;
+        obTabs(ob, nTabs+1);
+        obStr(ob, flagNameTable[i]);
+        obStr(ob, "\n");
+    }
+    describeUnkBytes(nTabs, ob, base, &p->unk01, 3);
+}
+
+void describeSplit(int nTabs, wg_OutBuf* ob, void* base, wg_Split* p) {
+    obTabs(ob, nTabs);
+    obStr(ob, "* 2xU8 Note range: ");
+    obUint(ob, p->rangeStart, 0);
+    obStr(ob, "-");
+    obUint(ob, p->rangeEnd, 0);
+    obStr(ob, "\n");
+    describeUint(nTabs, ob, "* U8   Drum map index: ", p->mapIndex);
+    obTabs(ob, nTabs);
+    obStr(ob, "* I8   Panning: ");
+    obInt(ob, p->pan, 0);
+    obStr(ob, "\n");
+    describeUnkBytes(nTabs, ob, base, &p->unk01, 2);            
+    describeSemis(nTabs, ob, "* I16  Relative tuning: ", p->tuning);
+    describeOff(nTabs, ob, "* U32  Sample header offset: ", p->smpHeadOff);
+    obStr(ob, "\n");
+}
+
+void describePatch(int nTabs, wg_OutBuf* ob, void* base, wg_Patch* p) {
+    wg_DrumTable* dmap   = (wg_DrumTable*)((char*)p + sizeof(wg_Patch));
+    
+    if (!p->volume) {
+        obTabs(ob, nTabs);
+        obStr(ob, "DUMMY PATCH\n");
+        return;
+    }
+    
+    describeUint(nTabs, ob, "* U16 Volume: ", p->volume);
+    describeSemis(nTabs, ob, "* I16 Relative tuning: ", p->tuning);
+    describeSemis(nTabs, ob, "* I16 Pitch randomization: ", p->randPitch);
+    describeUint(nTabs, ob, "* U8  Is drumkit: ", p->isDrumKit);
+    describeUnkBytes(nTabs, ob, base, &p->unk01, 7);
+    describeUint(nTabs, ob, "* U16 Split number: ", p->splitNum);
+    
+    if (p->isDrumKit) {
+        obTabs(ob, nTabs);
+        obStr(ob, "Drum map:");
+        for (unsigned int i=0; i<128; i++) {
+            if (i%8 == 0) {
+                obStr(ob, "\n");
+                obTabs(ob, nTabs+1);
+            }
+            obUint(ob, dmap->tab[i], 3);
+            obStr(ob, " ");
+        }
+        obStr(ob, "\n");
+    }
+}
+
+void describeHeader(int nTabs, wg_OutBuf* ob, void* base, wg_BankHeader* p) {
+    obTabs(ob, nTabs);
+    obStr(ob, "Wingroove bank\n");
+    obTabs(ob, nTabs);
+    obStr(ob, "* U24 File size: ");
+    obHex(ob, p->fileSizeAndFlag & 0x00FFFFFF, 6);
+    obStr(ob, "h\n");
+    describeUnkBytes(nTabs, ob, base, (char*)&p->fileSizeAndFlag + 3, 1);
+    obTabs(ob, nTabs);
+    obStr(ob, "* U16 Bank version ");
+    obHex(ob, p->bankVersion, 4);
+    obStr(ob, "h\n");
+    describeUnkBytes(nTabs, ob, base, &p->unk01, 2);
+    
+    obStr(ob, "\n");
+}
+
+int describeWgbank(FILE* out, void* base, size_t len, size_t fileLen) {
+    wg_BankIter it;
+    wg_Bank bank;
+    wg_OutBuf ob;
+    
+    if (!bankOpenPart(&bank, base, len, fileLen) || !obInit(&ob, out)) return 0;
+    describeHeader(0, &ob, base, base);
+    
+    bankIterInit(&it, &bank, WG_ITER_DUMMIES);
+    while (bankNextPatch(&it)) {
+        obStr(&ob, "Patch: ");
+        obUintZ(&ob, it.patchIdx<128?0:128, 3);
+        obStr(&ob, ":");
+        obUintZ(&ob, it.patchIdx&127, 3);
+        obStr(&ob, " ");
+        obStr(&ob, PATNAMES[it.patchIdx]);
+        obStr(&ob, "\n");
+        describeOff(0, &ob, "structure offset: ", it.patchOff);
+        describePatch(1, &ob, base, it.patch);
+        obTabs(&ob, 1);
+        obStr(&ob, "Splits:\n\n");
+        
+        while (bankNextSplit(&it)) {
+            obTabs(&ob, 2);
+            obStr(&ob, "Split nr: ");
+            obUint(&ob, it.splitIdx, 0);
+            obStr(&ob, "\n");
+            describeOff(2, &ob, "structure offset: ", it.splitOff);
+            describeSplit(3, &ob, base, it.split);
+            obTabs(&ob, 3);
+            obStr(&ob, "Sample header:\n");
+            describeOff(3, &ob, "structure offset: ", it.split->smpHeadOff);
+            if (it.smpHdr) describeSampleHdr(4, &ob, base, it.smpHdr);
+            
+            obStr(&ob, "\n");
+        }
+        
+        obStr(&ob, "\n\n\n\n");
+    }
+    
+    
+    return obFree(&ob);
+}
+
+//-----------------------------------------------
+//JSON
+
+//same structures as -d, offsets and raw values, no interpretation
+//broken offsets come out as null instead of being followed
+
+static void jsonUint(wg_OutBuf* ob, const char* key, uint32_t v) {
+    obStr(ob, ",\"");
+    obStr(ob, key);
+    obStr(ob, "\":");
+    obUint(ob, v, 0);
+}
+
+static void jsonInt(wg_OutBuf* ob, const char* key, int32_t v) {
+    obStr(ob, ",\"");
+    obStr(ob, key);
+    obStr(ob, "\":");
+    obInt(ob, v, 0);
+}
+
+static void jsonBytes(wg_OutBuf* ob, const char* key, const uint8_t* p, unsigned int len) {
+    obStr(ob, ",\"");
+    obStr(ob, key);
+    obStr(ob, "\":[");
+    for (unsigned int i=0; i < len; i++) {
+        if (i) obStr(ob, ",");
+        obUint(ob, p[i], 0);
+    }
+    obStr(ob, "]");
+}
+
+void jsonSampleHdr(wg_OutBuf* ob, const wg_Bank* bank, uint32_t off) {
+    wg_SampleHdr* p = bankSampleHdr(bank, off);
+    char sampleName[SAMPLE_NAME_LEN];
+    
+    if (!p) {
+        obStr(ob, "null");
+        return;
+    }
+    getSampleName(sampleName, sizeof(sampleName), p, &smpNameIdx);
+    obStr(ob, "{\"offset\":");
+    obUint(ob, off, 0);
+    obStr(ob, ",\"name\":");
+    obJsonStr(ob, sampleName);
+    jsonUint(ob, "offStart",   p->offStart);
+    jsonUint(ob, "offLoop",    p->offLoop);
+    jsonUint(ob, "offEnd",     p->offEnd);
+    jsonUint(ob, "volume",     p->volume);
+    jsonInt (ob, "tuning",     p->tuning);
+    jsonUint(ob, "lenAttack",  p->lenAttack);
+    jsonUint(ob, "lenDecay",   p->lenDecay);
+    jsonUint(ob, "volSustain", p->volSustain);
+    jsonUint(ob, "lenRelease", p->lenRelease);
+    jsonUint(ob, "flags",      p->flags);
+    jsonBytes(ob, "unk01", p->unk01, sizeof(p->unk01));
+    obStr(ob, "}");
+}
+
+void jsonSplit(wg_OutBuf* ob, const wg_Bank* bank, wg_Split* p) {
+    obStr(ob, "{\"offset\":");
+    obUint(ob, (uint8_t*)p - bank->base, 0);
+    jsonUint(ob, "rangeStart", p->rangeStart);
+    jsonUint(ob, "rangeEnd",   p->rangeEnd);
+    jsonUint(ob, "mapIndex",   p->mapIndex);
+    jsonInt (ob, "pan",        p->pan);
+    jsonBytes(ob, "unk01", p->unk01, sizeof(p->unk01));
+    jsonInt (ob, "tuning",     p->tuning);
+    obStr(ob, ",\"sampleHeader\":");
+    jsonSampleHdr(ob, bank, p->smpHeadOff);
+    obStr(ob, "}");
+}
+
+void jsonPatch(wg_OutBuf* ob, const wg_Bank* bank, unsigned int idx) {
+    wg_Patch* p = bankPatch(bank, idx);
+    wg_Split* spBase;
+    
+    obStr(ob, "{\"index\":");
+    obUint(ob, idx, 0);
+    jsonUint(ob, "bank", idx & 128);
+    jsonUint(ob, "program", idx & 127);
+    obStr(ob, ",\"name\":");
+    obJsonStr(ob, PATNAMES[idx]);
+    jsonUint(ob, "offset", ((wg_PatchMap*)(bank->base + MIDIMAP_OFF))->t[idx]);
+    if (!p) {
+        obStr(ob, ",\"patch\":null}");
+        return;
+    }
+    obStr(ob, ",\"dummy\":");
+    obStr(ob, p->volume ? "false" : "true");
+    jsonUint(ob, "volume",    p->volume);
+    jsonInt (ob, "tuning",    p->tuning);
+    jsonInt (ob, "randPitch", p->randPitch);
+    jsonUint(ob, "isDrumKit", p->isDrumKit);
+    jsonBytes(ob, "unk01", p->unk01, sizeof(p->unk01));
+    jsonUint(ob, "splitNum",  p->splitNum);
+    
+    if (p->isDrumKit) {
+        wg_DrumTable* drums = bankDrums(bank, p);
+        
+        if (!drums) {
+            obStr(ob, ",\"drumMap\":null}");
+            return;
+        }
+        jsonBytes(ob, "drumMap", drums->tab, sizeof(wg_DrumTable));
+    }
+    
+    obStr(ob, ",\"splits\":");
+    if (!(spBase = bankSplits(bank, p))) {
+        obStr(ob, "null}");
+        return;
+    }
+    obStr(ob, "[");
+    for (unsigned int j=0; j < p->splitNum; j++) {
+        if (j) obStr(ob, ",");
+        jsonSplit(ob, bank, &spBase[j]);
+    }
+    obStr(ob, "]}");
+}
+
+int describeJson(FILE* out, void* base, size_t len, size_t fileLen) {
+    wg_BankHeader* head = base;
+    wg_Bank bank;
+    wg_OutBuf ob;
+    
+    if (!bankOpenPart(&bank, base, len, fileLen) || !obInit(&ob, out)) return 0;
+    obStr(&ob, "{\"header\":{\"fileSize\":");
+    obUint(&ob, head->fileSizeAndFlag & 0x00FFFFFF, 0);
+    jsonUint(&ob, "flag", head->fileSizeAndFlag >> 24);
+    jsonUint(&ob, "bankVersion", head->bankVersion);
+    jsonBytes(&ob, "unk01", head->unk01, sizeof(head->unk01));
+    obStr(&ob, "},\n\"patches\":[\n");
+    for (unsigned int i=0; i < 256; i++) {
+        jsonPatch(&ob, &bank, i);
+        obStr(&ob, i < 255 ? ",\n" : "\n");
+    }
+    obStr(&ob, "]}\n");
+    
+    return obFree(&ob);
+}
+
+//-----------------------------------------------
+//QUERY
+
+//only prints the one PatchMap entry
+int queryPatch(FILE* out, void* base, size_t len, size_t fileLen, unsigned int idx) {
+    wg_Bank bank;
+    wg_OutBuf ob;
+    
+    if (idx > 255) {
+        printf("queryPatch(): No such patch.\n");
+        return 0;
+    }
+    if (!bankOpenPart(&bank, base, len, fileLen) || !obInit(&ob, out)) return 0;
+    jsonPatch(&ob, &bank, idx);
+    obStr(&ob, "\n");
+    
+    return obFree(&ob);
+}
+
+//every split whose sample data covers off, data of stereo samples counted in bytes
+int querySampleAt(FILE* out, void* base, size_t len, size_t fileLen, uint32_t off) {
+    wg_BankIter it;
+    wg_Bank bank;
+    int isFirst = 1;
+    wg_OutBuf ob;
+    
+    if (!bankOpenPart(&bank, base, len, fileLen) || !obInit(&ob, out)) return 0;
+    obStr(&ob, "[");
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        while (bankNextSplit(&it)) {
+            if (!it.smpHdr || off < it.smpHdr->offStart || off > it.smpHdr->offEnd) continue;
+            
+            obStr(&ob, isFirst ? "\n" : ",\n");
+            isFirst = 0;
+            obStr(&ob, "{\"patch\":");
+            obUint(&ob, it.patchIdx, 0);
+            jsonUint(&ob, "split", it.splitIdx);
+            obStr(&ob, ",\"name\":");
+            obJsonStr(&ob, PATNAMES[it.patchIdx]);
+            obStr(&ob, ",\"sampleHeader\":");
+            jsonSampleHdr(&ob, &bank, it.split->smpHeadOff);
+            obStr(&ob, "}");
+        }
+    }
+    obStr(&ob, isFirst ? "]\n" : "\n]\n");
+    
+    return obFree(&ob);
+}
+
+//-----------------------------------------------
+//EXPORT JOBS
+
+typedef struct {
+    wg_SampleHdr* smpHdr;
+    wg_Split*     split;
+    void*         base;
+    int           isTuned;
+    int           isDup;    //name taken by an earlier job, nothing to write
+    int           isWritten;//new file, not a link to store
+    int           isDone;   //outName is in place
+    int           isFresh;  //manifest says outName is up to date, nothing to write
+    uint64_t      key;      //of everything written file depends on
+    const char*   store;    //shared sample folder, NULL writes every file
+    const wg_Resampler* rs;
+    const wg_PcmCache*  pcm;
+    int           isFlac;
+    wg_Pool*      pool;     //for FLAC frames
+    wg_Aio*       aio;      //NULL or not async writes in task
+    char          sampleName[SAMPLE_NAME_LEN];
+    char          outName[MAXPATH];
+} WavJob;
+
+//jobs of patches[i] are jobs[firstJob[i]] up to jobs[firstJob[i+1]]
+typedef struct {
+    WavJob*      jobs;
+    unsigned int num;
+    unsigned int numPatches;
+    unsigned int patches[256];
+    unsigned int firstJob[257];
+} WavJobList;
+
+int cmpWavJobName(const void* a, const void* b) {
+    const WavJob* jA = *(WavJob**)a;
+    const WavJob* jB = *(WavJob**)b;
+    int res = strcmp(jA->outName, jB->outName);
+    
+    //keep first occurrence in front
+    return res ? res : (jA > jB) - (jA < jB);
+}
+
+//one job per split of every real patch, in one walk over the bank
+//same name may be shared by several sample headers, first one wins like it always did
+int collectWavJobs(WavJobList* list, char* dir, const wg_ExportOpts* opts, void* base, size_t len, int isTuned) {
+    WavJob** sorted = NULL;
+    unsigned int cap = 0;
+    wg_BankIter it;
+    wg_Bank bank;
+    
+    list->jobs       = NULL;
+    list->num        = 0;
+    list->numPatches = 0;
+    list->firstJob[0] = 0;
+    if (!bankOpen(&bank, base, len)) return 1;
+    
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        list->patches[list->numPatches++] = it.patchIdx;
+        
+        while (bankNextSplit(&it)) {
+            WavJob* job;
+            size_t dataLen;
+            
+            //writers read the data without looking
+            if (!it.smpHdr || !bankSampleData(&bank, it.smpHdr, &dataLen)) continue;
+            if (list->num == cap) {
+                WavJob* jobs;
+                
+                cap = cap ? cap*2 : 256;
+                if (!(jobs = realloc(list->jobs, cap * sizeof(WavJob)))) goto ERR;
+                list->jobs = jobs;
+            }
+            job = &list->jobs[list->num++];
+            job->smpHdr  = it.smpHdr;
+            job->split   = it.split;
+            job->base    = base;
+            job->isTuned = isTuned;
+            job->isDup   = 0;
+            job->isWritten = 0;
+            job->isDone  = 0;
+            job->isFresh = 0;
+            job->key     = 0;
+            job->store   = opts ? opts->store : NULL;
+            job->rs      = opts ? opts->rs    : NULL;
+            job->pcm     = opts ? opts->pcm   : NULL;
+            job->isFlac  = opts ? opts->isFlac : 0;
+            job->pool    = NULL;
+            job->aio     = NULL;
+            getSampleName(job->sampleName, sizeof(job->sampleName), job->smpHdr, &smpNameIdx);
+            if (snprintf(job->outName, MAXPATH, "%s/%s.%s", dir, job->sampleName, job->isFlac ? "flac" : "wav") >= MAXPATH) {
+                printf("collectWavJobs(): Path too long for %s.\n", job->sampleName);
+                list->num--;
+            }
+        }
+        list->firstJob[list->numPatches] = list->num;
+    }
+    if (!list->num) return 1;
+    
+    //flag duplicates, order of jobs stays as is
+    if (!(sorted = malloc(list->num * sizeof(WavJob*)))) goto ERR;
+    for (unsigned int i=0; i < list->num; i++) sorted[i] = &list->jobs[i];
+    qsort(sorted, list->num, sizeof(WavJob*), cmpWavJobName);
+    for (unsigned int i=1; i < list->num; i++) {
+        if (!strcmp(sorted[i]->outName, sorted[i-1]->outName)) sorted[i]->isDup = 1;
+    }
+    
+    free(sorted);
+    return 1;
+    ERR:
+        printf("collectWavJobs(): Out of memory!\n");
+        free(list->jobs);
+        list->jobs       = NULL;
+        list->num        = 0;
+        list->numPatches = 0;
+        return 0;
+}
+
+static int writeJobFile(WavJob* job, char* dest) {
+    if (job->isFlac) return writeFlac(job->smpHdr, job->base, job->pcm, dest, job->isTuned, job->rs, job->pool);
+    return writeWav(job->smpHdr, job->base, job->pcm, dest, job->isTuned, job->rs);
+}
+
+//everything writeWav() puts in file, format goes into file extension
+uint64_t wavJobKey(WavJob* job) {
+    wg_SampleHdr* p = job->smpHdr;
+    uint32_t meta[6];
+    uint64_t h;
+    
+    meta[0] = p->offEnd - p->offStart;
+    meta[1] = p->offLoop ? p->offLoop - p->offStart : 0xFFFFFFFF;
+    meta[2] = p->flags & WG_FLG_STEREO;
+    meta[3] = job->isTuned;
+    meta[4] = job->isTuned ? (uint16_t)p->tuning : 0;
+    meta[5] = job->rs ? job->rs->outRate : SAMPLE_RATE;
+    h = wg_hash64(meta, sizeof(meta), 0);
+    h = wg_hash64((uint8_t*)job->base + p->offStart, meta[0], h);
+    return h;
+}
+
+//store files are named after wavJobKey()
+//outName becomes hardlink to one, returns 0 if that can't be done
+int storeWav(WavJob* job) {
+    char storeName[MAXPATH], tmpName[MAXPATH];
+    uint64_t h = job->key;
+    
+    sprintf(storeName, "%s/%08X%08X.%s", job->store, (uint32_t)(h >> 32), (uint32_t)h, job->isFlac ? "flac" : "wav");
+    
+    if (!isFileExist(storeName)) {
+        //goes public in one step, racing writers of same name write same bytes anyway
+        sprintf(tmpName, "%s.%p.tmp", storeName, (void*)job);
+        if (!writeJobFile(job, tmpName)) {
+            remove(tmpName);
+            return 0;
+        }
+        fileLink(tmpName, storeName);
+        remove(tmpName);
+        job->isWritten = 1;
+    }
+    return fileLink(storeName, job->outName);
+}
+
+typedef struct {
+    WavJob*      job;
+    wav_PcmHead  head;
+    wav_SmplTail tail;
+    int16_t*     pcm;   //NULL if it's written straight from cache
+} QueuedWav;
+
+static void queuedWavDone(void* arg, int isOk) {
+    QueuedWav* q = arg;
+    
+    q->job->isDone = q->job->isWritten = isOk;
+    free(q->pcm);
+    free(q);
+}
+
+//same bytes as writeWav(), whole sample is decoded up front and aio owns it until written
+//cached samples go out as they are, cache outlives the export
+static int queueWav(WavJob* job) {
+    QueuedWav* q;
+    wg_IoVec vec[3];
+    const int16_t* whole;
+    size_t smpLen, tailLen;
+    
+    if (!(q = malloc(sizeof(QueuedWav)))) return 0;
+    q->job  = job;
+    tailLen = makeWavChunks(job->smpHdr, job->isTuned, job->rs, &q->head, &q->tail);
+    if (!(whole = wholeSample(job->smpHdr, job->base, job->pcm, job->rs, &smpLen, &q->pcm))) {
+        free(q);
+        return 0;
+    }
+    vec[0].buf = &q->head;
+    vec[0].len = sizeof(wav_PcmHead);
+    vec[1].buf = whole;
+    vec[1].len = q->head.data.length;
+    vec[2].buf = &q->tail;
+    vec[2].len = tailLen;
+    aioWriteFile(job->aio, job->outName, vec, 3, queuedWavDone, q);
+    return 1;
+}
+
+void writeWavTask(void* arg) {
+    WavJob* job = arg;
+    
+    //store on other drive or no hardlinks, plain file it is
+    if (job->store && storeWav(job)) {
+        job->isDone = 1;
+        return;
+    }
+    //FLAC is busy encoding anyway
+    if (!job->isFlac && job->aio && aioIsAsync(job->aio) && queueWav(job)) return;
+    job->isDone = job->isWritten = writeJobFile(job, job->outName);
+}
+
+unsigned int countWritten(WavJobList* list) {
+    unsigned int num = 0;
+    
+    for (unsigned int i=0; i < list->num; i++) num += list->jobs[i].isWritten;
+    return num;
+}
+
+//keys every job, ones old manifest has same key for whose file is still there need no writing
+//root is export folder, manifest names are relative to it
+void checkWavJobs(WavJobList* list, wg_Manifest* old, size_t rootLen) {
+    for (unsigned int i=0; i < list->num; i++) {
+        WavJob* job = &list->jobs[i];
+        
+        job->key = wavJobKey(job);
+        if (job->isDup) continue;
+        job->isFresh = manifestFind(old, job->outName + rootLen + 1) == job->key && isFileExist(job->outName);
+    }
+}
+
+//every file export meant to have, failed ones get key 0 so next run tries again
+int listWavJobs(WavJobList* list, wg_Manifest* cur, size_t rootLen) {
+    for (unsigned int i=0; i < list->num; i++) {
+        WavJob* job = &list->jobs[i];
+        
+        if (job->isDup) continue;
+        if (!manifestAdd(cur, job->outName + rootLen + 1, job->isFresh || job->isDone ? job->key : 0)) return 0;
+    }
+    return 1;
+}
+
+//removes changed files first, then hands them to the pool
+//aio can be NULL, files queued there are done once it has been waited for
+void submitWavJobs(WavJobList* list, wg_Pool* pool, wg_Aio* aio, wg_TaskGroup* group) {
+    for (unsigned int i=0; i < list->num; i++) {
+        if (!list->jobs[i].isDup && !list->jobs[i].isFresh) remove(list->jobs[i].outName);
+    }
+    for (unsigned int i=0; i < list->num; i++) {
+        list->jobs[i].pool = pool;
+        list->jobs[i].aio  = aio;
+        if (!list->jobs[i].isDup && !list->jobs[i].isFresh) poolSubmitGroup(pool, group, writeWavTask, &list->jobs[i]);
+    }
+}
+
+//stale files are ones last export made that this one didn't, cur goes to disk for next time
+void finishManifest(wg_Manifest* old, wg_Manifest* cur, const char* root) {
+    manifestRemoveStale(old, cur, root);
+    manifestSave(cur, root);
+}
+
+//-----------------------------------------------
+//SAMPDUMP
+
+#define SMP_SUF "_dmp"
+unsigned int dumpSamples(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts) {
+    wg_TaskGroup group = {0};
+    wg_Manifest old, cur;
+    wg_Aio* aio;
+    WavJobList list;
+    char outName[MAXPATH];
+    unsigned int numWritten;
+    
+    if (strlen(name) + PATH_ROOM > MAXPATH) {
+        printf("dumpSamples(): File name is too long.\n");
+        return 0;
+    }
+    sprintf(outName, "%s"SMP_SUF, name);
+    makeDir(outName);
+    if (!collectWavJobs(&list, outName, opts, base, len, 1)) return 0;
+    manifestLoad(&old, outName);
+    manifestInit(&cur);
+    checkWavJobs(&list, &old, strlen(outName));
+    aio = aioCreate(EXPORT_AIO_DEPTH, opts && opts->isSyncIo);
+    
+    submitWavJobs(&list, pool, aio, &group);
+    poolWaitGroup(pool, &group);
+    aioDestroy(aio);
+    numWritten = countWritten(&list);
+    //half a list would make good files look stale
+    if (listWavJobs(&list, &cur, strlen(outName))) finishManifest(&old, &cur, outName);
+    manifestFree(&old);
+    manifestFree(&cur);
+    free(list.jobs);
+    return numWritten;
+}
+
+//-----------------------------------------------
+//SFZDUMP
+
+int toSfzKeytrack(uint8_t flags) {
+    return (flags & WG_FLG_FIXEDNOTE ? 0 : (flags & WG_FLG_ATONAL ? 50 : 100));
+}
+float toSfzPan(int8_t pan) {
+    return ((float)pan * 100) / (pan>=0 ? 127 : 128);
+}
+int toSfzTuneKey(int16_t tune) {
+    return 12 + (int)(tune-1)/256;
+}
+int toSfzTuneCent(int16_t tune) {
+    return (((int)tune&0xFF) * (tune>=0?1:-1)) * 100 / 256;
+}
+float toSfzEnvelope(uint16_t env) {
+    //bad
+    return (float)env/64;
+}
+float toSfzAmpEGVolume(uint16_t vol) {
+    return (float)vol * 100 / 256;
+}
+
+//printf into growing memory buffer
+typedef struct {
+    char*  buf;
+    size_t len, cap;
+    int    isError;
+} TextBuf;
+
+static void textPrintf(TextBuf* t, const char* fmt, ...) {
+    va_list args;
+    int n;
+    
+    va_start(args, fmt);
+    n = vsnprintf(t->buf + t->len, t->cap - t->len, fmt, args);
+    va_end(args);
+    if (n < 0) goto ERR;
+    if (t->len + n >= t->cap) {
+        size_t cap = (t->len + n + 1) * 2;
+        char* buf;
+        
+        if (!(buf = realloc(t->buf, cap))) goto ERR;
+        t->buf = buf;
+        t->cap = cap;
+        va_start(args, fmt);
+        vsnprintf(t->buf + t->len, t->cap - t->len, fmt, args);
+        va_end(args);
+    }
+    t->len += n;
+    return;
+    ERR:
+        t->isError = 1;
+}
+
+//one .sfz on its way out through aio
+typedef struct {
+    TextBuf   text;
+    uint64_t* key;  //zeroed if write fails
+} QueuedSfz;
+
+static void queuedSfzDone(void* arg, int isOk) {
+    QueuedSfz* q = arg;
+    
+    if (!isOk) *q->key = 0;
+    free(q->text.buf);
+    free(q);
+}
+
+//async if aio is, otherwise text mode stdio like always
+static void writeSfz(wg_Aio* aio, char* outName, QueuedSfz* q) {
+    wg_IoVec vec;
+    FILE* sfzout;
+    
+    if (q->text.isError) {
+        *q->key = 0;
+    } else if (aio && aioIsAsync(aio)) {
+        vec.buf = q->text.buf;
+        vec.len = q->text.len;
+        aioWriteFile(aio, outName, &vec, 1, queuedSfzDone, q);
+        return;
+    } else if (!(sfzout = fopen(outName, "w"))) {
+        *q->key = 0;
+    } else {
+        if (fwrite(q->text.buf, 1, q->text.len, sfzout) != q->text.len) *q->key = 0;
+        if (fclose(sfzout)) *q->key = 0;
+    }
+    queuedSfzDone(q, 1);
+}
+
+//everything that goes into text of patch p
+uint64_t sfzKey(WavJobList* list, unsigned int p) {
+    unsigned int i = list->patches[p];
+    uint64_t h = wg_hash64(PATNAMES[i], strlen(PATNAMES[i]), i);
+    
+    for (unsigned int j=list->firstJob[p]; j < list->firstJob[p+1]; j++) {
+        WavJob* job = &list->jobs[j];
+        
+        h = wg_hash64(&job->key, sizeof(job->key), h);
+        h = wg_hash64(job->split, sizeof(wg_Split), h);
+        h = wg_hash64(job->smpHdr, sizeof(wg_SampleHdr), h);
+        h = wg_hash64(job->sampleName, strlen(job->sampleName), h);
+        h = wg_hash64(&job->isFlac, sizeof(job->isFlac), h);
+    }
+    return h;
+}
+
+#define SFZ_SUF "_sfz"
+unsigned int dumpSfz(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts) {
+    wg_TaskGroup group = {0};
+    wg_Manifest old, cur;
+    WavJobList list;
+    char outName[MAXPATH], root[MAXPATH];
+    uint64_t keys[256];
+    uint8_t isFresh[256];
+    unsigned int numWritten;
+    int isListed;
+    wg_Aio* aio;
+    
+    if (strlen(name) + PATH_ROOM > MAXPATH) {
+        printf("dumpSfz(): File name is too long.\n");
+        return 0;
+    }
+    sprintf(outName, "%s"SFZ_SUF, name);
+    makeDir(outName);
+    sprintf(outName, "%s"SFZ_SUF"/samples", name);
+    makeDir(outName);
+    if (!collectWavJobs(&list, outName, opts, base, len, 0)) return 0;
+    sprintf(outName, "%s"SFZ_SUF"/mel", name);
+    makeDir(outName);
+    sprintf(outName, "%s"SFZ_SUF"/drm", name);
+    makeDir(outName);
+    sprintf(root, "%s"SFZ_SUF, name);
+    manifestLoad(&old, root);
+    manifestInit(&cur);
+    checkWavJobs(&list, &old, strlen(root));
+    
+    for (unsigned int p=0; p < list.numPatches; p++) {
+        unsigned int i = list.patches[p];
+        
+        sprintf(outName, "%s"SFZ_SUF"/%s/%03u %03u %s.sfz", name, i>>7?"drm":"mel", i&127, i&127, PATNAMES[i]);
+        keys[p]    = sfzKey(&list, p);
+        isFresh[p] = manifestFind(&old, outName + strlen(root) + 1) == keys[p] && isFileExist(outName);
+        if (!isFresh[p]) remove(outName);
+    }
+    
+    //samples get written by workers while we do the text
+    aio = aioCreate(EXPORT_AIO_DEPTH, opts && opts->isSyncIo);
+    submitWavJobs(&list, pool, aio, &group);
+    
+    for (unsigned int p=0; p < list.numPatches; p++) {
+        unsigned int i = list.patches[p];
+        QueuedSfz* q;
+        
+        if (isFresh[p]) continue;
+        if (!(q = calloc(1, sizeof(QueuedSfz)))) {
+            keys[p] = 0;
+            continue;
+        }
+        q->key = &keys[p];
+        sprintf(outName, "%s"SFZ_SUF"/%s/%03u %03u %s.sfz", name, i>>7?"drm":"mel", i&127, i&127, PATNAMES[i]);
+        //printf("Patch: %03u:%03u %s\n", 128*(i>>7), i&127, PATNAMES[i]);
+        
+        textPrintf(&q->text,
+            "//SFZ exported by WG-Knife, version 0.00000000000001\n"
+            "\n"
+            "<group>\n"
+            "//-----\n"
+            "\n"
+            "\n"
+        );
+        
+        for (unsigned int j=list.firstJob[p]; j < list.firstJob[p+1]; j++) {
+            WavJob*       job    = &list.jobs[j];
+            wg_Split*     split  = job->split;
+            wg_SampleHdr* smpHdr = job->smpHdr;
+            int numChans = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+            uint32_t loopStart = (smpHdr->offLoop - smpHdr->offStart) / numChans;
+            uint32_t loopEnd   = (smpHdr->offEnd  - smpHdr->offStart) / numChans;
+            
+            //same points writeWav() puts in smpl chunk
+            if (job->rs) {
+                loopStart = resamplePos(job->rs, loopStart);
+                loopEnd   = resampleLen(job->rs, loopEnd);
+            }
+            
+            textPrintf(&q->text,
+                "<region>\n"
+                "sample=../samples/%s.%s\n"
+                "lokey=%u hikey=%u\n"
+                "pitch_keytrack=%i\n"
+                "transpose=%i\n"
+                "tune=%i\n"
+                "pan=%f\n"
+                "loop_mode=%s\n",
+                job->sampleName, job->isFlac ? "flac" : "wav",
+                split->rangeStart, split->rangeEnd,
+                toSfzKeytrack(smpHdr->flags),
+                toSfzTuneKey(smpHdr->tuning + split->tuning),
+                toSfzTuneCent(smpHdr->tuning + split->tuning),
+                toSfzPan(split->pan),
+                smpHdr->offStart ? "loop_continuous" : "no_loop"
+            );
+            
+            if (smpHdr->offLoop) textPrintf(&q->text, "loop_start=%u loop_end=%u\n", loopStart, loopEnd);
+            
+            textPrintf(&q->text, "ampeg_attack=%f\n",  toSfzEnvelope(smpHdr->lenAttack));
+            textPrintf(&q->text, "ampeg_decay=%f\n",   toSfzEnvelope(smpHdr->lenDecay));
+            textPrintf(&q->text, "ampeg_hold=%f\n",    toSfzEnvelope(smpHdr->volSustain));
+            textPrintf(&q->text, "ampeg_release=%f\n", toSfzEnvelope(smpHdr->lenRelease));
+            
+            textPrintf(&q->text, "\n");
+        }
+        writeSfz(aio, outName, q);
+    }
+    
+    poolWaitGroup(pool, &group);
+    aioDestroy(aio);
+    numWritten = countWritten(&list);
+    isListed = listWavJobs(&list, &cur, strlen(root));
+    for (unsigned int p=0; isListed && p < list.numPatches; p++) {
+        unsigned int i = list.patches[p];
+        
+        sprintf(outName, "%s/%03u %03u %s.sfz", i>>7?"drm":"mel", i&127, i&127, PATNAMES[i]);
+        isListed = manifestAdd(&cur, outName, keys[p]);
+    }
+    if (isListed) finishManifest(&old, &cur, root);
+    manifestFree(&old);
+    manifestFree(&cur);
+    free(list.jobs);
+    return numWritten;
+}
+
+//-----------------------------------------------
+//SF2DUMP
+
+#define SF2_SUF      ".sf2"
+#define SF2_MAXGENS  (13)   //per zone
+
+typedef struct {
+    unsigned int  inst;
+    wg_Patch*     patch;
+    wg_Split*     split;
+    wg_SampleHdr* smpHdr;
+    uint8_t       exclClass;
+} Sf2Zone;
+
+//one per channel of every sample header in use
+//headers playing the same data share its points, only first one of them writes them
+typedef struct {
+    wg_SampleHdr* smpHdr;
+    int           chan;       //-1 for mono
+    uint32_t      start, len; //in points, len without padding
+    uint32_t      loopStart;  //in bank frames
+    int           isLoop;
+} Sf2Sample;
+
+//sample data of a header, sorted so headers over the same data end up next to each other
+typedef struct {
+    uint32_t     offStart;
+    uint32_t     offEnd;
+    int          isStereo;
+    unsigned int hdr;         //index of header in use
+} Sf2Region;
+
+static int cmpSf2Region(const void* a, const void* b) {
+    const Sf2Region* rA = a;
+    const Sf2Region* rB = b;
+    
+    if (rA->offStart != rB->offStart) return rA->offStart < rB->offStart ? -1 : 1;
+    if (rA->offEnd   != rB->offEnd)   return rA->offEnd   < rB->offEnd   ? -1 : 1;
+    if (rA->isStereo != rB->isStereo) return rA->isStereo - rB->isStereo;
+    return (rA->hdr > rB->hdr) - (rA->hdr < rB->hdr);
+}
+
+int cmpUint32(const void* a, const void* b) {
+    uint32_t vA = *(const uint32_t*)a, vB = *(const uint32_t*)b;
+    
+    return (vA > vB) - (vA < vB);
+}
+
+//envelope lengths are 1/64s like in SFZ export
+int16_t toSf2Timecents(uint16_t env) {
+    double tc;
+    
+    if (!env) return -12000;
+    tc = floor(1200 * log2(env / 64.0) + 0.5);
+    return tc > 8000 ? 8000 : (tc < -12000 ? -12000 : (int16_t)tc);
+}
+
+uint16_t toSf2Centibels(double gain) {
+    double cb;
+    
+    //SF2 can't amplify, louder than 100% stays at 100%
+    if (gain <= 0) return 1440;
+    cb = floor(-200 * log10(gain) + 0.5);
+    return cb > 1440 ? 1440 : (cb < 0 ? 0 : (uint16_t)cb);
+}
+
+static void addGen(sf2_Gen* gens, unsigned int* num, uint16_t oper, int amount) {
+    gens[*num].oper   = oper;
+    gens[*num].amount = (uint16_t)amount;
+    (*num)++;
+}
+
+//same pitch and envelope mapping the synth uses, keycenter 60
+static void addZoneGens(sf2_Gen* gens, unsigned int* num, const Sf2Zone* z, const Sf2Sample* smp, unsigned int smpIdx) {
+    wg_SampleHdr* smpHdr = z->smpHdr;
+    int32_t tune  = 12*256 + smpHdr->tuning + z->split->tuning + z->patch->tuning;
+    int32_t cents = tune >= 0 ? (tune*100 + 128) / 256 : -((-tune*100 + 128) / 256);
+    int keytrack  = smpHdr->flags & WG_FLG_FIXEDNOTE ? 0 : (smpHdr->flags & WG_FLG_ATONAL ? 50 : 100);
+    int pan       = smp->chan < 0 ? z->split->pan * 500 / 128 : (smp->chan ? 500 : -500);
+    //no decay stage means it never decays
+    double sustain = !smpHdr->lenDecay || smpHdr->volSustain >= 256 ? 1.0 : smpHdr->volSustain / 256.0;
+    
+    addGen(gens, num, SF2GEN_keyRange,     z->split->rangeStart | (z->split->rangeEnd << 8));
+    addGen(gens, num, SF2GEN_pan,          pan);
+    addGen(gens, num, SF2GEN_initialAttenuation, toSf2Centibels(smpHdr->volume / 256.0 * z->patch->volume / 256.0));
+    addGen(gens, num, SF2GEN_coarseTune,   cents / 100);
+    addGen(gens, num, SF2GEN_fineTune,     cents % 100);
+    addGen(gens, num, SF2GEN_scaleTuning,  keytrack);
+    addGen(gens, num, SF2GEN_attackVolEnv, toSf2Timecents(smpHdr->lenAttack));
+    addGen(gens, num, SF2GEN_decayVolEnv,  toSf2Timecents(smpHdr->lenDecay));
+    addGen(gens, num, SF2GEN_sustainVolEnv, toSf2Centibels(sustain));
+    //one-shot drums play out
+    addGen(gens, num, SF2GEN_releaseVolEnv, z->patch->isDrumKit && !smp->isLoop ? 8000 : toSf2Timecents(smpHdr->lenRelease));
+    addGen(gens, num, SF2GEN_sampleModes,  smp->isLoop ? 1 : 0);
+    if (z->exclClass) addGen(gens, num, SF2GEN_exclusiveClass, z->exclClass);
+    addGen(gens, num, SF2GEN_sampleID,     smpIdx);
+}
+
+static void sf2Name(char* dest, const char* src, const char* suffix) {
+    memset(dest, 0, 20);
+    snprintf(dest, 20, "%.*s%s", (int)(19 - strlen(suffix)), src, suffix);
+}
+
+//points of one channel of sample, resampled if asked to
+static int16_t* sf2SampleData(const Sf2Sample* smp, void* base, const wg_PcmCache* cache, const wg_Resampler* rs) {
+    wg_SampleHdr* smpHdr = smp->smpHdr;
+    int numChans  = smp->chan < 0 ? 1 : 2;
+    size_t inLen  = (smpHdr->offEnd - smpHdr->offStart) / numChans;
+    const int16_t* src = pcmCacheFind(cache, smpHdr);
+    int16_t* decoded = NULL;
+    int16_t* out = NULL;
+    int16_t* res = NULL;
+    
+    if (!src) {
+        if (!(decoded = malloc(inLen * numChans * sizeof(int16_t)))) goto END;
+        wg_decode((uint8_t*)base + smpHdr->offStart, decoded, inLen * numChans);
+        src = decoded;
+    }
+    if (rs) {
+        if (!(res = malloc((size_t)smp->len * numChans * sizeof(int16_t)))) goto END;
+        if (!resample(rs, src, inLen, numChans, smp->isLoop ? smp->loopStart : SIZE_MAX, res)) goto END;
+        src = res;
+    }
+    if (!(out = malloc(smp->len * sizeof(int16_t)))) goto END;
+    for (uint32_t i=0; i < smp->len; i++) out[i] = src[i*numChans + (smp->chan < 0 ? 0 : smp->chan)];
+    
+    END:
+        free(decoded);
+        free(res);
+        return out;
+}
+
+//whole bank into one file, every chunk size is known before first byte goes out
+int dumpSf2(char* name, void* base, size_t len, const wg_ExportOpts* opts) {
+    const wg_Resampler* rs = opts ? opts->rs : NULL;
+    static const int16_t zeros[SF2_SAMPLE_PAD] = {0};
+    static const char isng[8] = "EMU8000";
+    static const char isft[10] = "WG-Knife";
+    const char* bankName = name;
+    char inam[256] = {0};
+    uint16_t ifil[2] = {2, 1};
+    char outName[MAXPATH];
+    wg_BankIter it;
+    wg_Bank bank;
+    Sf2Zone*       zones   = NULL;
+    Sf2Sample*     samples = NULL;
+    uint32_t*      hdrOffs = NULL;
+    unsigned int*  firstSmp = NULL;
+    Sf2Region*     regions  = NULL;
+    unsigned int*  owners   = NULL;  //samples whose points go into smpl, in file order
+    sf2_PresetHdr* phdr = NULL;
+    sf2_Bag*       pbag = NULL;
+    sf2_Gen*       pgen = NULL;
+    sf2_Inst*      inst = NULL;
+    sf2_Bag*       ibag = NULL;
+    sf2_Gen*       igen = NULL;
+    sf2_SampleHdr* shdr = NULL;
+    sf2_Mod        mod = {0};
+    unsigned int numInst = 0, numZones = 0, numHdrs = 0, numSamples = 0, numOwners = 0, numIbag = 0, numIgen = 0, maxSplits = 0;
+    uint32_t numPoints = 0;
+    uint32_t nameLen, infoLen, sdtaLen, pdtaLen;
+    sf2_List riff, info, sdta, pdta;
+    sf2_Chunk ck[16];
+    wg_IoVec vec[32];
+    int nVec = 0, nCk = 0, fout = -1;
+    
+    if (!bankOpen(&bank, base, len)) return 0;
+    if (strlen(name) + PATH_ROOM > MAXPATH) {
+        printf("dumpSf2(): File name is too long.\n");
+        return 0;
+    }
+    for (const char* p = name; *p; p++) {
+        if (*p == '/' || *p == '\\') bankName = p+1;
+    }
+    
+    //sizes first
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        numInst++;
+        maxSplits += it.patch->splitNum;
+    }
+    if (!(zones    = malloc((maxSplits+1) * sizeof(Sf2Zone))))    goto OOM;
+    if (!(hdrOffs  = malloc((maxSplits+1) * sizeof(uint32_t))))   goto OOM;
+    if (!(phdr     = calloc(numInst+1, sizeof(sf2_PresetHdr))))   goto OOM;
+    if (!(pbag     = calloc(numInst+1, sizeof(sf2_Bag))))         goto OOM;
+    if (!(pgen     = calloc(numInst+1, sizeof(sf2_Gen))))         goto OOM;
+    if (!(inst     = calloc(numInst+1, sizeof(sf2_Inst))))        goto OOM;
+    
+    numInst = 0;
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        uint8_t classUse[256] = {0};
+        wg_Split* spBase = bankSplits(&bank, it.patch);
+        
+        //drum splits sharing mapIndex cut each other off, like hihats do
+        if (it.patch->isDrumKit && spBase) {
+            for (unsigned int j=0; j < it.patch->splitNum; j++) {
+                if (classUse[spBase[j].mapIndex] < 2) classUse[spBase[j].mapIndex]++;
+            }
+        }
+        sf2Name(inst[numInst].name, PATNAMES[it.patchIdx], "");
+        sf2Name(phdr[numInst].name, PATNAMES[it.patchIdx], "");
+        phdr[numInst].preset = it.patchIdx & 127;
+        phdr[numInst].bank   = it.patchIdx & 128;
+        phdr[numInst].bagNdx = numInst;
+        pbag[numInst].genNdx = numInst;
+        pgen[numInst].oper   = SF2GEN_instrument;
+        pgen[numInst].amount = numInst;
+        
+        while (bankNextSplit(&it)) {
+            Sf2Zone* z = &zones[numZones];
+            size_t dataLen;
+            
+            if (!it.smpHdr || !bankSampleData(&bank, it.smpHdr, &dataLen)) continue;
+            if (dataLen < (it.smpHdr->flags & WG_FLG_STEREO ? 4u : 2u)) continue;
+            z->inst      = numInst;
+            z->patch     = it.patch;
+            z->split     = it.split;
+            z->smpHdr    = it.smpHdr;
+            z->exclClass = it.split->mapIndex && classUse[it.split->mapIndex] > 1 ? it.split->mapIndex : 0;
+            hdrOffs[numZones++] = it.split->smpHeadOff;
+        }
+        numInst++;
+    }
+    
+    //sample headers in use, in file order, stereo ones make left and right samples
+    qsort(hdrOffs, numZones, sizeof(uint32_t), cmpUint32);
+    for (unsigned int i=0; i < numZones; i++) {
+        if (!i || hdrOffs[i] != hdrOffs[numHdrs-1]) hdrOffs[numHdrs++] = hdrOffs[i];
+    }
+    if (!(firstSmp = malloc((numHdrs+1) * sizeof(unsigned int))))    goto OOM;
+    if (!(samples  = malloc((numHdrs*2+1) * sizeof(Sf2Sample))))     goto OOM;
+    if (!(regions  = malloc((numHdrs+1) * sizeof(Sf2Region))))       goto OOM;
+    if (!(owners   = malloc((numHdrs*2+1) * sizeof(unsigned int))))  goto OOM;
+    for (unsigned int h=0; h < numHdrs; h++) {
+        wg_SampleHdr* smpHdr = bankSampleHdr(&bank, hdrOffs[h]);
+        int numChans = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+        uint32_t frames = (smpHdr->offEnd - smpHdr->offStart) / numChans;
+        int isLoop = smpHdr->offLoop && smpHdr->offLoop >= smpHdr->offStart && smpHdr->offLoop < smpHdr->offEnd;
+        uint32_t loopStart = isLoop ? (smpHdr->offLoop - smpHdr->offStart) / numChans : 0;
+        
+        firstSmp[h] = numSamples;
+        regions[h].offStart = smpHdr->offStart;
+        regions[h].offEnd   = smpHdr->offEnd;
+        regions[h].isStereo = numChans == 2;
+        regions[h].hdr      = h;
+        for (int c=0; c < numChans; c++) {
+            Sf2Sample* smp = &samples[numSamples++];
+            
+            smp->smpHdr    = smpHdr;
+            smp->chan      = numChans == 2 ? c : -1;
+            smp->isLoop    = isLoop;
+            smp->len       = rs ? resampleLen(rs, frames) : frames;
+            smp->loopStart = loopStart;
+        }
+    }
+    
+    //each distinct data region once in smpl, loop points of every header are into its region
+    //with -rate region is resampled with loop of its first header
+    qsort(regions, numHdrs, sizeof(Sf2Region), cmpSf2Region);
+    for (unsigned int r=0, owner=0; r < numHdrs; r++) {
+        unsigned int s = firstSmp[regions[r].hdr];
+        unsigned int numChans = regions[r].isStereo ? 2 : 1;
+        
+        if (!r || regions[r].offStart != regions[r-1].offStart || regions[r].offEnd != regions[r-1].offEnd ||
+            regions[r].isStereo != regions[r-1].isStereo) {
+            owner = s;
+            for (unsigned int c=0; c < numChans; c++) {
+                samples[s+c].start  = numPoints;
+                numPoints          += samples[s+c].len + SF2_SAMPLE_PAD;
+                owners[numOwners++] = s+c;
+            }
+        } else {
+            for (unsigned int c=0; c < numChans; c++) samples[s+c].start = samples[owner+c].start;
+        }
+    }
+    
+    if (!(ibag = calloc(numZones*2+1, sizeof(sf2_Bag))))              goto OOM;
+    if (!(igen = calloc(numZones*2*SF2_MAXGENS+1, sizeof(sf2_Gen))))  goto OOM;
+    if (!(shdr = calloc(numSamples+1, sizeof(sf2_SampleHdr))))        goto OOM;
+    for (unsigned int i=0, z=0; i < numInst; i++) {
+        inst[i].bagNdx = numIbag;
+        for (; z < numZones && zones[z].inst == i; z++) {
+            uint32_t* found = bsearch(&zones[z].split->smpHeadOff, hdrOffs, numHdrs, sizeof(uint32_t), cmpUint32);
+            unsigned int s = firstSmp[found - hdrOffs];
+            unsigned int numChans = zones[z].smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+            
+            for (unsigned int c=0; c < numChans; c++) {
+                ibag[numIbag++].genNdx = numIgen;
+                addZoneGens(igen, &numIgen, &zones[z], &samples[s+c], s+c);
+            }
+        }
+    }
+    //bag and generator indices are 16 bit
+    if (numIgen > 0xFFFF || numIbag > 0xFFFF || numSamples > 0xFFFF) {
+        printf("dumpSf2(): Bank too big for SF2.\n");
+        goto ERR;
+    }
+    
+    //terminal records
+    sprintf(phdr[numInst].name, "EOP");
+    phdr[numInst].bagNdx = numInst;
+    pbag[numInst].genNdx = numInst;
+    sprintf(inst[numInst].name, "EOI");
+    inst[numInst].bagNdx = numIbag;
+    ibag[numIbag].genNdx = numIgen;
+    sprintf(shdr[numSamples].name, "EOS");
+    
+    for (unsigned int i=0; i < numSamples; i++) {
+        Sf2Sample* smp = &samples[i];
+        char sampleName[SAMPLE_NAME_LEN];
+        
+        getSampleName(sampleName, sizeof(sampleName), smp->smpHdr, &smpNameIdx);
+        sf2Name(shdr[i].name, sampleName, smp->chan < 0 ? "" : (smp->chan ? " R" : " L"));
+        shdr[i].start         = smp->start;
+        shdr[i].end           = smp->start + smp->len;
+        shdr[i].startLoop     = smp->start + (!smp->isLoop ? 0 : (rs ? resamplePos(rs, smp->loopStart) : smp->loopStart));
+        shdr[i].endLoop       = smp->start + (smp->isLoop ? smp->len : 0);
+        shdr[i].sampleRate    = rs ? rs->outRate : SAMPLE_RATE;
+        shdr[i].originalPitch = 60;
+        shdr[i].sampleLink    = smp->chan < 0 ? 0 : (smp->chan ? i-1 : i+1);
+        shdr[i].sampleType    = smp->chan < 0 ? SF2_MONO : (smp->chan ? SF2_RIGHT : SF2_LEFT);
+    }
+    
+    //zero terminated, even length
+    snprintf(inam, sizeof(inam), "%s", bankName);
+    nameLen = (strlen(inam) + 2) & ~1u;
+    infoLen = 4 + sizeof(sf2_Chunk)*4 + sizeof(ifil) + sizeof(isng) + nameLen + sizeof(isft);
+    sdtaLen = 4 + sizeof(sf2_Chunk) + numPoints * sizeof(int16_t);
+    pdtaLen = 4 + sizeof(sf2_Chunk)*9 +
+        (numInst+1) * (sizeof(sf2_PresetHdr) + sizeof(sf2_Bag) + sizeof(sf2_Gen) + sizeof(sf2_Inst)) +
+        sizeof(sf2_Mod) * 2 + (numIbag+1) * sizeof(sf2_Bag) + (numIgen+1) * sizeof(sf2_Gen) +
+        (numSamples+1) * sizeof(sf2_SampleHdr);
+    
+    riff.id   = IFFID_RIFF;
+    riff.len  = 4 + 3*sizeof(sf2_Chunk) + infoLen + sdtaLen + pdtaLen;
+    riff.type = SF2ID_sfbk;
+    info.id   = IFFID_LIST;
+    info.len  = infoLen;
+    info.type = SF2ID_INFO;
+    sdta.id   = IFFID_LIST;
+    sdta.len  = sdtaLen;
+    sdta.type = SF2ID_sdta;
+    pdta.id   = IFFID_LIST;
+    pdta.len  = pdtaLen;
+    pdta.type = SF2ID_pdta;
+    
+    sprintf(outName, "%s"SF2_SUF, name);
+    if ((fout = fileCreate(outName)) < 0) {
+        printf("dumpSf2(): Could not create file.\n");
+        goto ERR;
+    }
+    
+    #define VEC(P, L) {vec[nVec].buf = (P); vec[nVec].len = (L); nVec++;}
+    #define CHUNKHEAD(ID, L) {ck[nCk].id = (ID); ck[nCk].len = (L); VEC(&ck[nCk], sizeof(sf2_Chunk)); nCk++;}
+    #define CHUNK(ID, P, L) {CHUNKHEAD(ID, L); VEC(P, L);}
+    VEC(&riff, sizeof(sf2_List));
+    VEC(&info, sizeof(sf2_List));
+    CHUNK(SF2ID_ifil, ifil, sizeof(ifil));
+    CHUNK(SF2ID_isng, isng, sizeof(isng));
+    CHUNK(SF2ID_INAM, inam, nameLen);
+    CHUNK(SF2ID_ISFT, isft, sizeof(isft));
+    VEC(&sdta, sizeof(sf2_List));
+    //data follows sample by sample
+    CHUNKHEAD(SF2ID_smpl, numPoints * sizeof(int16_t));
+    if (!fileWriteVec(fout, vec, nVec)) goto ERR;
+    
+    for (unsigned int i=0; i < numOwners; i++) {
+        int16_t* pcm = sf2SampleData(&samples[owners[i]], base, opts ? opts->pcm : NULL, rs);
+        int isOk;
+        
+        if (!pcm) goto OOM;
+        vec[0].buf = pcm;
+        vec[0].len = samples[owners[i]].len * sizeof(int16_t);
+        vec[1].buf = zeros;
+        vec[1].len = sizeof(zeros);
+        isOk = fileWriteVec(fout, vec, 2);
+        free(pcm);
+        if (!isOk) goto ERR;
+    }
+    
+    nVec = nCk = 0;
+    VEC(&pdta, sizeof(sf2_List));
+    CHUNK(SF2ID_phdr, phdr, (numInst+1) * sizeof(sf2_PresetHdr));
+    CHUNK(SF2ID_pbag, pbag, (numInst+1) * sizeof(sf2_Bag));
+    CHUNK(SF2ID_pmod, &mod, sizeof(sf2_Mod));
+    CHUNK(SF2ID_pgen, pgen, (numInst+1) * sizeof(sf2_Gen));
+    CHUNK(SF2ID_inst, inst, (numInst+1) * sizeof(sf2_Inst));
+    CHUNK(SF2ID_ibag, ibag, (numIbag+1) * sizeof(sf2_Bag));
+    CHUNK(SF2ID_imod, &mod, sizeof(sf2_Mod));
+    CHUNK(SF2ID_igen, igen, (numIgen+1) * sizeof(sf2_Gen));
+    CHUNK(SF2ID_shdr, shdr, (numSamples+1) * sizeof(sf2_SampleHdr));
+    #undef CHUNK
+    #undef CHUNKHEAD
+    #undef VEC
+    if (!fileWriteVec(fout, vec, nVec)) goto ERR;
+    
+    if (!fileClose(fout)) {
+        fout = -1;
+        goto ERR;
+    }
+    fout = -1;
+    free(zones);
+    free(hdrOffs);
+    free(firstSmp);
+    free(regions);
+    free(owners);
+    free(samples);
+    free(phdr);
+    free(pbag);
+    free(pgen);
+    free(inst);
+    free(ibag);
+    free(igen);
+    free(shdr);
+    return 1;
+    OOM:
+        printf("dumpSf2(): Out of memory!\n");
+    ERR:
+        if (fout >= 0) fileClose(fout);
+        free(zones);
+        free(hdrOffs);
+        free(firstSmp);
+        free(regions);
+        free(owners);
+        free(samples);
+        free(phdr);
+        free(pbag);
+        free(pgen);
+        free(inst);
+        free(ibag);
+        free(igen);
+        free(shdr);
+        return 0;
+}
+
+//-----------------------------------------------
+//RENDER
+
+#define RENDER_RATE   (44100)
+#define RENDER_WINDOW (RENDER_RATE)    //frames each channel renders between syncs
+#define RENDER_TAIL   (RENDER_RATE*10) //longest wait for notes to die out after song end
+
+//every channel gets own synth and voices, so channels render independently
+typedef struct {
+    wg_Synth*     syn;
+    wg_MidiEvent* events;
+    size_t        num;
+    size_t        next;
+    int32_t*      mix;
+    uint32_t      frame;  //window start
+    unsigned int  frames;
+} RenderJob;
+
+//16-bit stereo
+static void makeRenderHead(wav_PcmHead* wHead, uint32_t frames, unsigned int rate) {
+    memset(wHead, 0, sizeof(wav_PcmHead));
+    wHead->file.id_RIFF       = IFFID_RIFF;
+    wHead->file.filesize      = 4 + sizeof(wav_FormatHeader) + sizeof(wav_DataHeader) + frames * 4;
+    wHead->file.id_WAVE       = IFFID_WAVE;
+    wHead->form.id_fmt        = IFFID_fmt;
+    wHead->form.hdrlen        = 16;
+    wHead->form.format        = 1;
+    wHead->form.channels      = 2;
+    wHead->form.freqHz        = rate;
+    wHead->form.bytessec      = rate * 4;
+    wHead->form.samplesize    = 4;
+    wHead->form.bitspersample = 16;
+    wHead->data.id_data       = IFFID_data;
+    wHead->data.length        = frames * 4;
+}
+
+void renderTask(void* arg) {
+    RenderJob* job = arg;
+    uint32_t pos = job->frame, end = job->frame + job->frames;
+    
+    memset(job->mix, 0, job->frames * 2 * sizeof(int32_t));
+    while (pos < end) {
+        uint32_t until = end;
+        
+        if (job->next < job->num && job->events[job->next].frame < end) until = job->events[job->next].frame;
+        if (until > pos) {
+            synthRenderMix(job->syn, job->mix + (pos - job->frame)*2, until - pos);
+            pos = until;
+        }
+        while (job->next < job->num && job->events[job->next].frame <= pos) {
+            synthMidi(job->syn, job->events[job->next].msg);
+            job->next++;
+        }
+    }
+}
+
+int renderMidi(void* base, size_t len, const wg_ExportOpts* opts, char* midName, char* outName, wg_Pool* pool) {
+    RenderJob jobs[SYNTH_CHANNELS] = {{0}};
+    wg_MidiSong song = {0};
+    wav_PcmHead wHead;
+    MappedFile mid = {0};
+    int16_t* outBuf = NULL;
+    FILE* fout = NULL;
+    uint32_t total = 0;
+    int numJobs = 0;
+    
+    if (!mapfile(midName, &mid)) goto ERR;
+    if (!midiLoad(&song, mid.base, mid.len, RENDER_RATE)) goto ERR;
+    
+    //split song per channel, order within a channel is kept
+    for (int ch=0; ch < SYNTH_CHANNELS; ch++) {
+        RenderJob* job = &jobs[numJobs];
+        
+        for (size_t i=0; i < song.num; i++) job->num += (song.events[i].msg[0] & 15) == ch;
+        if (!job->num) continue;
+        numJobs++;
+        
+        job->events = malloc(job->num * sizeof(wg_MidiEvent));
+        job->mix    = malloc(RENDER_WINDOW * 2 * sizeof(int32_t));
+        job->syn    = synthCreate(base, len, RENDER_RATE);
+        if (!job->events || !job->mix || !job->syn) goto OOM;
+        synthSetPcm(job->syn, opts ? opts->pcm : NULL);
+        synthSetInterp(job->syn, opts ? opts->interp : WG_MIX_LINEAR);
+        job->num = 0;
+        for (size_t i=0; i < song.num; i++) {
+            if ((song.events[i].msg[0] & 15) == ch) job->events[job->num++] = song.events[i];
+        }
+    }
+    if (!(outBuf = malloc(RENDER_WINDOW * 2 * sizeof(int16_t)))) goto OOM;
+    
+    if (!(fout = fopen(outName, "wb"))) {
+        printf("renderMidi(): Could not open the file.\n");
+        goto ERR;
+    }
+    //header gets filled in once length is known
+    memset(&wHead, 0, sizeof(wav_PcmHead));
+    fwrite(&wHead, sizeof(wav_PcmHead), 1, fout);
+    
+    for (;;) {
+        int isBusy = 0;
+        
+        for (int i=0; i < numJobs; i++) isBusy |= synthActiveVoices(jobs[i].syn) || jobs[i].next < jobs[i].num;
+        if (total > song.lenFrames && (!isBusy || total - song.lenFrames >= RENDER_TAIL)) break;
+        
+        for (int i=0; i < numJobs; i++) {
+            jobs[i].frame  = total;
+            jobs[i].frames = RENDER_WINDOW;
+            poolSubmit(pool, renderTask, &jobs[i]);
+        }
+        poolWait(pool);
+        
+        for (unsigned int j=0; j < RENDER_WINDOW*2; j++) {
+            int32_t smp = 0;
+            
+            for (int i=0; i < numJobs; i++) smp += jobs[i].mix[j];
+            outBuf[j] = smp > 32767 ? 32767 : (smp < -32768 ? -32768 : smp);
+        }
+        if (!numJobs) memset(outBuf, 0, RENDER_WINDOW * 2 * sizeof(int16_t));
+        if (fwrite(outBuf, sizeof(int16_t)*2, RENDER_WINDOW, fout) != RENDER_WINDOW) goto WRERR;
+        total += RENDER_WINDOW;
+    }
+    
+    makeRenderHead(&wHead, total, RENDER_RATE);
+    if (fseek(fout, 0, SEEK_SET) || fwrite(&wHead, sizeof(wav_PcmHead), 1, fout) != 1) goto WRERR;
+    if (fclose(fout)) {
+        fout = NULL;
+        goto WRERR;
+    }
+    fout = NULL;
+    
+    for (int i=0; i < numJobs; i++) {
+        synthDestroy(jobs[i].syn);
+        free(jobs[i].events);
+        free(jobs[i].mix);
+    }
+    free(outBuf);
+    midiFree(&song);
+    unmapfile(&mid);
+    return 1;
+    OOM:
+        printf("renderMidi(): Out of memory!\n");
+        goto ERR;
+    WRERR:
+        printf("renderMidi(): Could not write the file.\n");
+    ERR:
+        if (fout) fclose(fout);
+        for (int i=0; i < numJobs; i++) {
+            synthDestroy(jobs[i].syn);
+            free(jobs[i].events);
+            free(jobs[i].mix);
+        }
+        free(outBuf);
+        midiFree(&song);
+        unmapfile(&mid);
+        return 0;
+}
+
+//-----------------------------------------------
+//AUDITION
+
+#define AUD_SUF      "_aud"
+#define AUD_RATE     (SAMPLE_RATE)    //a whole bank of key sweeps adds up, bank rate keeps it small
+#define AUD_VELOCITY (100)
+#define AUD_NOTE     (AUD_RATE*3/20) //frames each key is held
+#define AUD_STEP     (AUD_RATE/4)    //frames from one key to the next
+#define AUD_TAIL     (AUD_RATE*2)    //longest wait for last key to die out
+#define AUD_BLOCK    (1024)
+
+//one patch through its own synth, keys in order
+typedef struct {
+    void*        base;
+    size_t       len;
+    const wg_PcmCache* pcm;
+    int          interp;
+    unsigned int idx;       //PatchMap slot
+    unsigned int numKeys;
+    uint8_t      keys[128];
+    int          isWritten;
+    char         outName[MAXPATH];
+} AuditionJob;
+
+void auditionTask(void* arg) {
+    AuditionJob* job = arg;
+    int chan = job->idx >> 7 ? SYNTH_DRUMCHAN : 0;
+    uint32_t frames = job->numKeys * AUD_STEP + AUD_TAIL;
+    uint32_t total = 0;
+    wav_PcmHead wHead;
+    wg_IoVec vec[2];
+    wg_Synth* syn;
+    int16_t* out = NULL;
+    int fout;
+    
+    if (!(syn = synthCreate(job->base, job->len, AUD_RATE)) || !(out = malloc(frames * 2 * sizeof(int16_t)))) {
+        printf("auditionTask(): Out of memory!\n");
+        goto END;
+    }
+    synthSetPcm(syn, job->pcm);
+    synthSetInterp(syn, job->interp);
+    synthProgram(syn, chan, job->idx & 127);
+    for (unsigned int k=0; k < job->numKeys; k++) {
+        synthNoteOn(syn, chan, job->keys[k], AUD_VELOCITY);
+        synthRender(syn, out + total*2, AUD_NOTE);
+        synthNoteOff(syn, chan, job->keys[k]);
+        synthRender(syn, out + (total + AUD_NOTE)*2, AUD_STEP - AUD_NOTE);
+        total += AUD_STEP;
+    }
+    //file ends once last key is quiet
+    while (total < frames && synthActiveVoices(syn)) {
+        unsigned int num = frames - total < AUD_BLOCK ? frames - total : AUD_BLOCK;
+        
+        synthRender(syn, out + total*2, num);
+        total += num;
+    }
+    
+    makeRenderHead(&wHead, total, AUD_RATE);
+    vec[0].buf = &wHead;
+    vec[0].len = sizeof(wav_PcmHead);
+    vec[1].buf = out;
+    vec[1].len = total * 4;
+    if ((fout = fileCreate(job->outName)) < 0) goto END;
+    job->isWritten = fileWriteVec(fout, vec, 2);
+    job->isWritten = fileClose(fout) && job->isWritten;
+    if (!job->isWritten) remove(job->outName);
+    
+    END:
+        synthDestroy(syn);
+        free(out);
+}
+
+unsigned int dumpAudition(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts) {
+    wg_TaskGroup group = {0};
+    AuditionJob* jobs;
+    wg_BankIter it;
+    wg_Bank bank;
+    char outName[MAXPATH];
+    unsigned int num = 0, numWritten = 0;
+    
+    if (!bankOpen(&bank, base, len)) return 0;
+    if (strlen(name) + PATH_ROOM > MAXPATH) {
+        printf("dumpAudition(): File name is too long.\n");
+        return 0;
+    }
+    if (!(jobs = malloc(256 * sizeof(AuditionJob)))) {
+        printf("dumpAudition(): Out of memory!\n");
+        return 0;
+    }
+    sprintf(outName, "%s"AUD_SUF, name);
+    makeDir(outName);
+    sprintf(outName, "%s"AUD_SUF"/mel", name);
+    makeDir(outName);
+    sprintf(outName, "%s"AUD_SUF"/drm", name);
+    makeDir(outName);
+    
+    bankIterInit(&it, &bank, 0);
+    while (bankNextPatch(&it)) {
+        AuditionJob* job = &jobs[num];
+        uint8_t isKey[128] = {0};
+        unsigned int i = it.patchIdx;
+        
+        //layered splits play each key once, drum kits only what their drum map has
+        while (bankNextSplit(&it)) {
+            for (unsigned int k=it.split->rangeStart; k <= it.split->rangeEnd && k < 128; k++) isKey[k] = 1;
+        }
+        job->numKeys = 0;
+        for (unsigned int k=0; k < 128; k++) {
+            if (it.drums ? it.drums->tab[k] : isKey[k]) job->keys[job->numKeys++] = k;
+        }
+        if (!job->numKeys) continue;
+        
+        job->base      = base;
+        job->len       = len;
+        job->pcm       = opts ? opts->pcm : NULL;
+        job->interp    = opts ? opts->interp : WG_MIX_LINEAR;
+        job->idx       = i;
+        job->isWritten = 0;
+        sprintf(job->outName, "%s"AUD_SUF"/%s/%03u %03u %s.wav", name, i>>7?"drm":"mel", i&127, i&127, PATNAMES[i]);
+        num++;
+    }
+    
+    for (unsigned int i=0; i < num; i++) poolSubmitGroup(pool, &group, auditionTask, &jobs[i]);
+    poolWaitGroup(pool, &group);
+    for (unsigned int i=0; i < num; i++) numWritten += jobs[i].isWritten;
+    
+    free(jobs);
+    return numWritten;
+}
+
+//-----------------------------------------------
+//TRIM AND REPACK
+
+int trimBank(void* base, size_t len, const uint8_t* keep, char* outName) {
+    wg_EncBank enc;
+    int res;
+    
+    if (!encBankFromWgbank(&enc, base, len)) return 0;
+    res = encBankKeep(&enc, keep) && encBankWrite(&enc, outName);
+    encBankFree(&enc);
+    
+    return res;
+}
+
+int repackBank(void* base, size_t len, const uint8_t* keep, char* outName) {
+    wg_EncBank enc;
+    unsigned int numHdrs, numData;
+    uint8_t* out = NULL;
+    size_t outLen;
+    int res = 0;
+    
+    if (!encBankFromWgbank(&enc, base, len)) return 0;
+    if (keep && !encBankKeep(&enc, keep)) goto END;
+    numHdrs = enc.numHeaders;
+    numData = enc.numData;
+    if (!encBankRepack(&enc) || !(out = encBankBuild(&enc, &outLen))) goto END;
+    if (!(res = writefile(outName, out, outLen))) goto END;
+    printf("%u sample headers -> %u, %u sample blocks -> %u, %u bytes -> %u\n",
+        numHdrs, enc.numHeaders, numData, enc.numData, (unsigned int)len, (unsigned int)outLen);
+    
+    END:
+        free(out);
+        encBankFree(&enc);
+        return res;
+}
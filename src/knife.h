@@ -0,0 +1,73 @@
+#ifndef KNIFE_H
+#define KNIFE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+#include "wgbank.h"
+#include "nameidx.h"
+#include "pool.h"
+#include "resample.h"
+#include "pcmcache.h"
+#include "mixer.h"
+
+//bank description and export, shared by wgknife and wgbench
+
+#define MAXPATH 260
+#define SAMPLE_RATE (22050) //of all bank sample data
+#define PATH_ROOM (24 + SAMPLE_NAME_LEN) //exports add at most folders, a sample or patch name and extension to bank name
+#define EXPORT_AIO_DEPTH (64) //files in flight per export
+#define SMPNAMES b00A5_smpNames
+
+extern SampleIdent b00A5_smpNames[];
+//built from SMPNAMES plus any -n tables, set up before calling anything below
+extern wg_NameIndex smpNameIdx;
+
+//wav export settings
+typedef struct {
+    const char*         store;  //shared sample folder, wavs become hardlinks to one copy per unique sample
+    const wg_Resampler* rs;     //NULL keeps bank rate
+    int                 isFlac; //FLAC instead of wav, frames of each sample are encoded in parallel
+    int                 isSyncIo;//blocking writes from pool tasks instead of io_uring
+    const wg_PcmCache*  pcm;    //decoded samples of this bank, NULL decodes them from it
+    int                 interp; //WG_MIX_INTERP for -render and -audition, anything but linear needs pcm
+} wg_ExportOpts;
+
+int checkWgbankHeader(void* base, size_t len);
+//structures only, read with positioned reads, sample data stays on disk
+//mf->len is what got read, fileLen the whole bank, 0 if file can't be read like that
+int loadBankHead(char* name, MappedFile* mf, size_t* fileLen);
+//size is of outName, SAMPLE_NAME_LEN holds any name
+void getSampleName(char* outName, size_t size, wg_SampleHdr* smpHdr, const wg_NameIndex* names);
+//rs NULL keeps bank rate, pcm can be NULL
+int writeWav(wg_SampleHdr* smpHdr, void* base, const wg_PcmCache* pcm, char* dest, int isTuned, const wg_Resampler* rs);
+//same audio and smpl chunk as writeWav(), pool can be NULL
+int writeFlac(wg_SampleHdr* smpHdr, void* base, const wg_PcmCache* pcm, char* dest, int isTuned, const wg_Resampler* rs, wg_Pool* pool);
+//these never read sample data, base can be just the first len bytes of a fileLen byte bank
+int describeWgbank(FILE* out, void* base, size_t len, size_t fileLen);
+int describeJson(FILE* out, void* base, size_t len, size_t fileLen);
+//idx is PatchMap slot, drums are 128 and up
+int queryPatch(FILE* out, void* base, size_t len, size_t fileLen, unsigned int idx);
+int querySampleAt(FILE* out, void* base, size_t len, size_t fileLen, uint32_t off);
+//outputs go to folders named after name
+//files are written by pool, several banks can be exported at once from inside its tasks
+//opts can be NULL, returns number of wav files actually written
+unsigned int dumpSamples(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts);
+unsigned int dumpSfz(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts);
+//one .sf2 file, store and isFlac are not used
+int dumpSf2(char* name, void* base, size_t len, const wg_ExportOpts* opts);
+//one wav per patch in a folder named after name, every key it plays held for a moment, lowest first
+//patches render in parallel on pool, opts can be NULL, only pcm and interp are used
+//returns number of wav files written
+unsigned int dumpAudition(char* name, void* base, size_t len, wg_Pool* pool, const wg_ExportOpts* opts);
+//opts can be NULL, only pcm and interp are used
+int renderMidi(void* base, size_t len, const wg_ExportOpts* opts, char* midName, char* outName, wg_Pool* pool);
+//keep has 256 flags, one per patch map slot
+int trimBank(void* base, size_t len, const uint8_t* keep, char* outName);
+//sample data deduplicated and ordered by use, headers next to their patches
+//keep can be NULL, otherwise it's -trim first
+int repackBank(void* base, size_t len, const uint8_t* keep, char* outName);
+
+#endif
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "manifest.h"
+
+//bump when anything written by exports changes, old outputs then get rewritten once
+#define MANIFEST_MAGIC "wgknife-manifest 1"
+#define MANIFEST_LINE  (1024)
+
+static int cmpEntryName(const void* a, const void* b) {
+    return strcmp(((const wg_ManifestEntry*)a)->name, ((const wg_ManifestEntry*)b)->name);
+}
+
+static void manifestSort(wg_Manifest* m) {
+    if (m->isSorted) return;
+    qsort(m->entries, m->num, sizeof(wg_ManifestEntry), cmpEntryName);
+    m->isSorted = 1;
+}
+
+void manifestInit(wg_Manifest* m) {
+    m->entries  = NULL;
+    m->num      = 0;
+    m->cap      = 0;
+    m->isSorted = 1;
+}
+
+void manifestFree(wg_Manifest* m) {
+    for (unsigned int i=0; i < m->num; i++) free(m->entries[i].name);
+    free(m->entries);
+    manifestInit(m);
+}
+
+int manifestAdd(wg_Manifest* m, const char* name, uint64_t key) {
+    wg_ManifestEntry* e;
+    
+    if (m->num == m->cap) {
+        unsigned int cap = m->cap ? m->cap*2 : 256;
+        
+        if (!(e = realloc(m->entries, cap * sizeof(wg_ManifestEntry)))) goto OOM;
+        m->entries = e;
+        m->cap     = cap;
+    }
+    e = &m->entries[m->num];
+    if (!(e->name = malloc(strlen(name) + 1))) goto OOM;
+    strcpy(e->name, name);
+    e->key = key;
+    m->num++;
+    m->isSorted = 0;
+    return 1;
+    OOM:
+        printf("manifestAdd(): Out of memory!\n");
+        return 0;
+}
+
+uint64_t manifestFind(wg_Manifest* m, const char* name) {
+    wg_ManifestEntry what, *found;
+    
+    if (!m->num) return 0;
+    manifestSort(m);
+    what.name = (char*)name;
+    found = bsearch(&what, m->entries, m->num, sizeof(wg_ManifestEntry), cmpEntryName);
+    return found ? found->key : 0;
+}
+
+int manifestLoad(wg_Manifest* m, const char* dir) {
+    char path[MANIFEST_LINE], line[MANIFEST_LINE];
+    FILE* f;
+    
+    manifestInit(m);
+    sprintf(path, "%.*s/"MANIFEST_NAME, MANIFEST_LINE - 32, dir);
+    if (!(f = fopen(path, "r"))) return 1;
+    if (!fgets(line, sizeof(line), f) || strncmp(line, MANIFEST_MAGIC"\n", sizeof(MANIFEST_MAGIC))) goto DONE;
+    
+    while (fgets(line, sizeof(line), f)) {
+        char* end;
+        uint64_t key = strtoull(line, &end, 16);
+        size_t len;
+        
+        //broken line, just means that file gets written again
+        if (end != line + 16 || *end != ' ') continue;
+        len = strlen(++end);
+        if (len && end[len-1] == '\n') end[--len] = 0;
+        //stale files get deleted, never anything outside export folder
+        if (!len || *end == '/' || *end == '\\' || strchr(end, ':') || strstr(end, "..")) continue;
+        if (!manifestAdd(m, end, key)) {
+            fclose(f);
+            manifestFree(m);
+            return 0;
+        }
+    }
+    DONE:
+        fclose(f);
+        return 1;
+}
+
+int manifestSave(wg_Manifest* m, const char* dir) {
+    char path[MANIFEST_LINE], tmpPath[MANIFEST_LINE + 8];
+    FILE* f;
+    int isOk;
+    
+    sprintf(path, "%.*s/"MANIFEST_NAME, MANIFEST_LINE - 32, dir);
+    sprintf(tmpPath, "%s.tmp", path);
+    if (!(f = fopen(tmpPath, "w"))) goto ERR;
+    
+    manifestSort(m);
+    fprintf(f, MANIFEST_MAGIC"\n");
+    for (unsigned int i=0; i < m->num; i++) {
+        uint64_t key = m->entries[i].key;
+        
+        if (key) fprintf(f, "%08X%08X %s\n", (uint32_t)(key >> 32), (uint32_t)key, m->entries[i].name);
+    }
+    isOk = !ferror(f);
+    isOk = !fclose(f) && isOk;
+    if (!isOk) goto ERR;
+    
+    //rename() won't replace on Windows
+    remove(path);
+    if (rename(tmpPath, path)) goto ERR;
+    return 1;
+    ERR:
+        printf("manifestSave(): Could not write manifest.\n");
+        remove(tmpPath);
+        return 0;
+}
+
+unsigned int manifestRemoveStale(wg_Manifest* old, wg_Manifest* cur, const char* dir) {
+    char path[MANIFEST_LINE];
+    unsigned int num = 0;
+    
+    manifestSort(cur);
+    for (unsigned int i=0; i < old->num; i++) {
+        wg_ManifestEntry* e = &old->entries[i];
+        
+        if (cur->num && bsearch(e, cur->entries, cur->num, sizeof(wg_ManifestEntry), cmpEntryName)) continue;
+        sprintf(path, "%.*s/%.*s", MANIFEST_LINE/2 - 1, dir, MANIFEST_LINE/2 - 2, e->name);
+        num += !remove(path);
+    }
+    return num;
+}
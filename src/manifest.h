@@ -0,0 +1,36 @@
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <stdint.h>
+
+//what an export wrote last time: one line per output file, key and path relative to export folder
+//key is a hash of everything the file's contents depend on, 0 means "unknown, write it again"
+//a manifest from another WG-Knife format version is ignored as a whole
+
+#define MANIFEST_NAME "wgknife.manifest"
+
+typedef struct {
+    uint64_t key;
+    char*    name;
+} wg_ManifestEntry;
+
+typedef struct {
+    wg_ManifestEntry* entries;
+    unsigned int      num;
+    unsigned int      cap;
+    int               isSorted;
+} wg_Manifest;
+
+void manifestInit(wg_Manifest* m);
+void manifestFree(wg_Manifest* m);
+//missing or outdated file gives an empty manifest, returns 0 only if out of memory
+int manifestLoad(wg_Manifest* m, const char* dir);
+//written to a temp file first, so a crash never leaves a half manifest behind
+int manifestSave(wg_Manifest* m, const char* dir);
+int manifestAdd(wg_Manifest* m, const char* name, uint64_t key);
+//0 if name isn't in it
+uint64_t manifestFind(wg_Manifest* m, const char* name);
+//deletes files listed in old that aren't in cur, returns how many
+unsigned int manifestRemoveStale(wg_Manifest* old, wg_Manifest* cur, const char* dir);
+
+#endif
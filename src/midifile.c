@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "midifile.h"
+
+#define TEMPO_DEFAULT 500000 //us per quarter, 120 BPM
+
+//tempo changes ride along in the event list until timing is resolved
+#define EV_TEMPO 0xFF
+
+typedef struct {
+    uint64_t tick;
+    uint32_t seq;   //keeps order of same tick events stable
+    uint32_t tempo;
+    uint8_t  msg[3];
+} RawEvent;
+
+typedef struct {
+    RawEvent* ev;
+    size_t    num;
+    size_t    cap;
+} RawList;
+
+static uint32_t readBE(const uint8_t* p, int n) {
+    uint32_t v = 0;
+    
+    while (n--) v = v << 8 | *p++;
+    return v;
+}
+
+//variable length quantity, 0 if it runs past end
+static int readVLQ(const uint8_t** p, const uint8_t* end, uint32_t* out) {
+    uint32_t v = 0;
+    
+    for (int i=0; i < 4; i++) {
+        if (*p >= end) return 0;
+        v = v << 7 | (**p & 0x7F);
+        if (!(*(*p)++ & 0x80)) {
+            *out = v;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static RawEvent* rawAdd(RawList* list) {
+    if (list->num == list->cap) {
+        size_t newCap = list->cap ? list->cap*2 : 1024;
+        RawEvent* tmp = realloc(list->ev, newCap * sizeof(RawEvent));
+        
+        if (!tmp) return NULL;
+        list->ev  = tmp;
+        list->cap = newCap;
+    }
+    memset(&list->ev[list->num], 0, sizeof(RawEvent));
+    list->ev[list->num].seq = list->num;
+    return &list->ev[list->num++];
+}
+
+static int cmpRawEvent(const void* a, const void* b) {
+    const RawEvent* eA = a;
+    const RawEvent* eB = b;
+    
+    if (eA->tick != eB->tick) return (eA->tick > eB->tick) - (eA->tick < eB->tick);
+    return (eA->seq > eB->seq) - (eA->seq < eB->seq);
+}
+
+static int parseTrack(RawList* list, const uint8_t* p, const uint8_t* end) {
+    uint64_t tick = 0;
+    uint8_t status = 0;
+    
+    while (p < end) {
+        uint32_t delta, len;
+        RawEvent* ev;
+        
+        if (!readVLQ(&p, end, &delta) || p >= end) return 0;
+        tick += delta;
+        
+        if (*p == 0xFF) {
+            uint8_t type;
+            
+            if (end - p < 2) return 0;
+            type = p[1];
+            p += 2;
+            if (!readVLQ(&p, end, &len) || len > (size_t)(end - p)) return 0;
+            if (type == 0x2F) break;
+            if (type == 0x51 && len == 3) {
+                if (!(ev = rawAdd(list))) return -1;
+                ev->tick   = tick;
+                ev->msg[0] = EV_TEMPO;
+                ev->tempo  = readBE(p, 3);
+            }
+            p += len;
+            continue;
+        }
+        if (*p == 0xF0 || *p == 0xF7) {
+            p++;
+            if (!readVLQ(&p, end, &len) || len > (size_t)(end - p)) return 0;
+            p += len;
+            status = 0;
+            continue;
+        }
+        
+        //running status
+        if (*p & 0x80) status = *p++;
+        if (!(status & 0x80)) return 0;
+        len = (status & 0xE0) == 0xC0 ? 1 : 2;
+        if ((size_t)(end - p) < len) return 0;
+        
+        //aftertouch is of no use to the synth
+        if ((status & 0xF0) != 0xA0 && (status & 0xF0) != 0xD0) {
+            if (!(ev = rawAdd(list))) return -1;
+            ev->tick   = tick;
+            ev->msg[0] = status;
+            ev->msg[1] = p[0] & 0x7F;
+            ev->msg[2] = len > 1 ? p[1] & 0x7F : 0;
+        }
+        p += len;
+    }
+    
+    //last event also marks song length
+    if (!(list->num && list->ev[list->num-1].tick == tick)) {
+        RawEvent* ev = rawAdd(list);
+        
+        if (!ev) return -1;
+        ev->tick   = tick;
+        ev->msg[0] = EV_TEMPO;
+        ev->tempo  = 0;
+    }
+    return 1;
+}
+
+int midiLoad(wg_MidiSong* song, const uint8_t* buf, size_t len, unsigned int rate) {
+    RawList list = {0};
+    const uint8_t* p = buf;
+    const uint8_t* end = buf + len;
+    unsigned int numTracks, division;
+    double ticksPerSec = 0, frame = 0;
+    uint64_t lastTick = 0;
+    uint32_t tempo = TEMPO_DEFAULT;
+    
+    memset(song, 0, sizeof(wg_MidiSong));
+    if (len < 14 || memcmp(p, "MThd", 4) || readBE(p+4, 4) < 6) goto BAD;
+    numTracks = readBE(p+10, 2);
+    division  = readBE(p+12, 2);
+    if (!division) goto BAD;
+    //SMPTE timing doesn't care about tempo
+    if (division & 0x8000) ticksPerSec = (double)(256 - (division >> 8)) * (division & 0xFF);
+    p += 8 + readBE(p+4, 4);
+    
+    for (unsigned int t=0; t < numTracks && end - p >= 8;) {
+        uint32_t chunkLen = readBE(p+4, 4);
+        
+        if (chunkLen > (size_t)(end - p - 8)) goto BAD;
+        if (!memcmp(p, "MTrk", 4)) {
+            int res = parseTrack(&list, p+8, p+8+chunkLen);
+            
+            if (res < 0) goto OOM;
+            if (!res) goto BAD;
+            t++;
+        }
+        p += 8 + chunkLen;
+    }
+    
+    qsort(list.ev, list.num, sizeof(RawEvent), cmpRawEvent);
+    if (!(song->events = malloc((list.num ? list.num : 1) * sizeof(wg_MidiEvent)))) goto OOM;
+    
+    //walk tempo map and turn ticks into frames
+    for (size_t i=0; i < list.num; i++) {
+        RawEvent* ev = &list.ev[i];
+        double secs = ticksPerSec ? (ev->tick - lastTick) / ticksPerSec :
+                      (double)(ev->tick - lastTick) * tempo / 1e6 / division;
+        
+        frame   += secs * rate;
+        lastTick = ev->tick;
+        if (frame > UINT32_MAX) goto BAD;
+        song->lenFrames = frame;
+        
+        if (ev->msg[0] == EV_TEMPO) {
+            if (ev->tempo) tempo = ev->tempo;
+            continue;
+        }
+        song->events[song->num].frame = frame;
+        memcpy(song->events[song->num].msg, ev->msg, 3);
+        song->num++;
+    }
+    
+    free(list.ev);
+    return 1;
+    BAD:
+        printf("midiLoad(): Not a valid MIDI file.\n");
+        goto ERR;
+    OOM:
+        printf("midiLoad(): Out of memory!\n");
+    ERR:
+        free(list.ev);
+        midiFree(song);
+        return 0;
+}
+
+void midiFree(wg_MidiSong* song) {
+    free(song->events);
+    memset(song, 0, sizeof(wg_MidiSong));
+}
@@ -0,0 +1,24 @@
+#ifndef MIDIFILE_H
+#define MIDIFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//Standard MIDI File reader, formats 0/1 (2 gets merged like 1)
+//all tracks end up in one list of channel messages, timed in output frames
+
+typedef struct {
+    uint32_t frame;
+    uint8_t  msg[3];
+} wg_MidiEvent;
+
+typedef struct {
+    wg_MidiEvent* events;
+    size_t        num;
+    uint32_t      lenFrames; //frame of last event, meta ones included
+} wg_MidiSong;
+
+int midiLoad(wg_MidiSong* song, const uint8_t* buf, size_t len, unsigned int rate);
+void midiFree(wg_MidiSong* song);
+
+#endif
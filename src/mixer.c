@@ -0,0 +1,330 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+
+#include "wgbank.h"
+#include "pcmcache.h"
+#include "mixer.h"
+
+//every output frame is worked out in float from its own 32.32 position, the same way in
+//every kernel: taps to float, interpolate, times gain at that frame, round to nearest
+//vector kernels only spread frames over lanes, so they give what scalar gives
+//(x87 builds keep scalar intermediates wider and can be off by one now and then)
+//runs never cross the loop point or sample end, mixVoiceWith() wraps between them
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define MIX_X86
+#include <immintrin.h>
+#endif
+
+#if PCM_GUARD_PRE < MIX_GUARD_PRE || PCM_GUARD_POST < MIX_GUARD_POST
+#error PCM cache guard frames are too few for the interpolators
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define SINC_PHASES (256)
+#define SINC_FIRST  (-(MIX_SINC_TAPS/2 - 1)) //first tap relative to frame playing
+#define FRAC_SCALE  (1.0f / 16777216)        //top 24 bits of position fraction, exact in float
+
+static float sincTab[(SINC_PHASES + 1) * MIX_SINC_TAPS]; //rows of MIX_SINC_TAPS
+static int isSincReady = 0;
+
+//phase p is position fraction p/SINC_PHASES, rows add up to 1 so DC passes unchanged
+void mixInit(void) {
+    if (isSincReady) return;
+    for (int p=0; p <= SINC_PHASES; p++) {
+        double coef[MIX_SINC_TAPS], sum = 0;
+        
+        for (int t=0; t < MIX_SINC_TAPS; t++) {
+            double x = t + SINC_FIRST - (double)p / SINC_PHASES;
+            double w = 0.42 + 0.5 * cos(M_PI * x / (MIX_SINC_TAPS/2)) + 0.08 * cos(2 * M_PI * x / (MIX_SINC_TAPS/2));
+            
+            coef[t] = (x == 0 ? 1 : sin(M_PI * x) / (M_PI * x)) * w;
+            sum += coef[t];
+        }
+        for (int t=0; t < MIX_SINC_TAPS; t++) sincTab[p*MIX_SINC_TAPS + t] = coef[t] / sum;
+    }
+    isSincReady = 1;
+}
+
+void mixVoiceInit(wg_MixVoice* v, const wg_SampleHdr* smpHdr, const int16_t* pcm) {
+    int numChans = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+    
+    v->pcm       = pcm;
+    v->isStereo  = numChans == 2;
+    v->len       = (smpHdr->offEnd - smpHdr->offStart) / numChans;
+    v->isLoop    = smpHdr->offLoop && smpHdr->offLoop >= smpHdr->offStart && smpHdr->offLoop < smpHdr->offEnd;
+    v->loopStart = v->isLoop ? (smpHdr->offLoop - smpHdr->offStart) / numChans : 0;
+    if (v->loopStart >= v->len) v->isLoop = 0;
+    v->pos       = 0;
+    v->step      = (uint64_t)1 << 32;
+    v->gainL = v->gainR = 0;
+    v->incL  = v->incR  = 0;
+}
+
+void mixVoiceGains(wg_MixVoice* v, const wg_Patch* patch, const wg_Split* split, const wg_SampleHdr* smpHdr, int vel, float env, float envInc) {
+    double gain = (double)smpHdr->volume / 256 * patch->volume / 256 * (vel * vel) / (127.0 * 127.0);
+    double pan  = (double)split->pan / (split->pan >= 0 ? 127 : 128);
+    double l    = gain * cos((pan + 1) * M_PI / 4);
+    double r    = gain * sin((pan + 1) * M_PI / 4);
+    
+    v->gainL = l * env;
+    v->gainR = r * env;
+    v->incL  = l * envInc;
+    v->incR  = r * envInc;
+}
+
+//-----------------------------------------------
+//KERNELS
+
+//one channel of frame at p, x is first frame of that channel
+static float interpScalar(const int16_t* x, uint64_t p, int numChans, int interp) {
+    uint32_t frac = (uint32_t)p;
+    float f = (float)(int32_t)(frac >> 8) * FRAC_SCALE;
+    
+    x += (size_t)(p >> 32) * numChans;
+    switch (interp) {
+        case WG_MIX_NEAREST:
+            return x[(frac >> 31) * numChans];
+        case WG_MIX_CUBIC: {
+            float xm1 = x[-numChans], x0 = x[0], x1 = x[numChans], x2 = x[2*numChans];
+            float c1  = 0.5f * (x1 - xm1);
+            float c2  = ((xm1 - 2.5f * x0) + 2.0f * x1) - 0.5f * x2;
+            float c3  = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+            
+            return ((c3 * f + c2) * f + c1) * f + x0;
+        }
+        case WG_MIX_SINC: {
+            const float* coef = sincTab + (((frac >> 23) + 1) >> 1) * MIX_SINC_TAPS;
+            float s = 0;
+            
+            for (int t=0; t < MIX_SINC_TAPS; t++) s += (float)x[(t + SINC_FIRST) * numChans] * coef[t];
+            return s;
+        }
+        default: {
+            float x0 = x[0], x1 = x[numChans];
+            
+            return x0 + (x1 - x0) * f;
+        }
+    }
+}
+
+static void mixRunScalar(const wg_MixVoice* v, int32_t* mix, unsigned int from, unsigned int n, int interp) {
+    int numChans = v->isStereo ? 2 : 1;
+    
+    for (unsigned int i=from; i < n; i++) {
+        uint64_t p = v->pos + i * v->step;
+        float gl = v->gainL + v->incL * (float)(int32_t)i;
+        float gr = v->gainR + v->incR * (float)(int32_t)i;
+        float l  = interpScalar(v->pcm, p, numChans, interp);
+        float r  = v->isStereo ? interpScalar(v->pcm + 1, p, numChans, interp) : l;
+        
+        mix[i*2]   += (int32_t)lrintf(l * gl);
+        mix[i*2+1] += (int32_t)lrintf(r * gr);
+    }
+}
+
+#ifdef MIX_X86
+//positions of lanes from frame i on for SSE4.1, offsets are in int16 from v->pcm
+//nearest rounds the frame here, phase is sinc row
+#define LANES(W) \
+    int32_t offs[W], frac8[W], phase[W]; \
+    for (int j=0; j < W; j++) { \
+        uint64_t p    = v->pos + (i + j) * v->step; \
+        uint32_t frac = (uint32_t)p; \
+        \
+        offs[j]  = (int32_t)((p >> 32) + (interp == WG_MIX_NEAREST ? frac >> 31 : 0)) * numChans; \
+        frac8[j] = frac >> 8; \
+        phase[j] = (((frac >> 23) + 1) >> 1) * MIX_SINC_TAPS; \
+    }
+
+//same arithmetic as interpScalar(), tap(K) gives frame K from the one playing
+#define INTERP(VEC, SET1, ADD, SUB, MUL, tap, coefs, out) \
+    switch (interp) { \
+        case WG_MIX_NEAREST: \
+            out = tap(0); \
+            break; \
+        case WG_MIX_CUBIC: { \
+            VEC xm1 = tap(-1), x0 = tap(0), x1 = tap(1), x2 = tap(2); \
+            VEC c1  = MUL(SET1(0.5f), SUB(x1, xm1)); \
+            VEC c2  = SUB(ADD(SUB(xm1, MUL(SET1(2.5f), x0)), MUL(SET1(2.0f), x1)), MUL(SET1(0.5f), x2)); \
+            VEC c3  = ADD(MUL(SET1(0.5f), SUB(x2, xm1)), MUL(SET1(1.5f), SUB(x0, x1))); \
+            \
+            out = ADD(MUL(ADD(MUL(ADD(MUL(c3, f), c2), f), c1), f), x0); \
+            break; \
+        } \
+        case WG_MIX_SINC: \
+            out = SET1(0); \
+            for (int t=0; t < MIX_SINC_TAPS; t++) out = ADD(out, MUL(tap(t + SINC_FIRST), coefs(t))); \
+            break; \
+        default: { \
+            VEC x0 = tap(0), x1 = tap(1); \
+            \
+            out = ADD(x0, MUL(SUB(x1, x0), f)); \
+            break; \
+        } \
+    }
+
+__attribute__((target("sse4.1")))
+static void mixRunSse41(const wg_MixVoice* v, int32_t* mix, unsigned int n, int interp) {
+    int numChans = v->isStereo ? 2 : 1;
+    unsigned int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        LANES(4)
+        __m128 f  = _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)frac8)), _mm_set1_ps(FRAC_SCALE));
+        __m128 fi = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_setr_epi32(0, 1, 2, 3)));
+        __m128 gl = _mm_add_ps(_mm_set1_ps(v->gainL), _mm_mul_ps(_mm_set1_ps(v->incL), fi));
+        __m128 gr = _mm_add_ps(_mm_set1_ps(v->gainR), _mm_mul_ps(_mm_set1_ps(v->incR), fi));
+        __m128 l, r;
+        __m128i* out = (__m128i*)(mix + i*2);
+        const int16_t* x;
+        
+        //no gathers before AVX2, lanes are filled one by one
+        #define TAP(K) _mm_cvtepi32_ps(_mm_setr_epi32(x[offs[0] + (K)*numChans], x[offs[1] + (K)*numChans], \
+                                                      x[offs[2] + (K)*numChans], x[offs[3] + (K)*numChans]))
+        #define COEFS(T) _mm_setr_ps(sincTab[phase[0] + (T)], sincTab[phase[1] + (T)], \
+                                     sincTab[phase[2] + (T)], sincTab[phase[3] + (T)])
+        x = v->pcm;
+        INTERP(__m128, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, TAP, COEFS, l)
+        r = l;
+        if (v->isStereo) {
+            x = v->pcm + 1;
+            INTERP(__m128, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, TAP, COEFS, r)
+        }
+        #undef TAP
+        #undef COEFS
+        
+        l = _mm_mul_ps(l, gl);
+        r = _mm_mul_ps(r, gr);
+        _mm_storeu_si128(out,     _mm_add_epi32(_mm_loadu_si128(out),     _mm_cvtps_epi32(_mm_unpacklo_ps(l, r))));
+        _mm_storeu_si128(out + 1, _mm_add_epi32(_mm_loadu_si128(out + 1), _mm_cvtps_epi32(_mm_unpackhi_ps(l, r))));
+    }
+    mixRunScalar(v, mix, i, n, interp);
+}
+
+__attribute__((target("avx2")))
+static void mixRunAvx2(const wg_MixVoice* v, int32_t* mix, unsigned int n, int interp) {
+    int numChans = v->isStereo ? 2 : 1;
+    unsigned int i = 0;
+    //64-bit positions of frames 0,1,4,5 and 2,3,6,7, that's the order unpacks put them back in
+    __m256i posA = _mm256_setr_epi64x(v->pos, v->pos + v->step, v->pos + 4*v->step, v->pos + 5*v->step);
+    __m256i posB = _mm256_add_epi64(posA, _mm256_set1_epi64x(2*v->step));
+    __m256i adv  = _mm256_set1_epi64x(8*v->step);
+    
+    for (; i + 8 <= n; i += 8) {
+        //whole frames and fractions of frames 0..7 in order
+        __m256i idx    = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(posA), _mm256_castsi256_ps(posB), _MM_SHUFFLE(3, 1, 3, 1)));
+        __m256i frac   = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(posA), _mm256_castsi256_ps(posB), _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256i vOffs  = interp == WG_MIX_NEAREST ? _mm256_add_epi32(idx, _mm256_srli_epi32(frac, 31)) : idx;
+        __m256i vPhase = _mm256_mullo_epi32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_srli_epi32(frac, 23), _mm256_set1_epi32(1)), 1),
+                                            _mm256_set1_epi32(MIX_SINC_TAPS));
+        __m256 f  = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(frac, 8)), _mm256_set1_ps(FRAC_SCALE));
+        __m256 fi = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+        __m256 gl = _mm256_add_ps(_mm256_set1_ps(v->gainL), _mm256_mul_ps(_mm256_set1_ps(v->incL), fi));
+        __m256 gr = _mm256_add_ps(_mm256_set1_ps(v->gainR), _mm256_mul_ps(_mm256_set1_ps(v->incR), fi));
+        __m256 l, r;
+        __m256i lo, hi;
+        
+        if (numChans == 2) vOffs = _mm256_slli_epi32(vOffs, 1);
+        //32 bits at each int16: low half is left or mono, high half is right of a stereo frame
+        #define GATHER(K) _mm256_i32gather_epi32((const int*)v->pcm, _mm256_add_epi32(vOffs, _mm256_set1_epi32((K)*numChans)), 2)
+        #define TAPL(K) _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(GATHER(K), 16), 16))
+        #define TAPR(K) _mm256_cvtepi32_ps(_mm256_srai_epi32(GATHER(K), 16))
+        #define COEFS(T) _mm256_i32gather_ps(sincTab + (T), vPhase, 4)
+        INTERP(__m256, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, TAPL, COEFS, l)
+        r = l;
+        if (v->isStereo) {
+            INTERP(__m256, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, TAPR, COEFS, r)
+        }
+        #undef GATHER
+        #undef TAPL
+        #undef TAPR
+        #undef COEFS
+        posA = _mm256_add_epi64(posA, adv);
+        posB = _mm256_add_epi64(posB, adv);
+        
+        //unpacks stay inside 128-bit lanes: frames 0,1,4,5 and 2,3,6,7
+        l  = _mm256_mul_ps(l, gl);
+        r  = _mm256_mul_ps(r, gr);
+        lo = _mm256_cvtps_epi32(_mm256_unpacklo_ps(l, r));
+        hi = _mm256_cvtps_epi32(_mm256_unpackhi_ps(l, r));
+        _mm256_storeu_si256((__m256i*)(mix + i*2),
+            _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(mix + i*2)),     _mm256_permute2x128_si256(lo, hi, 0x20)));
+        _mm256_storeu_si256((__m256i*)(mix + i*2 + 8),
+            _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(mix + i*2 + 8)), _mm256_permute2x128_si256(lo, hi, 0x31)));
+    }
+    mixRunScalar(v, mix, i, n, interp);
+}
+#endif
+
+//-----------------------------------------------
+//DISPATCH
+
+int mixSupported(int impl) {
+    switch (impl) {
+        case WG_MIX_AUTO:
+        case WG_MIX_SCALAR:
+            return 1;
+        #ifdef MIX_X86
+        case WG_MIX_SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case WG_MIX_AVX2:
+            return __builtin_cpu_supports("avx2");
+        #endif
+        default:
+            return 0;
+    }
+}
+
+unsigned int mixVoiceWith(int impl, wg_MixVoice* v, int32_t* mix, unsigned int frames, int interp) {
+    unsigned int done = 0;
+    
+    if (impl == WG_MIX_AUTO) {
+        impl = mixSupported(WG_MIX_AVX2)  ? WG_MIX_AVX2  :
+               mixSupported(WG_MIX_SSE41) ? WG_MIX_SSE41 : WG_MIX_SCALAR;
+    }
+    if (!mixSupported(impl)) impl = WG_MIX_SCALAR;
+    if (interp == WG_MIX_SINC && !isSincReady) mixInit();
+    
+    while (done < frames) {
+        uint32_t idx = v->pos >> 32;
+        uint64_t left;
+        unsigned int n;
+        
+        if (idx >= v->len) {
+            if (!v->isLoop) break;
+            idx = v->loopStart + (idx - v->loopStart) % (v->len - v->loopStart);
+            v->pos = (uint64_t)idx << 32 | (uint32_t)v->pos;
+        }
+        //frames until position leaves the sample
+        left = v->step ? ((((uint64_t)v->len << 32) - v->pos) + v->step - 1) / v->step : frames;
+        n    = frames - done < left ? frames - done : (unsigned int)left;
+        
+        switch (impl) {
+            #ifdef MIX_X86
+            case WG_MIX_SSE41:
+                mixRunSse41(v, mix + done*2, n, interp);
+                break;
+            case WG_MIX_AVX2:
+                mixRunAvx2(v, mix + done*2, n, interp);
+                break;
+            #endif
+            default:
+                mixRunScalar(v, mix + done*2, 0, n, interp);
+                break;
+        }
+        v->pos   += n * v->step;
+        v->gainL += v->incL * (float)(int32_t)n;
+        v->gainR += v->incR * (float)(int32_t)n;
+        done     += n;
+    }
+    return done;
+}
+
+unsigned int mixVoice(wg_MixVoice* v, int32_t* mix, unsigned int frames, int interp) {
+    return mixVoiceWith(WG_MIX_AUTO, v, mix, frames, interp);
+}
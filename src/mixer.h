@@ -0,0 +1,59 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wgbank.h"
+
+//plays decoded samples into an interleaved stereo int32 mix, like the synth mixes
+//samples are laid out like pcmcache.h keeps them, interpolators read guard frames around both ends
+//vector kernels do several output frames at once, each lane with its own source position
+//gain is per block: value at first frame and step per frame, envelope, volumes and pan folded in
+
+enum WG_MIX_INTERP {
+    WG_MIX_LINEAR,  //0, the default
+    WG_MIX_NEAREST,
+    WG_MIX_CUBIC,   //4-point Catmull-Rom
+    WG_MIX_SINC,    //MIX_SINC_TAPS taps, Blackman windowed
+    WG_MIX_NUM_INTERP
+};
+
+enum WG_MIX_IMPL {
+    WG_MIX_AUTO,
+    WG_MIX_SCALAR,
+    WG_MIX_SSE41,
+    WG_MIX_AVX2
+};
+
+#define MIX_SINC_TAPS  (8)
+//frames read before and after the one playing, AVX2 reads one int16 past the last tap
+#define MIX_GUARD_PRE  (MIX_SINC_TAPS/2 - 1)
+#define MIX_GUARD_POST (MIX_SINC_TAPS/2 + 1)
+
+typedef struct {
+    const int16_t* pcm;       //first frame
+    uint32_t len;             //in frames
+    uint32_t loopStart;       //in frames, loop runs up to len
+    int      isLoop;
+    int      isStereo;
+    uint64_t pos;             //32.32 frames
+    uint64_t step;            //32.32 frames per output frame
+    float    gainL, gainR;    //at next frame, 1.0 puts int16 samples into mix as they are
+    float    incL, incR;      //per frame
+} wg_MixVoice;
+
+//sinc table, built on first use otherwise, call before threads mix with WG_MIX_SINC
+void mixInit(void);
+//loop as synth plays it, position and gains at 0
+void mixVoiceInit(wg_MixVoice* v, const wg_SampleHdr* smpHdr, const int16_t* pcm);
+//sample * patch * velocity like synth, pan from split, env and envInc are 0..1 and per frame
+void mixVoiceGains(wg_MixVoice* v, const wg_Patch* patch, const wg_Split* split, const wg_SampleHdr* smpHdr, int vel, float env, float envInc);
+//adds to mix, returns frames done, fewer once a sample that doesn't loop is over
+unsigned int mixVoice(wg_MixVoice* v, int32_t* mix, unsigned int frames, int interp);
+
+//for benchmarks and testing, unsupported impl falls back to scalar
+int mixSupported(int impl);
+unsigned int mixVoiceWith(int impl, wg_MixVoice* v, int32_t* mix, unsigned int frames, int interp);
+
+#endif
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "nameidx.h"
+
+//open addressing, linear probing, kept at most half full
+
+static unsigned int hashKey(uint32_t offStart, uint32_t offEnd) {
+    uint64_t h = ((uint64_t)offStart << 32 | offEnd) * 0x9E3779B97F4A7C15ull;
+    
+    return (unsigned int)(h >> 32);
+}
+
+void nameIndexInit(wg_NameIndex* idx) {
+    memset(idx, 0, sizeof(wg_NameIndex));
+}
+
+static int nameIndexGrow(wg_NameIndex* idx) {
+    unsigned int newCap = idx->cap ? idx->cap*2 : 256;
+    wg_NameSlot* newSlots = calloc(newCap, sizeof(wg_NameSlot));
+    
+    if (!newSlots) return 0;
+    for (unsigned int i=0; i < idx->cap; i++) {
+        wg_NameSlot* slot = &idx->slots[i];
+        unsigned int j;
+        
+        if (!slot->name) continue;
+        j = hashKey(slot->offStart, slot->offEnd) & (newCap-1);
+        while (newSlots[j].name) j = (j+1) & (newCap-1);
+        newSlots[j] = *slot;
+    }
+    free(idx->slots);
+    idx->slots = newSlots;
+    idx->cap   = newCap;
+    
+    return 1;
+}
+
+int nameIndexAddOne(wg_NameIndex* idx, uint32_t offStart, uint32_t offEnd, const char* name) {
+    unsigned int i;
+    
+    if ((idx->num+1)*2 > idx->cap && !nameIndexGrow(idx)) {
+        printf("nameIndexAddOne(): Out of memory!\n");
+        return 0;
+    }
+    
+    i = hashKey(offStart, offEnd) & (idx->cap-1);
+    for (; idx->slots[i].name; i = (i+1) & (idx->cap-1)) {
+        if (idx->slots[i].offStart == offStart && idx->slots[i].offEnd == offEnd) return 1;
+    }
+    idx->slots[i].offStart = offStart;
+    idx->slots[i].offEnd   = offEnd;
+    idx->slots[i].name     = name;
+    idx->num++;
+    
+    return 1;
+}
+
+int nameIndexAdd(wg_NameIndex* idx, const SampleIdent* tab) {
+    for (int i=0; tab[i].offStart != 0 && tab[i].offEnd; i++) {
+        if (!nameIndexAddOne(idx, tab[i].offStart, tab[i].offEnd, tab[i].name)) return 0;
+    }
+    
+    return 1;
+}
+
+int nameIndexLoad(wg_NameIndex* idx, char* fileName) {
+    char line[512];
+    int lineNum = 0;
+    FILE* fin = fopen(fileName, "r");
+    
+    if (!fin) {
+        printf("nameIndexLoad(): Could not open the file.\n");
+        return 0;
+    }
+    
+    while (fgets(line, sizeof(line), fin)) {
+        char *p = line, *end, *name, **tmp;
+        unsigned long offStart, offEnd;
+        
+        lineNum++;
+        while (isspace((unsigned char)*p)) p++;
+        if (!*p || *p == '#' || (p[0] == '/' && p[1] == '/')) continue;
+        
+        offStart = strtoul(p, &end, 0);
+        if (end == p) goto BADLINE;
+        p = end;
+        offEnd = strtoul(p, &end, 0);
+        if (end == p || !isspace((unsigned char)*end)) goto BADLINE;
+        p = end;
+        while (isspace((unsigned char)*p)) p++;
+        for (end = p + strlen(p); end > p && isspace((unsigned char)end[-1]); end--);
+        *end = 0;
+        if (!*p) goto BADLINE;
+        //same names manifestLoad() refuses, nothing may lead out of export folder
+        if (strlen(p) >= SAMPLE_NAME_LEN || strpbrk(p, "/\\:") || strstr(p, "..")) goto BADNAME;
+        
+        if (!(tmp = realloc(idx->owned, (idx->numOwned+1) * sizeof(char*)))) goto OOM;
+        idx->owned = tmp;
+        if (!(name = malloc(strlen(p)+1))) goto OOM;
+        strcpy(name, p);
+        idx->owned[idx->numOwned++] = name;
+        if (!nameIndexAddOne(idx, offStart, offEnd, name)) goto ERR;
+        continue;
+        
+        BADLINE:
+            printf("nameIndexLoad(): Malformed line %i.\n", lineNum);
+            goto ERR;
+        BADNAME:
+            printf("nameIndexLoad(): Name on line %i is too long or has path characters in it.\n", lineNum);
+            goto ERR;
+    }
+    fclose(fin);
+    
+    return 1;
+    OOM:
+        printf("nameIndexLoad(): Out of memory!\n");
+    ERR:
+        fclose(fin);
+        return 0;
+}
+
+const char* nameIndexFind(const wg_NameIndex* idx, uint32_t offStart, uint32_t offEnd) {
+    unsigned int i;
+    
+    if (!idx->num) return NULL;
+    i = hashKey(offStart, offEnd) & (idx->cap-1);
+    for (; idx->slots[i].name; i = (i+1) & (idx->cap-1)) {
+        if (idx->slots[i].offStart == offStart && idx->slots[i].offEnd == offEnd) return idx->slots[i].name;
+    }
+    
+    return NULL;
+}
+
+void nameIndexFree(wg_NameIndex* idx) {
+    for (unsigned int i=0; i < idx->numOwned; i++) free(idx->owned[i]);
+    free(idx->owned);
+    free(idx->slots);
+    nameIndexInit(idx);
+}
@@ -0,0 +1,42 @@
+#ifndef NAMEIDX_H
+#define NAMEIDX_H
+
+#include <stdint.h>
+
+//sample names keyed by (offStart, offEnd) of the sample header
+//first name added for a key wins, like the old linear table scan
+
+#define SAMPLE_NAME_LEN (64) //buffer for one name, terminator included
+
+typedef struct {
+    uint32_t offStart;
+    uint32_t offEnd;
+    char* name;
+} SampleIdent;
+
+typedef struct {
+    uint32_t offStart;
+    uint32_t offEnd;
+    const char* name;
+} wg_NameSlot;
+
+typedef struct {
+    wg_NameSlot* slots;
+    unsigned int cap;   //power of 2
+    unsigned int num;
+    //names loaded from files, freed with the index
+    char**       owned;
+    unsigned int numOwned;
+} wg_NameIndex;
+
+void nameIndexInit(wg_NameIndex* idx);
+//table ends with an entry of zero offsets, like b00A5_smpNames
+int nameIndexAdd(wg_NameIndex* idx, const SampleIdent* tab);
+int nameIndexAddOne(wg_NameIndex* idx, uint32_t offStart, uint32_t offEnd, const char* name);
+//text file, one "OFFSTART OFFEND NAME" per line, offsets in C notation(0x for hex)
+//names become file names, longer than SAMPLE_NAME_LEN-1 or with / \ : or .. in them fail the load
+int nameIndexLoad(wg_NameIndex* idx, char* fileName);
+const char* nameIndexFind(const wg_NameIndex* idx, uint32_t offStart, uint32_t offEnd);
+void nameIndexFree(wg_NameIndex* idx);
+
+#endif
@@ -1,11 +1,7 @@
 #ifndef NAMES_H
 #define NAMES_H
 
-typedef struct {
-    uint32_t offStart;
-    uint32_t offEnd;
-    char* name;
-} SampleIdent;
+#include "nameidx.h"
 
 SampleIdent b00A5_smpNames[] = {
     //melodic
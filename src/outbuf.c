@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "outbuf.h"
+
+int obInit(wg_OutBuf* ob, FILE* out) {
+    ob->out     = out;
+    ob->len     = 0;
+    ob->isError = 0;
+    if (!(ob->buf = malloc(OUTBUF_SIZE))) {
+        printf("obInit(): Out of memory!\n");
+        return 0;
+    }
+    return 1;
+}
+
+int obFlush(wg_OutBuf* ob) {
+    if (ob->len && fwrite(ob->buf, 1, ob->len, ob->out) != ob->len) ob->isError = 1;
+    ob->len = 0;
+    return !ob->isError;
+}
+
+int obFree(wg_OutBuf* ob) {
+    int res = obFlush(ob);
+    
+    free(ob->buf);
+    ob->buf = NULL;
+    return res;
+}
+
+//room for num more bytes, num is small except in obChars()
+static char* obReserve(wg_OutBuf* ob, size_t num) {
+    if (ob->len + num > OUTBUF_SIZE) obFlush(ob);
+    return ob->buf + ob->len;
+}
+
+void obChars(wg_OutBuf* ob, const char* s, size_t len) {
+    if (len > OUTBUF_SIZE) {
+        obFlush(ob);
+        if (fwrite(s, 1, len, ob->out) != len) ob->isError = 1;
+        return;
+    }
+    memcpy(obReserve(ob, len), s, len);
+    ob->len += len;
+}
+
+void obStr(wg_OutBuf* ob, const char* s) {
+    obChars(ob, s, strlen(s));
+}
+
+void obSpaces(wg_OutBuf* ob, unsigned int num) {
+    while (num) {
+        unsigned int n = num < 64 ? num : 64;
+        
+        memset(obReserve(ob, n), ' ', n);
+        ob->len += n;
+        num -= n;
+    }
+}
+
+//digits go into tail of tmp, returns count
+static int toDec(char* end, uint32_t v) {
+    int n = 0;
+    
+    do {
+        *--end = '0' + v % 10;
+        v /= 10;
+        n++;
+    } while (v);
+    return n;
+}
+
+static void obPadded(wg_OutBuf* ob, const char* digits, int n, int width, char pad, int isNeg) {
+    int total = n + isNeg;
+    char* p = obReserve(ob, (width > total ? width : total));
+    
+    if (pad == ' ') {
+        for (; width > total; width--) *p++ = ' ';
+        if (isNeg) *p++ = '-';
+    } else {
+        if (isNeg) *p++ = '-';
+        for (; width > total; width--) *p++ = '0';
+    }
+    memcpy(p, digits, n);
+    p += n;
+    ob->len = p - ob->buf;
+}
+
+void obUint(wg_OutBuf* ob, uint32_t v, int width) {
+    char tmp[16];
+    int n = toDec(tmp + 16, v);
+    
+    obPadded(ob, tmp + 16 - n, n, width, ' ', 0);
+}
+
+void obUintZ(wg_OutBuf* ob, uint32_t v, int width) {
+    char tmp[16];
+    int n = toDec(tmp + 16, v);
+    
+    obPadded(ob, tmp + 16 - n, n, width, '0', 0);
+}
+
+void obInt(wg_OutBuf* ob, int32_t v, int width) {
+    char tmp[16];
+    int n = toDec(tmp + 16, v < 0 ? 0u - (uint32_t)v : (uint32_t)v);
+    
+    obPadded(ob, tmp + 16 - n, n, width, ' ', v < 0);
+}
+
+void obHex(wg_OutBuf* ob, uint32_t v, int width) {
+    static const char hex[] = "0123456789ABCDEF";
+    char tmp[8];
+    int n = 0;
+    
+    do {
+        tmp[7 - n++] = hex[v & 15];
+        v >>= 4;
+    } while (v);
+    obPadded(ob, tmp + 8 - n, n, width, '0', 0);
+}
+
+void obFix8(wg_OutBuf* ob, int32_t v) {
+    uint32_t a = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    //hundredths are a*100/256, exact remainder decides rounding
+    uint64_t scaled = (uint64_t)a * 100;
+    uint32_t q = scaled >> 8, r = scaled & 255;
+    char tmp[16];
+    int n;
+    
+    if (r > 128 || (r == 128 && (q & 1))) q++;
+    tmp[15] = '0' + q % 10;
+    tmp[14] = '0' + q / 10 % 10;
+    tmp[13] = '.';
+    n = toDec(tmp + 13, q / 100) + 3;
+    //printf keeps the sign of values that round to zero
+    obPadded(ob, tmp + 16 - n, n, 0, ' ', v < 0);
+}
+
+void obJsonStr(wg_OutBuf* ob, const char* s) {
+    obStr(ob, "\"");
+    for (; *s; s++) {
+        unsigned char c = *s;
+        
+        if (c == '"' || c == '\\') {
+            char esc[2] = {'\\', c};
+            
+            obChars(ob, esc, 2);
+        } else if (c < 0x20) {
+            obStr(ob, "\\u");
+            obHex(ob, c, 4);
+        } else {
+            obChars(ob, (char*)&c, 1);
+        }
+    }
+    obStr(ob, "\"");
+}
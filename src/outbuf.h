@@ -0,0 +1,41 @@
+#ifndef OUTBUF_H
+#define OUTBUF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+//text output collected into one big buffer, flushed with few large fwrite()s
+//number formatting is done by hand, same result as the printf formats named below
+
+#define OUTBUF_SIZE (256<<10)
+
+typedef struct {
+    FILE*  out;
+    char*  buf;
+    size_t len;
+    int    isError;
+} wg_OutBuf;
+
+int obInit(wg_OutBuf* ob, FILE* out);
+//returns 0 if any write failed
+int obFlush(wg_OutBuf* ob);
+//flushes too
+int obFree(wg_OutBuf* ob);
+
+void obChars(wg_OutBuf* ob, const char* s, size_t len);
+void obStr(wg_OutBuf* ob, const char* s);
+void obSpaces(wg_OutBuf* ob, unsigned int num);
+//"%*u", "%0*u"
+void obUint(wg_OutBuf* ob, uint32_t v, int width);
+void obUintZ(wg_OutBuf* ob, uint32_t v, int width);
+//"%*d"
+void obInt(wg_OutBuf* ob, int32_t v, int width);
+//"%0*X"
+void obHex(wg_OutBuf* ob, uint32_t v, int width);
+//"%.2f" of v/256, ties to even like glibc
+void obFix8(wg_OutBuf* ob, int32_t v);
+//quoted and escaped JSON string
+void obJsonStr(wg_OutBuf* ob, const char* s);
+
+#endif
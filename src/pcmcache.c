@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "pcmcache.h"
+#include "bank.h"
+#include "decode.h"
+#include "hash.h"
+
+//bump when layout or guard frames change, old caches then get rebuilt once
+#define PCM_CACHE_MAGIC "WgPCM002"
+#define PCM_CACHE_PATH  (1024)
+
+typedef struct {
+    char     magic[8];
+    uint64_t bankHash;   //wg_hash64() of whole bank
+    uint64_t bankLen;
+    uint32_t numEntries; //wg_PcmEntry table follows
+    uint32_t unused;
+} wg_PcmCacheHead;
+
+static int cmpPcmEntry(const void* a, const void* b) {
+    const wg_PcmEntry* eA = a;
+    const wg_PcmEntry* eB = b;
+    
+    if (eA->offStart != eB->offStart) return eA->offStart < eB->offStart ? -1 : 1;
+    if (eA->offEnd   != eB->offEnd)   return eA->offEnd   < eB->offEnd   ? -1 : 1;
+    if (eA->offLoop  != eB->offLoop)  return eA->offLoop  < eB->offLoop  ? -1 : 1;
+    return (eA->isStereo > eB->isStereo) - (eA->isStereo < eB->isStereo);
+}
+
+static void entryOf(wg_PcmEntry* e, const wg_SampleHdr* smpHdr) {
+    e->offStart = smpHdr->offStart;
+    e->offEnd   = smpHdr->offEnd;
+    e->offLoop  = smpHdr->offLoop;
+    e->isStereo = (smpHdr->flags & WG_FLG_STEREO) != 0;
+    e->pcmOff   = 0;
+}
+
+static uint32_t entryFrames(const wg_PcmEntry* e) {
+    return (e->offEnd - e->offStart) / (e->isStereo ? 2 : 1);
+}
+
+//bytes of frames and guards
+static uint64_t entrySize(const wg_PcmEntry* e) {
+    return ((uint64_t)entryFrames(e) + PCM_GUARD_PRE + PCM_GUARD_POST) * (e->isStereo ? 2 : 1) * sizeof(int16_t);
+}
+
+//-----------------------------------------------
+//OPEN
+
+//file is as untrusted as the bank, every entry has to point inside it
+static int openHashed(wg_PcmCache* c, char* name, size_t len, uint64_t hash) {
+    const wg_PcmCacheHead* head;
+    uint64_t tableEnd;
+    
+    c->entries = NULL;
+    c->num     = 0;
+    if (!isFileExist(name) || !mapfile(name, &c->mf)) return 0;
+    head = c->mf.base;
+    if (c->mf.len < sizeof(wg_PcmCacheHead) || memcmp(head->magic, PCM_CACHE_MAGIC, 8)) goto BAD;
+    if (head->bankLen != len || head->bankHash != hash) goto BAD;
+    tableEnd = sizeof(wg_PcmCacheHead) + (uint64_t)head->numEntries * sizeof(wg_PcmEntry);
+    if (tableEnd > c->mf.len) goto BAD;
+    
+    c->entries = (const wg_PcmEntry*)(head + 1);
+    c->num     = head->numEntries;
+    for (uint32_t i=0; i < c->num; i++) {
+        const wg_PcmEntry* e = &c->entries[i];
+        uint64_t guard = PCM_GUARD_PRE * (e->isStereo ? 2 : 1) * sizeof(int16_t);
+        
+        //sorted for pcmCacheFind()
+        if (i && cmpPcmEntry(&c->entries[i-1], e) >= 0) goto BAD;
+        if (e->isStereo > 1 || e->offStart >= e->offEnd || e->offEnd > len || !entryFrames(e)) goto BAD;
+        if (e->pcmOff & 1 || e->pcmOff < tableEnd + guard || e->pcmOff - guard > c->mf.len) goto BAD;
+        if (entrySize(e) > c->mf.len - (e->pcmOff - guard)) goto BAD;
+    }
+    return 1;
+    BAD:
+        unmapfile(&c->mf);
+        c->entries = NULL;
+        c->num     = 0;
+        return 0;
+}
+
+int pcmCacheOpen(wg_PcmCache* c, char* name, void* base, size_t len) {
+    return openHashed(c, name, len, wg_hash64(base, len, 0));
+}
+
+void pcmCacheClose(wg_PcmCache* c) {
+    if (c->entries) unmapfile(&c->mf);
+    c->entries = NULL;
+    c->num     = 0;
+}
+
+const int16_t* pcmCacheFind(const wg_PcmCache* c, const wg_SampleHdr* smpHdr) {
+    wg_PcmEntry what;
+    const wg_PcmEntry* found;
+    
+    if (!c || !c->num) return NULL;
+    entryOf(&what, smpHdr);
+    found = bsearch(&what, c->entries, c->num, sizeof(wg_PcmEntry), cmpPcmEntry);
+    return found ? (const int16_t*)((const uint8_t*)c->mf.base + found->pcmOff) : NULL;
+}
+
+//-----------------------------------------------
+//BUILD
+
+//frames of one sample with its guards, pcm points at first frame
+static void decodeEntry(const wg_PcmEntry* e, const uint8_t* data, int16_t* pcm) {
+    int numChans = e->isStereo ? 2 : 1;
+    uint32_t frames = entryFrames(e);
+    uint32_t loopStart = (e->offLoop - e->offStart) / numChans;
+    //same loop as synth plays
+    int isLoop = e->offLoop && e->offLoop >= e->offStart && e->offLoop < e->offEnd && loopStart < frames;
+    
+    wg_decode(data, pcm, (size_t)frames * numChans);
+    for (int i=1; i <= PCM_GUARD_PRE; i++) memcpy(pcm - i*numChans, pcm, numChans * sizeof(int16_t));
+    for (uint32_t i=0; i < PCM_GUARD_POST; i++) {
+        uint32_t src = isLoop ? loopStart + i % (frames - loopStart) : frames - 1;
+        
+        memcpy(pcm + ((size_t)frames + i) * numChans, pcm + (size_t)src * numChans, numChans * sizeof(int16_t));
+    }
+}
+
+static int buildHashed(char* name, void* base, size_t len, uint64_t hash) {
+    char tmpName[PCM_CACHE_PATH];
+    wg_PcmEntry* entries = NULL;
+    wg_PcmCacheHead* head;
+    uint8_t* buf = NULL;
+    uint32_t num = 0, cap = 0, numUniq = 0;
+    uint64_t size;
+    wg_BankIter it;
+    wg_Bank bank;
+    wg_IoVec vec;
+    int fout = -1;
+    
+    if (strlen(name) + 5 > sizeof(tmpName) || !bankOpen(&bank, base, len)) return 0;
+    bankIterInit(&it, &bank, WG_ITER_DUMMIES);
+    while (bankNextPatch(&it)) {
+        while (bankNextSplit(&it)) {
+            size_t dataLen;
+            
+            if (!it.smpHdr || !bankSampleData(&bank, it.smpHdr, &dataLen)) continue;
+            if (num == cap) {
+                wg_PcmEntry* tmp;
+                
+                cap = cap ? cap*2 : 256;
+                if (!(tmp = realloc(entries, cap * sizeof(wg_PcmEntry)))) goto OOM;
+                entries = tmp;
+            }
+            entryOf(&entries[num], it.smpHdr);
+            if (entryFrames(&entries[num])) num++;
+        }
+    }
+    if (num) {
+        qsort(entries, num, sizeof(wg_PcmEntry), cmpPcmEntry);
+        for (uint32_t i=0; i < num; i++) {
+            if (!numUniq || cmpPcmEntry(&entries[numUniq-1], &entries[i])) entries[numUniq++] = entries[i];
+        }
+    }
+    
+    size = sizeof(wg_PcmCacheHead) + (uint64_t)numUniq * sizeof(wg_PcmEntry);
+    for (uint32_t i=0; i < numUniq; i++) {
+        wg_PcmEntry* e = &entries[i];
+        
+        e->pcmOff = size + PCM_GUARD_PRE * (e->isStereo ? 2 : 1) * sizeof(int16_t);
+        size += entrySize(e);
+    }
+    if (size > SIZE_MAX || !(buf = malloc(size))) goto OOM;
+    
+    head = (wg_PcmCacheHead*)buf;
+    memset(head, 0, sizeof(wg_PcmCacheHead));
+    memcpy(head->magic, PCM_CACHE_MAGIC, 8);
+    head->bankHash   = hash;
+    head->bankLen    = len;
+    head->numEntries = numUniq;
+    if (numUniq) memcpy(head + 1, entries, numUniq * sizeof(wg_PcmEntry));
+    for (uint32_t i=0; i < numUniq; i++) {
+        decodeEntry(&entries[i], (uint8_t*)base + entries[i].offStart, (int16_t*)(buf + entries[i].pcmOff));
+    }
+    
+    sprintf(tmpName, "%s.tmp", name);
+    vec.buf = buf;
+    vec.len = size;
+    if ((fout = fileCreate(tmpName)) < 0 || !fileWriteVec(fout, &vec, 1)) goto ERR;
+    if (!fileClose(fout)) {
+        fout = -1;
+        goto ERR;
+    }
+    fout = -1;
+    //rename() won't replace on Windows
+    remove(name);
+    if (rename(tmpName, name)) goto ERR;
+    
+    free(entries);
+    free(buf);
+    return 1;
+    OOM:
+        printf("pcmCacheBuild(): Out of memory!\n");
+        free(entries);
+        return 0;
+    ERR:
+        printf("pcmCacheBuild(): Could not write the file.\n");
+        if (fout >= 0) fileClose(fout);
+        remove(tmpName);
+        free(entries);
+        free(buf);
+        return 0;
+}
+
+int pcmCacheBuild(char* name, void* base, size_t len) {
+    return buildHashed(name, base, len, wg_hash64(base, len, 0));
+}
+
+int pcmCacheLoad(wg_PcmCache* c, char* name, void* base, size_t len) {
+    uint64_t hash = wg_hash64(base, len, 0);
+    
+    if (openHashed(c, name, len, hash)) return 1;
+    return buildHashed(name, base, len, hash) && openHashed(c, name, len, hash);
+}
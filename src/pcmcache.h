@@ -0,0 +1,46 @@
+#ifndef PCMCACHE_H
+#define PCMCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+#include "wgbank.h"
+
+//every sample of a bank decoded to int16 once and kept in a file next to it, later runs map it
+//file holds a hash of the whole bank it was made from, a bank that changed in any way gets a new one
+//each sample is interleaved frames with PCM_GUARD_PRE frames before and PCM_GUARD_POST after it:
+//before is the first frame again, after is where playback goes next, loop start on if it loops
+//(loop as synth sees it), otherwise the last frame over and over
+//so interpolating players read past either end without checking, mixer.h sinc taps need the most
+
+#define PCM_CACHE_EXT  ".wgpcm"
+#define PCM_GUARD_PRE  (3)
+#define PCM_GUARD_POST (5)
+
+//one per distinct sample, sorted by offStart, offEnd, offLoop, isStereo
+typedef struct {
+    uint32_t offStart;
+    uint32_t offEnd;
+    uint32_t offLoop;
+    uint32_t isStereo;
+    uint64_t pcmOff;   //of first frame in file, guard frames are before it
+} wg_PcmEntry;
+
+typedef struct wg_PcmCache {
+    MappedFile         mf;
+    const wg_PcmEntry* entries;
+    uint32_t           num;
+} wg_PcmCache;
+
+//0 if file is missing, broken or made from another bank
+int pcmCacheOpen(wg_PcmCache* c, char* name, void* base, size_t len);
+//written to a temp file first, a crash never leaves a half cache behind
+int pcmCacheBuild(char* name, void* base, size_t len);
+//opens name, builds it first if it can't be opened
+int pcmCacheLoad(wg_PcmCache* c, char* name, void* base, size_t len);
+void pcmCacheClose(wg_PcmCache* c);
+//frames of smpHdr, NULL if they aren't in the cache
+const int16_t* pcmCacheFind(const wg_PcmCache* c, const wg_SampleHdr* smpHdr);
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#elif !defined(_WIN32_WINNT)
+//condition variables are Vista and up, has to come before any header, mingw's stdio.h sets its own
+#define _WIN32_WINNT 0x0600
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+
+typedef CRITICAL_SECTION   wg_Mutex;
+typedef CONDITION_VARIABLE wg_Cond;
+typedef HANDLE             wg_Thread;
+
+#define mutexInit(M)    InitializeCriticalSection(M)
+#define mutexFree(M)    DeleteCriticalSection(M)
+#define mutexLock(M)    EnterCriticalSection(M)
+#define mutexUnlock(M)  LeaveCriticalSection(M)
+#define condInit(C)     InitializeConditionVariable(C)
+#define condFree(C)
+#define condWait(C, M)  SleepConditionVariableCS(C, M, INFINITE)
+#define condSignal(C)   WakeConditionVariable(C)
+#define condBroadcast(C) WakeAllConditionVariable(C)
+#define THREADPROC      unsigned __stdcall
+#define THREADLOCAL     __thread
+
+int poolCpuCount(void) {
+    SYSTEM_INFO si;
+    
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+}
+
+static int threadStart(wg_Thread* t, unsigned (__stdcall *fn)(void*), void* arg) {
+    *t = (HANDLE)_beginthreadex(NULL, 0, fn, arg, 0, NULL);
+    return *t != 0;
+}
+
+static void threadJoin(wg_Thread t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+#else
+#include <pthread.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t wg_Mutex;
+typedef pthread_cond_t  wg_Cond;
+typedef pthread_t       wg_Thread;
+
+#define mutexInit(M)    pthread_mutex_init(M, NULL)
+#define mutexFree(M)    pthread_mutex_destroy(M)
+#define mutexLock(M)    pthread_mutex_lock(M)
+#define mutexUnlock(M)  pthread_mutex_unlock(M)
+#define condInit(C)     pthread_cond_init(C, NULL)
+#define condFree(C)     pthread_cond_destroy(C)
+#define condWait(C, M)  pthread_cond_wait(C, M)
+#define condSignal(C)   pthread_cond_signal(C)
+#define condBroadcast(C) pthread_cond_broadcast(C)
+#define THREADPROC      void*
+#define THREADLOCAL     __thread
+
+int poolCpuCount(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    return n > 0 ? n : 1;
+}
+
+static int threadStart(wg_Thread* t, void* (*fn)(void*), void* arg) {
+    return !pthread_create(t, NULL, fn, arg);
+}
+
+static void threadJoin(wg_Thread t) {
+    pthread_join(t, NULL);
+}
+#endif
+
+typedef struct {
+    wg_TaskFn     fn;
+    void*         arg;
+    wg_TaskGroup* group;
+} wg_Task;
+
+//ring buffer, owner works at the back, thieves take from the front
+typedef struct {
+    wg_Task* tasks;
+    unsigned cap, head, len;
+} wg_Deque;
+
+typedef struct {
+    wg_Pool* pool;
+    int      idx;
+} wg_Worker;
+
+//tasks are whole files or banks, so one lock for everything is plenty
+struct wg_Pool {
+    wg_Mutex   lock;
+    wg_Cond    hasWork;
+    wg_Cond    isIdle;
+    wg_Thread* threads;
+    wg_Worker* workers;
+    int        nThreads;
+    //one per worker, last one is for submits from outside
+    wg_Deque*  deques;
+    unsigned   queued;
+    //queued + running
+    unsigned   pending;
+    int        quit;
+};
+
+static THREADLOCAL wg_Worker* curWorker;
+
+static int dequePush(wg_Deque* d, const wg_Task* task) {
+    if (d->len == d->cap) {
+        unsigned newCap = d->cap ? d->cap*2 : 64;
+        wg_Task* newTasks = malloc(newCap * sizeof(wg_Task));
+        
+        if (!newTasks) return 0;
+        for (unsigned i=0; i < d->len; i++) newTasks[i] = d->tasks[(d->head + i) % d->cap];
+        free(d->tasks);
+        d->tasks = newTasks;
+        d->cap   = newCap;
+        d->head  = 0;
+    }
+    d->tasks[(d->head + d->len) % d->cap] = *task;
+    d->len++;
+    return 1;
+}
+
+static int dequePopBack(wg_Deque* d, wg_Task* task) {
+    if (!d->len) return 0;
+    d->len--;
+    *task = d->tasks[(d->head + d->len) % d->cap];
+    return 1;
+}
+
+static int dequePopFront(wg_Deque* d, wg_Task* task) {
+    if (!d->len) return 0;
+    *task = d->tasks[d->head];
+    d->head = (d->head + 1) % d->cap;
+    d->len--;
+    return 1;
+}
+
+//worker index of calling thread, -1 if it isn't one of ours
+static int selfIdx(wg_Pool* pool) {
+    return curWorker && curWorker->pool == pool ? curWorker->idx : -1;
+}
+
+//lock held
+//own newest task first, then outside submits, then oldest of other workers
+static int takeTask(wg_Pool* pool, int self, wg_Task* task) {
+    int n = pool->nThreads;
+    
+    if (!pool->queued) return 0;
+    if (self >= 0 && dequePopBack(&pool->deques[self], task)) goto FOUND;
+    if (dequePopFront(&pool->deques[n], task)) goto FOUND;
+    for (int i=1; i <= n; i++) {
+        if (dequePopFront(&pool->deques[(self + i + n) % n], task)) goto FOUND;
+    }
+    return 0;
+    FOUND:
+        pool->queued--;
+        return 1;
+}
+
+//lock held, runs task unlocked
+static void runTask(wg_Pool* pool, wg_Task* task) {
+    mutexUnlock(&pool->lock);
+    task->fn(task->arg);
+    mutexLock(&pool->lock);
+    
+    //group waiters inside tasks sleep on hasWork
+    if (task->group && !--task->group->pending) {
+        condBroadcast(&pool->isIdle);
+        condBroadcast(&pool->hasWork);
+    }
+    if (!--pool->pending) condBroadcast(&pool->isIdle);
+}
+
+static THREADPROC poolWorker(void* arg) {
+    wg_Worker* self = arg;
+    wg_Pool* pool = self->pool;
+    
+    curWorker = self;
+    mutexLock(&pool->lock);
+    for (;;) {
+        wg_Task task;
+        
+        if (takeTask(pool, self->idx, &task)) {
+            runTask(pool, &task);
+            continue;
+        }
+        if (pool->quit) break;
+        condWait(&pool->hasWork, &pool->lock);
+    }
+    mutexUnlock(&pool->lock);
+    
+    return 0;
+}
+
+wg_Pool* poolCreate(int nThreads) {
+    wg_Pool* pool;
+    
+    if (!(pool = calloc(1, sizeof(wg_Pool)))) goto ERR;
+    mutexInit(&pool->lock);
+    condInit(&pool->hasWork);
+    condInit(&pool->isIdle);
+    if (nThreads <= 1) return pool;
+    
+    if (!(pool->threads = calloc(nThreads, sizeof(wg_Thread)))) goto ERR;
+    if (!(pool->workers = calloc(nThreads, sizeof(wg_Worker)))) goto ERR;
+    if (!(pool->deques  = calloc(nThreads+1, sizeof(wg_Deque)))) goto ERR;
+    //workers look at nThreads while stealing, it has to be final before they start
+    mutexLock(&pool->lock);
+    for (; pool->nThreads < nThreads; pool->nThreads++) {
+        wg_Worker* w = &pool->workers[pool->nThreads];
+        
+        w->pool = pool;
+        w->idx  = pool->nThreads;
+        if (!threadStart(&pool->threads[pool->nThreads], poolWorker, w)) break;
+    }
+    mutexUnlock(&pool->lock);
+    //could be running with less threads, but not none
+    if (!pool->nThreads) goto ERR;
+    
+    return pool;
+    ERR:
+        printf("poolCreate(): Could not start workers.\n");
+        poolDestroy(pool);
+        return NULL;
+}
+
+int poolSubmit(wg_Pool* pool, wg_TaskFn fn, void* arg) {
+    return poolSubmitGroup(pool, NULL, fn, arg);
+}
+
+int poolSubmitGroup(wg_Pool* pool, wg_TaskGroup* group, wg_TaskFn fn, void* arg) {
+    wg_Task task;
+    int self;
+    
+    if (!pool->nThreads) {
+        fn(arg);
+        return 1;
+    }
+    
+    task.fn    = fn;
+    task.arg   = arg;
+    task.group = group;
+    self = selfIdx(pool);
+    mutexLock(&pool->lock);
+    if (!dequePush(&pool->deques[self >= 0 ? self : pool->nThreads], &task)) {
+        mutexUnlock(&pool->lock);
+        printf("poolSubmit(): Out of memory!\n");
+        return 0;
+    }
+    if (group) group->pending++;
+    pool->queued++;
+    pool->pending++;
+    condSignal(&pool->hasWork);
+    mutexUnlock(&pool->lock);
+    
+    return 1;
+}
+
+void poolWait(wg_Pool* pool) {
+    mutexLock(&pool->lock);
+    while (pool->pending) condWait(&pool->isIdle, &pool->lock);
+    mutexUnlock(&pool->lock);
+}
+
+void poolWaitGroup(wg_Pool* pool, wg_TaskGroup* group) {
+    int self = selfIdx(pool);
+    
+    mutexLock(&pool->lock);
+    while (group->pending) {
+        wg_Task task;
+        
+        if (self < 0) {
+            condWait(&pool->isIdle, &pool->lock);
+        } else if (takeTask(pool, self, &task)) {
+            runTask(pool, &task);
+        } else {
+            condWait(&pool->hasWork, &pool->lock);
+        }
+    }
+    mutexUnlock(&pool->lock);
+}
+
+void poolDestroy(wg_Pool* pool) {
+    if (!pool) return;
+    
+    mutexLock(&pool->lock);
+    pool->quit = 1;
+    condBroadcast(&pool->hasWork);
+    mutexUnlock(&pool->lock);
+    for (int i=0; i < pool->nThreads; i++) threadJoin(pool->threads[i]);
+    
+    condFree(&pool->hasWork);
+    condFree(&pool->isIdle);
+    mutexFree(&pool->lock);
+    if (pool->deques) {
+        for (int i=0; i <= pool->nThreads; i++) free(pool->deques[i].tasks);
+    }
+    free(pool->deques);
+    free(pool->workers);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,28 @@
+#ifndef POOL_H
+#define POOL_H
+
+//work-stealing worker pool
+//every worker has own queue, tasks submitted by a task go there and run newest first,
+//idle workers steal oldest ones from others, submits from outside go to a shared queue
+//pool with 0 threads runs every task inside poolSubmit(), in order
+
+typedef void (*wg_TaskFn)(void* arg);
+typedef struct wg_Pool wg_Pool;
+
+//tasks that can be waited for together, zero it before use
+typedef struct {
+    unsigned pending;
+} wg_TaskGroup;
+
+int poolCpuCount(void);
+wg_Pool* poolCreate(int nThreads);
+int poolSubmit(wg_Pool* pool, wg_TaskFn fn, void* arg);
+//group can be NULL
+int poolSubmitGroup(wg_Pool* pool, wg_TaskGroup* group, wg_TaskFn fn, void* arg);
+//waits for all tasks, don't call from inside one
+void poolWait(wg_Pool* pool);
+//from inside a task, runs other tasks while waiting instead of blocking a worker
+void poolWaitGroup(wg_Pool* pool, wg_TaskGroup* group);
+void poolDestroy(wg_Pool* pool);
+
+#endif
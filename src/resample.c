@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "resample.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define RESAMPLE_X86
+#include <immintrin.h>
+#endif
+
+#define MAX_PHASES   (8192)
+#define BASE_TAPS    (32)    //taps when not going down in rate
+#define MAX_TAPS     (256)
+#define KAISER_BETA  (8.6)
+#define PASSBAND     (0.95)  //cutoff, part of lower Nyquist
+
+//rounds half away from zero
+static int16_t toPcm(float v) {
+    if (v >= 32767) return 32767;
+    if (v <= -32768) return -32768;
+    return (int16_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+//x is padded input of one channel, output goes to every numChans-th slot
+//output n sits at input n*down/up, whole part i and phase p are stepped instead of divided
+//8 partial sums, vector kernel keeps the same ones in its lanes
+static void filterScalar(const wg_Resampler* rs, const float* x, int16_t* out, size_t outLen, int numChans) {
+    size_t i = 0;
+    uint32_t p = 0;
+    
+    for (size_t n=0; n < outLen; n++) {
+        const float* h  = rs->coefs + (size_t)p * rs->taps;
+        //taps start at i - taps/2 + 1, pad shifts that by taps/2
+        const float* xi = x + i + 1;
+        float acc[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        
+        for (unsigned int k=0; k < rs->taps; k += 8) {
+            for (int j=0; j < 8; j++) acc[j] += xi[k+j] * h[k+j];
+        }
+        for (int j=0; j < 4; j++) acc[j] += acc[j+4];
+        out[n*numChans] = toPcm((acc[0] + acc[2]) + (acc[1] + acc[3]));
+        
+        p += rs->down;
+        while (p >= rs->up) {
+            p -= rs->up;
+            i++;
+        }
+    }
+}
+
+#ifdef RESAMPLE_X86
+__attribute__((target("sse")))
+static void filterSse(const wg_Resampler* rs, const float* x, int16_t* out, size_t outLen, int numChans) {
+    size_t i = 0;
+    uint32_t p = 0;
+    
+    for (size_t n=0; n < outLen; n++) {
+        const float* h  = rs->coefs + (size_t)p * rs->taps;
+        const float* xi = x + i + 1;
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        float lanes[4];
+        
+        //two chains so adds don't wait on each other
+        for (unsigned int k=0; k < rs->taps; k += 8) {
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(xi + k),     _mm_loadu_ps(h + k)));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(xi + k + 4), _mm_loadu_ps(h + k + 4)));
+        }
+        _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+        out[n*numChans] = toPcm((lanes[0] + lanes[2]) + (lanes[1] + lanes[3]));
+        
+        p += rs->down;
+        while (p >= rs->up) {
+            p -= rs->up;
+            i++;
+        }
+    }
+}
+#endif
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+//zeroth order modified Bessel function, series converges fast for our betas
+static double besselI0(double x) {
+    double sum = 1, term = 1;
+    
+    for (int k=1; k < 64 && term > sum * 1e-12; k++) {
+        term *= (x / (2*k)) * (x / (2*k));
+        sum  += term;
+    }
+    return sum;
+}
+
+int resamplerInit(wg_Resampler* rs, uint32_t inRate, uint32_t outRate) {
+    uint32_t g;
+    double fc, half;
+    
+    rs->coefs = NULL;
+    if (!inRate || !outRate) goto BAD;
+    g = gcd(inRate, outRate);
+    rs->inRate  = inRate;
+    rs->outRate = outRate;
+    rs->up      = outRate / g;
+    rs->down    = inRate / g;
+    if (rs->up > MAX_PHASES) goto BAD;
+    
+    //going down, filter gets wider to cut at the new Nyquist
+    fc = (rs->up < rs->down ? (double)rs->up / rs->down : 1.0) * PASSBAND;
+    rs->taps = (unsigned int)ceil(BASE_TAPS / fc);
+    rs->taps = (rs->taps + 7) & ~7u;
+    if (rs->taps > MAX_TAPS) goto BAD;
+    half = rs->taps / 2;
+    
+    if (!(rs->coefs = malloc((size_t)rs->up * rs->taps * sizeof(float)))) {
+        printf("resamplerInit(): Out of memory!\n");
+        return 0;
+    }
+    for (uint32_t p=0; p < rs->up; p++) {
+        float* h = rs->coefs + (size_t)p * rs->taps;
+        double sum = 0;
+        
+        for (unsigned int k=0; k < rs->taps; k++) {
+            //tap k sits at input frame i - taps/2 + 1 + k, output at i + p/up
+            double d = k - half + 1 - (double)p / rs->up;
+            double x = d / half;
+            double w = fabs(x) < 1 ? besselI0(KAISER_BETA * sqrt(1 - x*x)) / besselI0(KAISER_BETA) : 0;
+            double s = d ? sin(M_PI * fc * d) / (M_PI * fc * d) : 1;
+            
+            h[k] = fc * s * w;
+            sum += h[k];
+        }
+        //unity gain at DC in every phase, no ripple from phase to phase
+        for (unsigned int k=0; k < rs->taps; k++) h[k] /= sum;
+    }
+    
+    return 1;
+    BAD:
+        printf("resamplerInit(): Unsupported rate.\n");
+        return 0;
+}
+
+void resamplerFree(wg_Resampler* rs) {
+    free(rs->coefs);
+    rs->coefs = NULL;
+}
+
+size_t resampleLen(const wg_Resampler* rs, size_t len) {
+    return ((uint64_t)len * rs->up + rs->down - 1) / rs->down;
+}
+
+uint32_t resamplePos(const wg_Resampler* rs, uint32_t pos) {
+    return ((uint64_t)pos * rs->up + rs->down / 2) / rs->down;
+}
+
+int resample(const wg_Resampler* rs, const int16_t* in, size_t len, int numChans, size_t loopStart, int16_t* out) {
+    void (*filter)(const wg_Resampler*, const float*, int16_t*, size_t, int) = filterScalar;
+    size_t pre = rs->taps / 2, padLen = pre + len + rs->taps;
+    size_t outLen = resampleLen(rs, len);
+    float* x;
+
+    #ifdef RESAMPLE_X86
+    if (__builtin_cpu_supports("sse")) filter = filterSse;
+    #endif
+    if (!(x = malloc(padLen * sizeof(float)))) {
+        printf("resample(): Out of memory!\n");
+        return 0;
+    }
+    
+    for (int c=0; c < numChans; c++) {
+        //silence before, loop or silence after
+        for (size_t i=0; i < pre; i++) x[i] = 0;
+        for (size_t i=0; i < len; i++) x[pre + i] = in[i*numChans + c];
+        for (size_t i=0; i < rs->taps; i++) {
+            x[pre + len + i] = loopStart < len ? in[(loopStart + i % (len - loopStart))*numChans + c] : 0;
+        }
+        filter(rs, x, out + c, outLen, numChans);
+    }
+    
+    free(x);
+    return 1;
+}
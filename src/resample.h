@@ -0,0 +1,30 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//polyphase windowed-sinc resampler for whole samples
+//ratio is kept exact as outRate/inRate = up/down, one Kaiser windowed filter per phase
+//vector kernel sums in same order as scalar one, output doesn't depend on CPU
+
+typedef struct {
+    uint32_t inRate, outRate;
+    uint32_t up, down;
+    unsigned int taps;   //per phase, multiple of 8
+    float*       coefs;  //up * taps, phase by phase
+} wg_Resampler;
+
+//fails for ratios that would need too many phases
+int resamplerInit(wg_Resampler* rs, uint32_t inRate, uint32_t outRate);
+void resamplerFree(wg_Resampler* rs);
+//output frames for len input frames
+size_t resampleLen(const wg_Resampler* rs, size_t len);
+//input frame position to nearest output one, for loop points
+uint32_t resamplePos(const wg_Resampler* rs, uint32_t pos);
+//interleaved frames of 1 or 2 channels, out holds resampleLen(len)
+//looped samples keep playing the loop past their end, so loop seam stays clean
+//loopStart is SIZE_MAX for no loop
+int resample(const wg_Resampler* rs, const int16_t* in, size_t len, int numChans, size_t loopStart, int16_t* out);
+
+#endif
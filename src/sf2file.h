@@ -0,0 +1,117 @@
+#ifndef SF2FILE_H
+#define SF2FILE_H
+
+//SoundFont 2.01 structures, as laid out in the spec
+
+#pragma pack(1)
+
+// RIFF chunk IDs
+#define SF2ID_sfbk      0x6b626673
+#define SF2ID_INFO      0x4f464e49
+#define SF2ID_ifil      0x6c696669
+#define SF2ID_isng      0x676e7369
+#define SF2ID_INAM      0x4d414e49
+#define SF2ID_ISFT      0x54465349
+#define SF2ID_sdta      0x61746473
+#define SF2ID_smpl      0x6c706d73
+#define SF2ID_pdta      0x61746470
+#define SF2ID_phdr      0x72646870
+#define SF2ID_pbag      0x67616270
+#define SF2ID_pmod      0x646f6d70
+#define SF2ID_pgen      0x6e656770
+#define SF2ID_inst      0x74736e69
+#define SF2ID_ibag      0x67616269
+#define SF2ID_imod      0x646f6d69
+#define SF2ID_igen      0x6e656769
+#define SF2ID_shdr      0x72646873
+
+// Generators WG-Knife uses
+#define SF2GEN_pan                  17
+#define SF2GEN_attackVolEnv         34
+#define SF2GEN_decayVolEnv          36
+#define SF2GEN_sustainVolEnv        37
+#define SF2GEN_releaseVolEnv        38
+#define SF2GEN_instrument           41
+#define SF2GEN_keyRange             43
+#define SF2GEN_initialAttenuation   48
+#define SF2GEN_coarseTune           51
+#define SF2GEN_fineTune             52
+#define SF2GEN_sampleID             53
+#define SF2GEN_sampleModes          54
+#define SF2GEN_scaleTuning          56
+#define SF2GEN_exclusiveClass       57
+
+// sfSampleType
+#define SF2_MONO        1
+#define SF2_RIGHT       2
+#define SF2_LEFT        4
+
+#define SF2_SAMPLE_PAD  46  // zero points after every sample
+
+typedef struct sf2_Chunk {
+    uint32_t id;
+    uint32_t len;
+} sf2_Chunk;
+
+
+typedef struct sf2_List {
+    uint32_t id;        // "LIST" or "RIFF"
+    uint32_t len;
+    uint32_t type;
+} sf2_List;
+
+
+typedef struct sf2_PresetHdr {
+    char     name[20];
+    uint16_t preset;
+    uint16_t bank;      // 128 for drums
+    uint16_t bagNdx;
+    uint32_t library;
+    uint32_t genre;
+    uint32_t morphology;
+} sf2_PresetHdr;
+
+
+typedef struct sf2_Bag {
+    uint16_t genNdx;
+    uint16_t modNdx;
+} sf2_Bag;
+
+
+typedef struct sf2_Mod {
+    uint16_t srcOper;
+    uint16_t destOper;
+    int16_t  amount;
+    uint16_t amtSrcOper;
+    uint16_t transOper;
+} sf2_Mod;
+
+
+typedef struct sf2_Gen {
+    uint16_t oper;
+    uint16_t amount;    // signed, or lo byte/hi byte for ranges
+} sf2_Gen;
+
+
+typedef struct sf2_Inst {
+    char     name[20];
+    uint16_t bagNdx;
+} sf2_Inst;
+
+
+typedef struct sf2_SampleHdr {
+    char     name[20];
+    uint32_t start;     // in points from start of smpl chunk
+    uint32_t end;       // first point after sample
+    uint32_t startLoop;
+    uint32_t endLoop;   // first point after loop
+    uint32_t sampleRate;
+    uint8_t  originalPitch;
+    int8_t   pitchCorrection;
+    uint16_t sampleLink;
+    uint16_t sampleType;
+} sf2_SampleHdr;
+
+#pragma pack()
+
+#endif
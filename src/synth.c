@@ -0,0 +1,575 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "wgbank.h"
+#include "pcmcache.h"
+#include "mixer.h"
+#include "synth.h"
+
+#define SRC_RATE   22050    //bank sample rate
+#define ENV_UNITS  64       //envelope lengths in 1/64s, same guess as SFZ export
+#define ENV_ONE    (1<<24)
+#define GAIN_ONE   (1<<15)
+#define GAIN_MAX   (1<<16)  //keeps sample*gain inside int32
+#define MASTER     (GAIN_ONE/2)
+#define SUB_FRAMES 64       //synthRender() works in blocks of this many frames
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+enum ENV_STAGE {
+    ENV_OFF,
+    ENV_ATTACK,
+    ENV_DECAY,
+    ENV_SUSTAIN,
+    ENV_RELEASE
+};
+
+typedef struct {
+    const uint8_t*      data;
+    const int16_t*      pcm;  //decoded with guard frames, NULL plays data
+    const wg_SampleHdr* smpHdr;
+    uint32_t len;        //in frames
+    uint32_t loopStart;  //in frames, loop runs up to len
+    int      isLoop;
+    int      isStereo;
+    uint64_t pos;        //32.32 frames
+    uint64_t step;       //32.32 frames per output frame
+    int32_t  pitch;      //8.8 semitones above SRC_RATE, without bend
+    int32_t  volume;     //Q15, sample * patch * velocity
+    int      pan;        //split pan, -128..127
+    int32_t  gainL;      //Q15, volume with channel controllers folded in
+    int32_t  gainR;
+    int32_t  env;        //Q24
+    int32_t  envInc;
+    int32_t  envSustain;
+    int      stage;
+    int      chan;
+    int      note;
+    int      isHeld;     //note off came while sustain pedal was down
+    unsigned int age;
+} wg_Voice;
+
+typedef struct {
+    int prog;
+    int volume;      //CC7
+    int expression;  //CC11
+    int pan;         //CC10
+    int sustain;     //CC64
+    int bend;        //-8192..8191
+    int bendRange;   //semitones
+} wg_Channel;
+
+struct wg_Synth {
+    const uint8_t* base;
+    size_t         len;
+    unsigned int   rate;
+    unsigned int   clock;
+    const wg_PcmCache* pcm;
+    int            interp; //WG_MIX_INTERP, only voices playing from pcm use it
+    wg_Channel     chans[SYNTH_CHANNELS];
+    wg_Voice       voices[SYNTH_VOICES];
+};
+
+wg_Synth* synthCreate(void* base, size_t len, unsigned int rate) {
+    wg_Synth* syn;
+    
+    if (len < MIDIMAP_OFF + sizeof(wg_PatchMap) || !rate) return NULL;
+    if (!(syn = calloc(1, sizeof(wg_Synth)))) return NULL;
+    syn->base = base;
+    syn->len  = len;
+    syn->rate = rate;
+    synthReset(syn);
+    
+    return syn;
+}
+
+void synthDestroy(wg_Synth* syn) {
+    free(syn);
+}
+
+void synthSetPcm(wg_Synth* syn, const wg_PcmCache* pcm) {
+    syn->pcm = pcm;
+}
+
+void synthSetInterp(wg_Synth* syn, int interp) {
+    syn->interp = interp >= 0 && interp < WG_MIX_NUM_INTERP ? interp : WG_MIX_LINEAR;
+}
+
+void synthReset(wg_Synth* syn) {
+    for (int i=0; i < SYNTH_CHANNELS; i++) {
+        wg_Channel* ch = &syn->chans[i];
+        
+        ch->prog       = 0;
+        ch->volume     = 100;
+        ch->expression = 127;
+        ch->pan        = 64;
+        ch->sustain    = 0;
+        ch->bend       = 0;
+        ch->bendRange  = 2;
+    }
+    for (int i=0; i < SYNTH_VOICES; i++) syn->voices[i].stage = ENV_OFF;
+}
+
+int synthActiveVoices(const wg_Synth* syn) {
+    int num = 0;
+    
+    for (int i=0; i < SYNTH_VOICES; i++) num += syn->voices[i].stage != ENV_OFF;
+    return num;
+}
+
+//-----------------------------------------------
+//VOICE SETUP
+
+static const void* bankPtr(const wg_Synth* syn, uint32_t off, size_t size) {
+    if (off > syn->len || size > syn->len - off) return NULL;
+    return syn->base + off;
+}
+
+//dummy patches fall back to first one of the same bank, like GM players do
+static const wg_Patch* getPatch(const wg_Synth* syn, int chan) {
+    const wg_PatchMap* midiMap = (const wg_PatchMap*)(syn->base + MIDIMAP_OFF);
+    int idx = (chan == SYNTH_DRUMCHAN ? 128 : 0) | (syn->chans[chan].prog & 127);
+    
+    for (int i=0; i < 2; i++, idx &= 128) {
+        const wg_Patch* patch = bankPtr(syn, midiMap->t[idx], sizeof(wg_Patch));
+        
+        if (patch && patch->volume) return patch;
+    }
+    return NULL;
+}
+
+static void updateStep(const wg_Synth* syn, wg_Voice* v) {
+    const wg_Channel* ch = &syn->chans[v->chan];
+    double semis = (v->pitch + (double)ch->bend * ch->bendRange * 256 / 8192) / 256;
+    
+    v->step = (uint64_t)(pow(2.0, semis / 12) * SRC_RATE / syn->rate * 4294967296.0);
+}
+
+static void updateGain(const wg_Synth* syn, wg_Voice* v) {
+    const wg_Channel* ch = &syn->chans[v->chan];
+    //squared volume and linear expression, as GM suggests
+    double gain = (double)v->volume * MASTER / GAIN_ONE
+                * (ch->volume * ch->volume) / (127.0 * 127.0) * ch->expression / 127.0;
+    double pan = (double)v->pan / (v->pan >= 0 ? 127 : 128) + (ch->pan - 64) / 64.0;
+    double l, r;
+    
+    //constant power
+    if (pan < -1) pan = -1;
+    if (pan >  1) pan =  1;
+    l = gain * cos((pan + 1) * M_PI / 4);
+    r = gain * sin((pan + 1) * M_PI / 4);
+    v->gainL = l > GAIN_MAX ? GAIN_MAX : l;
+    v->gainR = r > GAIN_MAX ? GAIN_MAX : r;
+}
+
+static int32_t envSamples(const wg_Synth* syn, uint16_t len) {
+    int32_t n = (int32_t)len * syn->rate / ENV_UNITS;
+    
+    return n ? n : 1;
+}
+
+//moves voice to next stage whose target isn't reached yet
+static void envNextStage(const wg_Synth* syn, wg_Voice* v) {
+    const wg_SampleHdr* smpHdr = v->smpHdr;
+    
+    switch (v->stage) {
+        case ENV_ATTACK:
+            v->env   = ENV_ONE;
+            v->stage = ENV_DECAY;
+            if (smpHdr->lenDecay && v->envSustain < ENV_ONE) {
+                v->envInc = -((ENV_ONE - v->envSustain) / envSamples(syn, smpHdr->lenDecay));
+                if (!v->envInc) v->envInc = -1;
+                break;
+            }
+            //fallthrough
+        case ENV_DECAY:
+            v->env    = v->envSustain;
+            v->envInc = 0;
+            v->stage  = v->env ? ENV_SUSTAIN : ENV_OFF;
+            break;
+        case ENV_RELEASE:
+            v->stage = ENV_OFF;
+            break;
+    }
+}
+
+static void startRelease(const wg_Synth* syn, wg_Voice* v) {
+    v->isHeld = 0;
+    if (v->stage == ENV_OFF || v->stage == ENV_RELEASE) return;
+    if (!v->smpHdr->lenRelease || !v->env) {
+        v->stage = ENV_OFF;
+        return;
+    }
+    v->stage  = ENV_RELEASE;
+    v->envInc = -(v->env / envSamples(syn, v->smpHdr->lenRelease));
+    if (!v->envInc) v->envInc = -1;
+}
+
+static wg_Voice* allocVoice(wg_Synth* syn) {
+    wg_Voice* best = NULL;
+    
+    //free one, then quietest releasing one, then oldest
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        
+        if (v->stage == ENV_OFF) return v;
+        if (v->stage == ENV_RELEASE && (!best || best->stage != ENV_RELEASE || v->env < best->env)) best = v;
+    }
+    if (best) return best;
+    
+    best = &syn->voices[0];
+    for (int i=1; i < SYNTH_VOICES; i++) {
+        if (syn->clock - syn->voices[i].age > syn->clock - best->age) best = &syn->voices[i];
+    }
+    return best;
+}
+
+static void startVoice(wg_Synth* syn, int chan, int note, int vel, const wg_Patch* patch, const wg_Split* split) {
+    const wg_SampleHdr* smpHdr = bankPtr(syn, split->smpHeadOff, sizeof(wg_SampleHdr));
+    int numChans, keytrack;
+    wg_Voice* v;
+    
+    if (!smpHdr || smpHdr->offEnd > syn->len || smpHdr->offStart >= smpHdr->offEnd) return;
+    numChans = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
+    if ((smpHdr->offEnd - smpHdr->offStart) / numChans < 2) return;
+    
+    v = allocVoice(syn);
+    v->smpHdr    = smpHdr;
+    v->data      = syn->base + smpHdr->offStart;
+    v->pcm       = pcmCacheFind(syn->pcm, smpHdr);
+    v->isStereo  = numChans == 2;
+    v->len       = (smpHdr->offEnd - smpHdr->offStart) / numChans;
+    v->isLoop    = smpHdr->offLoop && smpHdr->offLoop >= smpHdr->offStart && smpHdr->offLoop < smpHdr->offEnd;
+    v->loopStart = v->isLoop ? (smpHdr->offLoop - smpHdr->offStart) / numChans : 0;
+    if (v->loopStart >= v->len) v->isLoop = 0;
+    v->pos       = 0;
+    v->chan      = chan;
+    v->note      = note;
+    v->isHeld    = 0;
+    v->age       = syn->clock++;
+    
+    //same mapping as SFZ export: transpose=12, pitch_keytrack from flags, keycenter 60
+    keytrack = smpHdr->flags & WG_FLG_FIXEDNOTE ? 0 : (smpHdr->flags & WG_FLG_ATONAL ? 50 : 100);
+    v->pitch = 12*256 + smpHdr->tuning + split->tuning + patch->tuning + (note - 60) * 256 * keytrack / 100;
+    updateStep(syn, v);
+    
+    v->volume = (double)GAIN_ONE * smpHdr->volume / 256 * patch->volume / 256 * (vel * vel) / (127.0 * 127.0);
+    v->pan    = split->pan;
+    updateGain(syn, v);
+    
+    //no decay stage means it never decays, sustain level of those is often 0
+    v->envSustain = !smpHdr->lenDecay ? ENV_ONE :
+                    smpHdr->volSustain >= 256 ? ENV_ONE : ((int32_t)smpHdr->volSustain << 16);
+    v->env    = 0;
+    v->envInc = 0;
+    v->stage  = ENV_ATTACK;
+    if (smpHdr->lenAttack) {
+        v->envInc = ENV_ONE / envSamples(syn, smpHdr->lenAttack);
+    } else {
+        envNextStage(syn, v);
+    }
+}
+
+//-----------------------------------------------
+//EVENTS
+
+void synthNoteOn(wg_Synth* syn, int chan, int note, int vel) {
+    const wg_Patch* patch;
+    const wg_Split* spBase;
+    
+    chan &= 15;
+    note &= 127;
+    if (!vel) {
+        synthNoteOff(syn, chan, note);
+        return;
+    }
+    
+    //retrigger
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        
+        if (v->stage != ENV_OFF && v->chan == chan && v->note == note) startRelease(syn, v);
+    }
+    
+    if (!(patch = getPatch(syn, chan))) return;
+    spBase = bankPtr(syn,
+        (const uint8_t*)patch - syn->base + sizeof(wg_Patch) + (patch->isDrumKit ? sizeof(wg_DrumTable) : 0),
+        patch->splitNum * sizeof(wg_Split)
+    );
+    if (!spBase) return;
+    
+    //overlapping splits are layers
+    for (unsigned int j=0; j < patch->splitNum; j++) {
+        if (note >= spBase[j].rangeStart && note <= spBase[j].rangeEnd) startVoice(syn, chan, note, vel, patch, &spBase[j]);
+    }
+}
+
+void synthNoteOff(wg_Synth* syn, int chan, int note) {
+    chan &= 15;
+    note &= 127;
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        
+        if (v->stage == ENV_OFF || v->stage == ENV_RELEASE || v->chan != chan || v->note != note) continue;
+        //one-shot drums play out
+        if (chan == SYNTH_DRUMCHAN && !v->isLoop) continue;
+        if (syn->chans[chan].sustain) {
+            v->isHeld = 1;
+        } else {
+            startRelease(syn, v);
+        }
+    }
+}
+
+void synthProgram(wg_Synth* syn, int chan, int prog) {
+    syn->chans[chan & 15].prog = prog & 127;
+}
+
+void synthControl(wg_Synth* syn, int chan, int cc, int val) {
+    wg_Channel* ch = &syn->chans[chan & 15];
+    
+    chan &= 15;
+    val  &= 127;
+    switch (cc) {
+        case 7:   ch->volume     = val; break;
+        case 10:  ch->pan        = val; break;
+        case 11:  ch->expression = val; break;
+        case 64:
+            ch->sustain = val >= 64;
+            if (ch->sustain) return;
+            for (int i=0; i < SYNTH_VOICES; i++) {
+                wg_Voice* v = &syn->voices[i];
+                
+                if (v->chan == chan && v->isHeld) startRelease(syn, v);
+            }
+            return;
+        case 120: //all sound off
+            for (int i=0; i < SYNTH_VOICES; i++) {
+                if (syn->voices[i].chan == chan) syn->voices[i].stage = ENV_OFF;
+            }
+            return;
+        case 121: //reset controllers
+            ch->volume     = 100;
+            ch->expression = 127;
+            ch->pan        = 64;
+            ch->sustain    = 0;
+            ch->bend       = 0;
+            break;
+        case 123: //all notes off
+            for (int i=0; i < SYNTH_VOICES; i++) {
+                if (syn->voices[i].chan == chan) startRelease(syn, &syn->voices[i]);
+            }
+            return;
+        default:
+            return;
+    }
+    
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        
+        if (v->stage == ENV_OFF || v->chan != chan) continue;
+        updateGain(syn, v);
+        updateStep(syn, v);
+    }
+}
+
+void synthPitchBend(wg_Synth* syn, int chan, int bend) {
+    chan &= 15;
+    syn->chans[chan].bend = (bend & 16383) - 8192;
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        
+        if (v->stage != ENV_OFF && v->chan == chan) updateStep(syn, v);
+    }
+}
+
+void synthMidi(wg_Synth* syn, const uint8_t* msg) {
+    int chan = msg[0] & 15;
+    
+    switch (msg[0] & 0xF0) {
+        case 0x80: synthNoteOff(syn, chan, msg[1]); break;
+        case 0x90: synthNoteOn(syn, chan, msg[1], msg[2]); break;
+        case 0xB0: synthControl(syn, chan, msg[1], msg[2]); break;
+        case 0xC0: synthProgram(syn, chan, msg[1]); break;
+        case 0xE0: synthPitchBend(syn, chan, msg[1] | msg[2] << 7); break;
+    }
+}
+
+//-----------------------------------------------
+//RENDER
+
+//frames until envelope reaches current stage target
+static uint32_t envFramesLeft(const wg_Voice* v) {
+    int64_t dist;
+    
+    switch (v->stage) {
+        case ENV_ATTACK:  dist = ENV_ONE - v->env;       break;
+        case ENV_DECAY:   dist = v->env - v->envSustain; break;
+        case ENV_RELEASE: dist = v->env;                 break;
+        default:          return UINT32_MAX;
+    }
+    if (dist <= 0) return 0;
+    dist = (dist + llabs(v->envInc) - 1) / llabs(v->envInc);
+    return dist > UINT32_MAX ? UINT32_MAX : (uint32_t)dist;
+}
+
+//wraps position into loop, returns 0 once sample is over
+static int wrapPos(wg_Voice* v) {
+    uint32_t idx = v->pos >> 32;
+    
+    if (idx < v->len) return 1;
+    if (!v->isLoop) return 0;
+    idx = v->loopStart + (idx - v->loopStart) % (v->len - v->loopStart);
+    v->pos = (uint64_t)idx << 32 | (uint32_t)v->pos;
+    return 1;
+}
+
+//same as renderVoice() from decoded frames, guard frames past the end stand in for lastIdx
+static unsigned int renderVoicePcm(wg_Voice* v, int32_t* mix, unsigned int frames) {
+    const int16_t* pcm = v->pcm;
+    int32_t env = v->env;
+    unsigned int i;
+    
+    for (i=0; i < frames; i++) {
+        uint32_t idx;
+        int32_t frac, l, r;
+        
+        if (!wrapPos(v)) break;
+        idx  = v->pos >> 32;
+        frac = (uint32_t)v->pos >> 18;
+        
+        if (v->isStereo) {
+            int32_t l0 = pcm[idx*2],   l1 = pcm[idx*2+2];
+            int32_t r0 = pcm[idx*2+1], r1 = pcm[idx*2+3];
+            
+            l = l0 + (((l1 - l0) * frac) >> 14);
+            r = r0 + (((r1 - r0) * frac) >> 14);
+        } else {
+            int32_t s0 = pcm[idx], s1 = pcm[idx+1];
+            
+            l = r = s0 + (((s1 - s0) * frac) >> 14);
+        }
+        l = (l * (env >> 9)) >> 15;
+        r = (r * (env >> 9)) >> 15;
+        mix[i*2]   += (l * v->gainL) >> 15;
+        mix[i*2+1] += (r * v->gainR) >> 15;
+        
+        env    += v->envInc;
+        v->pos += v->step;
+    }
+    v->env = env;
+    
+    return i;
+}
+
+//other interpolations are mixer.c, envelope and gains go to it as float with a step per frame
+static unsigned int renderVoiceMix(wg_Voice* v, int32_t* mix, unsigned int frames, int interp) {
+    const float scale = 1.0f / ((float)ENV_ONE * GAIN_ONE);
+    wg_MixVoice mv;
+    unsigned int got;
+    
+    mv.pcm       = v->pcm;
+    mv.len       = v->len;
+    mv.loopStart = v->loopStart;
+    mv.isLoop    = v->isLoop;
+    mv.isStereo  = v->isStereo;
+    mv.pos       = v->pos;
+    mv.step      = v->step;
+    mv.gainL     = (float)v->env * v->gainL * scale;
+    mv.gainR     = (float)v->env * v->gainR * scale;
+    mv.incL      = (float)v->envInc * v->gainL * scale;
+    mv.incR      = (float)v->envInc * v->gainR * scale;
+    got = mixVoice(&mv, mix, frames, interp);
+    
+    v->pos  = mv.pos;
+    v->env += (int64_t)v->envInc * got;
+    return got;
+}
+
+static unsigned int renderVoice(wg_Voice* v, int32_t* mix, unsigned int frames) {
+    const uint8_t* data = v->data;
+    uint32_t lastIdx = v->isLoop ? v->loopStart : v->len - 1;
+    int32_t env = v->env;
+    unsigned int i;
+    
+    for (i=0; i < frames; i++) {
+        uint32_t idx, next;
+        int32_t frac, l, r;
+        
+        if (!wrapPos(v)) break;
+        idx  = v->pos >> 32;
+        next = idx + 1 < v->len ? idx + 1 : lastIdx;
+        frac = (uint32_t)v->pos >> 18;  //14 bits, keeps the product in int32
+        
+        if (v->isStereo) {
+            int32_t l0 = wg_pcmTable[data[idx*2]],   l1 = wg_pcmTable[data[next*2]];
+            int32_t r0 = wg_pcmTable[data[idx*2+1]], r1 = wg_pcmTable[data[next*2+1]];
+            
+            l = l0 + (((l1 - l0) * frac) >> 14);
+            r = r0 + (((r1 - r0) * frac) >> 14);
+        } else {
+            int32_t s0 = wg_pcmTable[data[idx]], s1 = wg_pcmTable[data[next]];
+            
+            l = r = s0 + (((s1 - s0) * frac) >> 14);
+        }
+        l = (l * (env >> 9)) >> 15;
+        r = (r * (env >> 9)) >> 15;
+        mix[i*2]   += (l * v->gainL) >> 15;
+        mix[i*2+1] += (r * v->gainR) >> 15;
+        
+        env    += v->envInc;
+        v->pos += v->step;
+    }
+    v->env = env;
+    
+    return i;
+}
+
+void synthRenderMix(wg_Synth* syn, int32_t* mix, unsigned int frames) {
+    for (int i=0; i < SYNTH_VOICES; i++) {
+        wg_Voice* v = &syn->voices[i];
+        unsigned int done = 0;
+        
+        //render in pieces that end where envelope changes stage
+        while (v->stage != ENV_OFF && done < frames) {
+            uint32_t left = envFramesLeft(v);
+            unsigned int num = frames - done < left ? frames - done : left;
+            unsigned int got;
+            
+            if (!v->pcm) {
+                got = renderVoice(v, mix + done*2, num);
+            } else if (syn->interp == WG_MIX_LINEAR) {
+                got = renderVoicePcm(v, mix + done*2, num);
+            } else {
+                got = renderVoiceMix(v, mix + done*2, num, syn->interp);
+            }
+            
+            done += got;
+            if (got < num) {
+                v->stage = ENV_OFF;
+            } else if (num == left) {
+                envNextStage(syn, v);
+            }
+        }
+    }
+}
+
+void synthRender(wg_Synth* syn, int16_t* out, unsigned int frames) {
+    int32_t mix[SUB_FRAMES*2];
+    
+    while (frames) {
+        unsigned int num = frames < SUB_FRAMES ? frames : SUB_FRAMES;
+        
+        memset(mix, 0, num * 2 * sizeof(int32_t));
+        synthRenderMix(syn, mix, num);
+        for (unsigned int i=0; i < num*2; i++) {
+            out[i] = mix[i] > 32767 ? 32767 : (mix[i] < -32768 ? -32768 : mix[i]);
+        }
+        out    += num*2;
+        frames -= num;
+    }
+}
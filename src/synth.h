@@ -0,0 +1,42 @@
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//sampler playing a WinGroove bank in place, straight from the 8-bit data
+//render between events for sample accurate timing
+//with a decoded PCM cache it plays that instead, output stays the same to the bit
+//unless another interpolation is asked for, mixer.c plays those
+
+#define SYNTH_VOICES   32
+#define SYNTH_CHANNELS 16
+#define SYNTH_DRUMCHAN 9
+
+typedef struct wg_Synth wg_Synth;
+struct wg_PcmCache;
+
+wg_Synth* synthCreate(void* base, size_t len, unsigned int rate);
+void synthDestroy(wg_Synth* syn);
+void synthReset(wg_Synth* syn);
+//cache of the same bank, has to stay open while synth plays, NULL goes back to 8-bit data
+void synthSetPcm(wg_Synth* syn, const struct wg_PcmCache* pcm);
+//WG_MIX_INTERP of mixer.h for voices playing from the cache, default linear is the bit exact one
+void synthSetInterp(wg_Synth* syn, int interp);
+
+void synthNoteOn(wg_Synth* syn, int chan, int note, int vel);
+void synthNoteOff(wg_Synth* syn, int chan, int note);
+void synthProgram(wg_Synth* syn, int chan, int prog);
+void synthControl(wg_Synth* syn, int chan, int cc, int val);
+//0..16383, 8192 is center
+void synthPitchBend(wg_Synth* syn, int chan, int bend);
+//raw channel message, status byte first
+void synthMidi(wg_Synth* syn, const uint8_t* msg);
+
+int synthActiveVoices(const wg_Synth* syn);
+//adds to interleaved stereo int32 buffer, no clipping
+void synthRenderMix(wg_Synth* syn, int32_t* mix, unsigned int frames);
+//interleaved stereo int16
+void synthRender(wg_Synth* syn, int16_t* out, unsigned int frames);
+
+#endif
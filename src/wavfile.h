@@ -106,6 +106,20 @@ typedef struct wav_ExtraHeader {
     uint8_t  nVibRate;
 } wav_ExtraHeader;
 
+
+// What WGKnife writes around the sample data, so each goes out in one piece
+typedef struct wav_PcmHead {
+    wav_FileHeader   file;
+    wav_FormatHeader form;
+    wav_DataHeader   data;
+} wav_PcmHead;
+
+
+typedef struct wav_SmplTail {
+    wav_SmplHeader   smpl;
+    wav_SampleLoop   loop;  // only present if smpl.dwSampleLoops
+} wav_SmplTail;
+
 #pragma pack()
 
 #endif
\ No newline at end of file
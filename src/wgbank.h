@@ -28,7 +28,7 @@
 
 #include <stdint.h>
 
-int16_t wg_pcmTable[256] = {
+static const int16_t wg_pcmTable[256] = {
          0,     16,     32,     48,     64,     80,     96,    112,
        128,    144,    160,    176,    192,    208,    224,    240,
        256,    272,    288,    304,    320,    336,    352,    368,
@@ -120,6 +120,9 @@ typedef struct {
 
 #pragma pack()
 
+//PatchMap sits right after the header and junk waves
+#define MIDIMAP_OFF (sizeof(wg_BankHeader) + 16*sizeof(wg_JunkPCM))
+
 enum WG_FLAGS {
     WG_FLG_BIT1      = 1<<0,
     WG_FLG_BIT2      = 1<<1,
@@ -0,0 +1,603 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "common.h"
+#include "wgenc.h"
+#include "hash.h"
+
+//-----------------------------------------------
+//SAMPLE ENCODE
+
+static uint8_t encTable[65536];
+static int isEncTableReady = 0;
+
+//codes sorted by value, then one sweep over all int16 picks nearest
+//ties go to lower value, every table value maps back to its own code
+void wg_encodeInit(void) {
+    uint8_t codes[256];
+    int n = 0;
+    
+    if (isEncTableReady) return;
+    for (int i=0; i < 256; i++) {
+        int j = i;
+        
+        while (j > 0 && wg_pcmTable[codes[j-1]] > wg_pcmTable[i]) {
+            codes[j] = codes[j-1];
+            j--;
+        }
+        codes[j] = i;
+    }
+    for (int v=-32768; v <= 32767; v++) {
+        while (n < 255 && abs(wg_pcmTable[codes[n+1]] - v) < abs(wg_pcmTable[codes[n]] - v)) n++;
+        encTable[(uint16_t)v] = codes[n];
+    }
+    isEncTableReady = 1;
+}
+
+void wg_encode(const int16_t* in, uint8_t* out, size_t len) {
+    if (!isEncTableReady) wg_encodeInit();
+    for (size_t i=0; i < len; i++) out[i] = encTable[(uint16_t)in[i]];
+}
+
+//-----------------------------------------------
+//READ BACK
+
+static int cmpU64(const void* a, const void* b) {
+    uint64_t uA = *(uint64_t*)a;
+    uint64_t uB = *(uint64_t*)b;
+    
+    return (uA > uB) - (uA < uB);
+}
+
+//sorts and squeezes out repeats, returns new count
+static unsigned int uniqU64(uint64_t* keys, unsigned int num) {
+    unsigned int n = 0;
+    
+    qsort(keys, num, sizeof(uint64_t), cmpU64);
+    for (unsigned int i=0; i < num; i++) {
+        if (!n || keys[n-1] != keys[i]) keys[n++] = keys[i];
+    }
+    return n;
+}
+
+static unsigned int findU64(const uint64_t* keys, unsigned int num, uint64_t key) {
+    return (const uint64_t*)bsearch(&key, keys, num, sizeof(uint64_t), cmpU64) - keys;
+}
+
+//keeps patches, headers and data in file order, so unmodified bank builds back almost the same
+int encBankFromWgbank(wg_EncBank* enc, void* base, size_t len) {
+    uint8_t* buf = base;
+    wg_PatchMap* midiMap = (wg_PatchMap*)(buf + MIDIMAP_OFF);
+    uint64_t *patchKeys = NULL, *hdrKeys = NULL, *dataKeys = NULL;
+    unsigned int numHdrs = 0;
+    
+    memset(enc, 0, sizeof(wg_EncBank));
+    if (len < MIDIMAP_OFF + 2*sizeof(wg_PatchMap)) goto BAD;
+    memcpy(&enc->header, buf, sizeof(wg_BankHeader));
+    memcpy(enc->junk, buf + sizeof(wg_BankHeader), sizeof(enc->junk));
+    
+    if (!(patchKeys = malloc(256 * sizeof(uint64_t)))) goto OOM;
+    for (unsigned int i=0; i < 256; i++) {
+        if (midiMap->t[i] > len - sizeof(wg_Patch)) goto BAD;
+        patchKeys[i] = midiMap->t[i];
+    }
+    enc->numPatches = uniqU64(patchKeys, 256);
+    if (!(enc->patches = calloc(enc->numPatches, sizeof(wg_EncPatch)))) goto OOM;
+    
+    //splits first, they tell which headers exist
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        wg_EncPatch* p = &enc->patches[i];
+        wg_Patch* patch = (wg_Patch*)(buf + patchKeys[i]);
+        size_t splitOff = patchKeys[i] + sizeof(wg_Patch) + (patch->isDrumKit ? sizeof(wg_DrumTable) : 0);
+        uint64_t* tmp;
+        
+        if (splitOff + patch->splitNum * sizeof(wg_Split) > len) goto BAD;
+        p->patch = *patch;
+        if (patch->isDrumKit) memcpy(&p->drums, patch + 1, sizeof(wg_DrumTable));
+        p->numSplits = patch->splitNum;
+        if (!p->numSplits) continue;
+        if (!(p->splits = malloc(p->numSplits * sizeof(wg_Split)))) goto OOM;
+        memcpy(p->splits, buf + splitOff, p->numSplits * sizeof(wg_Split));
+        
+        if (!(tmp = realloc(hdrKeys, (numHdrs + p->numSplits) * sizeof(uint64_t)))) goto OOM;
+        hdrKeys = tmp;
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            if (p->splits[j].smpHeadOff > len - sizeof(wg_SampleHdr)) goto BAD;
+            hdrKeys[numHdrs++] = p->splits[j].smpHeadOff;
+        }
+    }
+    for (unsigned int i=0; i < 256; i++) enc->map[i] = findU64(patchKeys, enc->numPatches, midiMap->t[i]);
+    
+    enc->numHeaders = numHdrs ? uniqU64(hdrKeys, numHdrs) : 0;
+    if (enc->numHeaders) {
+        if (!(enc->headers = calloc(enc->numHeaders, sizeof(wg_EncHeader)))) goto OOM;
+        if (!(dataKeys = malloc(enc->numHeaders * sizeof(uint64_t)))) goto OOM;
+    }
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        wg_SampleHdr* smpHdr = (wg_SampleHdr*)(buf + hdrKeys[i]);
+        
+        if (smpHdr->offEnd >= len || smpHdr->offStart > smpHdr->offEnd) goto BAD;
+        if (smpHdr->offLoop && (smpHdr->offLoop < smpHdr->offStart || smpHdr->offLoop > smpHdr->offEnd)) goto BAD;
+        enc->headers[i].hdr  = *smpHdr;
+        enc->headers[i].loop = smpHdr->offLoop ? smpHdr->offLoop - smpHdr->offStart : WG_ENC_NOLOOP;
+        dataKeys[i] = (uint64_t)smpHdr->offStart << 32 | smpHdr->offEnd;
+    }
+    
+    enc->numData = enc->numHeaders ? uniqU64(dataKeys, enc->numHeaders) : 0;
+    if (enc->numData && !(enc->data = calloc(enc->numData, sizeof(wg_EncData)))) goto OOM;
+    for (unsigned int i=0; i < enc->numData; i++) {
+        uint32_t offStart = dataKeys[i] >> 32;
+        
+        enc->data[i].raw = buf + offStart;
+        enc->data[i].len = (uint32_t)dataKeys[i] - offStart + 1;
+        //gap up to next one is carried over
+        if (i+1 < enc->numData && (dataKeys[i+1] >> 32) > (uint32_t)dataKeys[i] + 1) {
+            enc->data[i].pad = (dataKeys[i+1] >> 32) - (uint32_t)dataKeys[i] - 1;
+        }
+    }
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        wg_SampleHdr* smpHdr = &enc->headers[i].hdr;
+        
+        enc->headers[i].data = findU64(dataKeys, enc->numData, (uint64_t)smpHdr->offStart << 32 | smpHdr->offEnd);
+    }
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        wg_EncPatch* p = &enc->patches[i];
+        
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            p->splits[j].smpHeadOff = findU64(hdrKeys, enc->numHeaders, p->splits[j].smpHeadOff);
+        }
+    }
+    
+    free(patchKeys);
+    free(hdrKeys);
+    free(dataKeys);
+    return 1;
+    BAD:
+        printf("encBankFromWgbank(): Bank structures point outside of file.\n");
+        goto ERR;
+    OOM:
+        printf("encBankFromWgbank(): Out of memory!\n");
+    ERR:
+        free(patchKeys);
+        free(hdrKeys);
+        free(dataKeys);
+        encBankFree(enc);
+        return 0;
+}
+
+//-----------------------------------------------
+//TRIM
+
+int encBankKeep(wg_EncBank* enc, const uint8_t* keep) {
+    unsigned int* remap;
+    unsigned int num, dummy = enc->numPatches;
+    
+    //one dummy patch is shared by every dropped slot, like original banks do
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        if (!enc->patches[i].patch.volume) {
+            dummy = i;
+            break;
+        }
+    }
+    if (dummy == enc->numPatches) {
+        wg_EncPatch* tmp = realloc(enc->patches, (enc->numPatches+1) * sizeof(wg_EncPatch));
+        
+        if (!tmp) goto OOM;
+        enc->patches = tmp;
+        memset(&enc->patches[dummy], 0, sizeof(wg_EncPatch));
+        enc->numPatches++;
+    }
+    for (unsigned int i=0; i < 256; i++) {
+        if (!keep[i]) enc->map[i] = dummy;
+    }
+    
+    //patches, mark used ones then squeeze
+    num = enc->numPatches;
+    if (enc->numHeaders > num) num = enc->numHeaders;
+    if (enc->numData > num) num = enc->numData;
+    if (!(remap = calloc(num, sizeof(unsigned int)))) goto OOM;
+    num = enc->numPatches;
+    for (unsigned int i=0; i < 256; i++) remap[enc->map[i]] = 1;
+    enc->numPatches = 0;
+    for (unsigned int i=0; i < num; i++) {
+        if (!remap[i]) {
+            free(enc->patches[i].splits);
+            continue;
+        }
+        remap[i] = enc->numPatches;
+        enc->patches[enc->numPatches++] = enc->patches[i];
+    }
+    for (unsigned int i=0; i < 256; i++) enc->map[i] = remap[enc->map[i]];
+    
+    //headers
+    num = enc->numHeaders;
+    memset(remap, 0, num * sizeof(unsigned int));
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        for (unsigned int j=0; j < enc->patches[i].numSplits; j++) remap[enc->patches[i].splits[j].smpHeadOff] = 1;
+    }
+    enc->numHeaders = 0;
+    for (unsigned int i=0; i < num; i++) {
+        if (!remap[i]) continue;
+        remap[i] = enc->numHeaders;
+        enc->headers[enc->numHeaders++] = enc->headers[i];
+    }
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        for (unsigned int j=0; j < enc->patches[i].numSplits; j++) {
+            enc->patches[i].splits[j].smpHeadOff = remap[enc->patches[i].splits[j].smpHeadOff];
+        }
+    }
+    
+    //data
+    num = enc->numData;
+    memset(remap, 0, num * sizeof(unsigned int));
+    for (unsigned int i=0; i < enc->numHeaders; i++) remap[enc->headers[i].data] = 1;
+    enc->numData = 0;
+    for (unsigned int i=0; i < num; i++) {
+        if (!remap[i]) continue;
+        remap[i] = enc->numData;
+        enc->data[enc->numData++] = enc->data[i];
+    }
+    for (unsigned int i=0; i < enc->numHeaders; i++) enc->headers[i].data = remap[enc->headers[i].data];
+    
+    free(remap);
+    return 1;
+    OOM:
+        printf("encBankKeep(): Out of memory!\n");
+        return 0;
+}
+
+//-----------------------------------------------
+//REPACK
+
+#define UNUSED 0xFFFFFFFF
+
+typedef struct {
+    uint64_t     key;
+    unsigned int idx;
+} KeyIdx;
+
+//by key, equal keys keep index order so first one leads
+static int cmpKeyIdx(const void* a, const void* b) {
+    const KeyIdx* kA = a;
+    const KeyIdx* kB = b;
+    
+    if (kA->key != kB->key) return (kA->key > kB->key) - (kA->key < kB->key);
+    return (kA->idx > kB->idx) - (kA->idx < kB->idx);
+}
+
+//pcm data is never merged, it's only there when someone put it there on purpose
+static int isSameData(const wg_EncData* a, const wg_EncData* b) {
+    if (a->pcm || b->pcm) return a == b;
+    return a->len == b->len && !memcmp(a->raw, b->raw, a->len);
+}
+
+//offsets get filled in by encBankBuild(), they don't count
+static void normHeader(const wg_EncHeader* h, wg_SampleHdr* out) {
+    *out = h->hdr;
+    out->offStart = 0;
+    out->offLoop  = 0;
+    out->offEnd   = 0;
+}
+
+static int isSameHeader(const wg_EncHeader* a, const wg_EncHeader* b) {
+    wg_SampleHdr nA, nB;
+    
+    normHeader(a, &nA);
+    normHeader(b, &nB);
+    return a->data == b->data && a->loop == b->loop && !memcmp(&nA, &nB, sizeof(wg_SampleHdr));
+}
+
+//hash equal and contents equal points at the first one, everything else at itself
+static void findSame(KeyIdx* keys, unsigned int num, unsigned int* same, const wg_EncBank* enc, int isData) {
+    qsort(keys, num, sizeof(KeyIdx), cmpKeyIdx);
+    for (unsigned int i=0; i < num; i++) {
+        unsigned int lead = keys[i].idx, j = i;
+        
+        same[lead] = lead;
+        while (j+1 < num && keys[j+1].key == keys[i].key) {
+            unsigned int idx = keys[++j].idx;
+            
+            if (isData) {
+                same[idx] = isSameData(&enc->data[lead], &enc->data[idx]) ? lead : idx;
+            } else {
+                same[idx] = isSameHeader(&enc->headers[lead], &enc->headers[idx]) ? lead : idx;
+            }
+        }
+        i = j;
+    }
+}
+
+typedef struct {
+    uint32_t     weight;   //keys that play it, over all used patch map slots
+    uint32_t     firstUse;
+    unsigned int idx;
+} DataUse;
+
+static int cmpDataUse(const void* a, const void* b) {
+    const DataUse* uA = a;
+    const DataUse* uB = b;
+    
+    if (uA->weight != uB->weight) return uA->weight < uB->weight ? 1 : -1;
+    return (uA->firstUse > uB->firstUse) - (uA->firstUse < uB->firstUse);
+}
+
+int encBankRepack(wg_EncBank* enc) {
+    unsigned int num = enc->numPatches;
+    unsigned int *same = NULL, *remap = NULL, *hdrFirst = NULL;
+    unsigned int numHdrs = 0, numData = 0, numPatches = 0, useCount = 0;
+    KeyIdx* keys = NULL;
+    DataUse* use = NULL;
+    wg_EncPatch* patches = NULL;
+    wg_EncHeader* headers = NULL;
+    wg_EncData* data = NULL;
+    
+    if (enc->numHeaders > num) num = enc->numHeaders;
+    if (enc->numData > num) num = enc->numData;
+    if (!num) return 1;
+    if (!(same = malloc(num * sizeof(unsigned int)))) goto OOM;
+    if (!(remap = malloc(num * sizeof(unsigned int)))) goto OOM;
+    if (!(keys = malloc(num * sizeof(KeyIdx)))) goto OOM;
+    if (!(hdrFirst = malloc(num * sizeof(unsigned int)))) goto OOM;
+    if (!(use = malloc(num * sizeof(DataUse)))) goto OOM;
+    
+    //data by content, then headers pointing at merged data can turn out equal too
+    for (unsigned int i=0; i < enc->numData; i++) {
+        const wg_EncData* d = &enc->data[i];
+        
+        keys[i].key = d->pcm ? wg_hash64(d->pcm, d->len * sizeof(int16_t), 1) : wg_hash64(d->raw, d->len, 0);
+        keys[i].idx = i;
+    }
+    findSame(keys, enc->numData, same, enc, 1);
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        wg_EncHeader* h = &enc->headers[i];
+        wg_SampleHdr norm;
+        
+        h->data = same[h->data];
+        normHeader(h, &norm);
+        keys[i].key = wg_hash64(&norm, sizeof(wg_SampleHdr), (uint64_t)h->data << 32 | h->loop);
+        keys[i].idx = i;
+    }
+    findSame(keys, enc->numHeaders, same, enc, 0);
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        wg_EncPatch* p = &enc->patches[i];
+        
+        for (unsigned int j=0; j < p->numSplits; j++) p->splits[j].smpHeadOff = same[p->splits[j].smpHeadOff];
+    }
+    
+    //walk patch map like a player would, counting keys per data and noting first uses
+    for (unsigned int i=0; i < num; i++) {
+        remap[i]    = UNUSED;
+        hdrFirst[i] = UNUSED;
+        use[i].weight   = 0;
+        use[i].firstUse = UNUSED;
+        use[i].idx      = i;
+    }
+    for (unsigned int i=0; i < 256; i++) {
+        const wg_EncPatch* p = &enc->patches[enc->map[i]];
+        
+        if (remap[enc->map[i]] == UNUSED) remap[enc->map[i]] = numPatches++;
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            const wg_Split* split = &p->splits[j];
+            DataUse* u = &use[enc->headers[split->smpHeadOff].data];
+            
+            if (hdrFirst[split->smpHeadOff] == UNUSED) hdrFirst[split->smpHeadOff] = useCount;
+            if (u->firstUse == UNUSED) u->firstUse = useCount;
+            useCount++;
+            //dummies don't play
+            if (p->patch.volume && split->rangeEnd >= split->rangeStart) u->weight += split->rangeEnd - split->rangeStart + 1;
+        }
+    }
+    
+    //patches in patch map order
+    if (!(patches = malloc(numPatches * sizeof(wg_EncPatch)))) goto OOM;
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        if (remap[i] == UNUSED) {
+            free(enc->patches[i].splits);
+            continue;
+        }
+        patches[remap[i]] = enc->patches[i];
+    }
+    for (unsigned int i=0; i < 256; i++) enc->map[i] = remap[enc->map[i]];
+    free(enc->patches);
+    enc->patches    = patches;
+    enc->numPatches = numPatches;
+    
+    //headers in order of first use, unused ones go
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        keys[i].key = hdrFirst[i];
+        keys[i].idx = i;
+    }
+    qsort(keys, enc->numHeaders, sizeof(KeyIdx), cmpKeyIdx);
+    while (numHdrs < enc->numHeaders && keys[numHdrs].key != UNUSED) numHdrs++;
+    if (numHdrs && !(headers = malloc(numHdrs * sizeof(wg_EncHeader)))) goto OOM;
+    for (unsigned int i=0; i < numHdrs; i++) {
+        headers[i] = enc->headers[keys[i].idx];
+        remap[keys[i].idx] = i;
+    }
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        wg_EncPatch* p = &enc->patches[i];
+        
+        for (unsigned int j=0; j < p->numSplits; j++) p->splits[j].smpHeadOff = remap[p->splits[j].smpHeadOff];
+    }
+    free(enc->headers);
+    enc->headers    = headers;
+    enc->numHeaders = numHdrs;
+    
+    //data, most played first, gaps between them go
+    qsort(use, enc->numData, sizeof(DataUse), cmpDataUse);
+    while (numData < enc->numData && use[numData].firstUse != UNUSED) numData++;
+    if (numData && !(data = malloc(numData * sizeof(wg_EncData)))) goto OOM;
+    for (unsigned int i=0; i < numData; i++) {
+        data[i] = enc->data[use[i].idx];
+        data[i].pad = 0;
+        remap[use[i].idx] = i;
+    }
+    for (unsigned int i=0; i < enc->numHeaders; i++) enc->headers[i].data = remap[enc->headers[i].data];
+    free(enc->data);
+    enc->data    = data;
+    enc->numData = numData;
+    
+    enc->isLocalHdrs = 1;
+    free(same);
+    free(remap);
+    free(keys);
+    free(hdrFirst);
+    free(use);
+    return 1;
+    OOM:
+        printf("encBankRepack(): Out of memory!\n");
+        free(same);
+        free(remap);
+        free(keys);
+        free(hdrFirst);
+        free(use);
+        return 0;
+}
+
+//-----------------------------------------------
+//BUILD
+
+uint8_t* encBankBuild(const wg_EncBank* enc, size_t* outLen) {
+    uint32_t *patchOffs = NULL, *hdrOffs = NULL, *dataOffs = NULL;
+    size_t off = MIDIMAP_OFF + 2*sizeof(wg_PatchMap);
+    wg_PatchMap* midiMap;
+    wg_BankHeader* head;
+    uint8_t* out = NULL;
+    
+    if (!enc->numPatches) goto BAD;
+    for (unsigned int i=0; i < 256; i++) {
+        if (enc->map[i] >= enc->numPatches) goto BAD;
+    }
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        const wg_EncHeader* h = &enc->headers[i];
+        
+        if (h->data >= enc->numData) goto BAD;
+        if (h->loop != WG_ENC_NOLOOP && h->loop >= enc->data[h->data].len) goto BAD;
+    }
+    
+    if (!(patchOffs = malloc(enc->numPatches * sizeof(uint32_t)))) goto OOM;
+    if (!(hdrOffs = calloc(enc->numHeaders ? enc->numHeaders : 1, sizeof(uint32_t)))) goto OOM;
+    if (!(dataOffs = malloc((enc->numData ? enc->numData : 1) * sizeof(uint32_t)))) goto OOM;
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        const wg_EncPatch* p = &enc->patches[i];
+        
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            if (p->splits[j].smpHeadOff >= enc->numHeaders) goto BAD;
+        }
+        patchOffs[i] = off;
+        off += sizeof(wg_Patch) + (p->patch.isDrumKit ? sizeof(wg_DrumTable) : 0) + p->numSplits * sizeof(wg_Split);
+        if (!enc->isLocalHdrs) continue;
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            uint32_t* hdrOff = &hdrOffs[p->splits[j].smpHeadOff];
+            
+            if (*hdrOff) continue;
+            *hdrOff = off;
+            off += sizeof(wg_SampleHdr);
+        }
+    }
+    //the rest in one block, that's all of them unless isLocalHdrs
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        if (hdrOffs[i]) continue;
+        hdrOffs[i] = off;
+        off += sizeof(wg_SampleHdr);
+    }
+    //two zero uint32 end the headers
+    off += 8;
+    for (unsigned int i=0; i < enc->numData; i++) {
+        if (!enc->data[i].len || (!enc->data[i].pcm && !enc->data[i].raw)) goto BAD;
+        dataOffs[i] = off;
+        off += enc->data[i].len + enc->data[i].pad;
+        if (off > UINT32_MAX) goto BAD;
+    }
+    
+    if (!(out = calloc(1, off))) goto OOM;
+    head = (wg_BankHeader*)out;
+    *head = enc->header;
+    memcpy(head->magic, "WgTPDHdr", 8);
+    //only 24 bits, bigger synthetic banks wrap but checkWgbankHeader() still takes them
+    head->fileSizeAndFlag = (enc->header.fileSizeAndFlag & 0xFF000000) | (off & 0x00FFFFFF);
+    memcpy(out + sizeof(wg_BankHeader), enc->junk, sizeof(enc->junk));
+    
+    //filler after the map holds first patch offset in WINGROOV.TPD
+    midiMap = (wg_PatchMap*)(out + MIDIMAP_OFF);
+    for (unsigned int i=0; i < 256; i++) {
+        midiMap[0].t[i] = patchOffs[enc->map[i]];
+        midiMap[1].t[i] = patchOffs[0];
+    }
+    
+    for (unsigned int i=0; i < enc->numPatches; i++) {
+        const wg_EncPatch* p = &enc->patches[i];
+        uint8_t* dst = out + patchOffs[i];
+        
+        memcpy(dst, &p->patch, sizeof(wg_Patch));
+        ((wg_Patch*)dst)->splitNum = p->numSplits;
+        dst += sizeof(wg_Patch);
+        if (p->patch.isDrumKit) {
+            memcpy(dst, &p->drums, sizeof(wg_DrumTable));
+            dst += sizeof(wg_DrumTable);
+        }
+        for (unsigned int j=0; j < p->numSplits; j++) {
+            wg_Split* split = (wg_Split*)dst + j;
+            
+            *split = p->splits[j];
+            split->smpHeadOff = hdrOffs[p->splits[j].smpHeadOff];
+        }
+    }
+    
+    for (unsigned int i=0; i < enc->numHeaders; i++) {
+        const wg_EncHeader* h = &enc->headers[i];
+        wg_SampleHdr* smpHdr = (wg_SampleHdr*)(out + hdrOffs[i]);
+        
+        *smpHdr = h->hdr;
+        smpHdr->offStart = dataOffs[h->data];
+        smpHdr->offEnd   = dataOffs[h->data] + enc->data[h->data].len - 1;
+        smpHdr->offLoop  = h->loop == WG_ENC_NOLOOP ? 0 : dataOffs[h->data] + h->loop;
+    }
+    
+    for (unsigned int i=0; i < enc->numData; i++) {
+        const wg_EncData* d = &enc->data[i];
+        
+        if (d->pcm) {
+            wg_encode(d->pcm, out + dataOffs[i], d->len);
+        } else {
+            memcpy(out + dataOffs[i], d->raw, d->len + d->pad);
+        }
+    }
+    
+    free(patchOffs);
+    free(hdrOffs);
+    free(dataOffs);
+    *outLen = off;
+    return out;
+    BAD:
+        printf("encBankBuild(): Bank is inconsistent.\n");
+        goto ERR;
+    OOM:
+        printf("encBankBuild(): Out of memory!\n");
+    ERR:
+        free(patchOffs);
+        free(hdrOffs);
+        free(dataOffs);
+        return NULL;
+}
+
+int encBankWrite(const wg_EncBank* enc, char* fileName) {
+    size_t len;
+    uint8_t* buf = encBankBuild(enc, &len);
+    int res;
+    
+    if (!buf) return 0;
+    res = writefile(fileName, buf, len);
+    free(buf);
+    return res;
+}
+
+void encBankFree(wg_EncBank* enc) {
+    for (unsigned int i=0; i < enc->numPatches; i++) free(enc->patches[i].splits);
+    free(enc->patches);
+    free(enc->headers);
+    free(enc->data);
+    memset(enc, 0, sizeof(wg_EncBank));
+}
@@ -0,0 +1,67 @@
+#ifndef WGENC_H
+#define WGENC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "wgbank.h"
+
+//TPD writer
+//bank is described with indices instead of offsets, encBankBuild() lays it out
+//like WinGroove does: patches, sample headers, 8 zero bytes, sample data
+//or with isLocalHdrs: each patch followed by its headers, 8 zero bytes, sample data
+
+#define WG_ENC_NOLOOP 0xFFFFFFFF
+
+typedef struct {
+    wg_Patch     patch;     //splitNum comes from numSplits, volume 0 is a dummy
+    wg_DrumTable drums;     //written only for drumkits
+    wg_Split*    splits;    //smpHeadOff is index into headers
+    unsigned int numSplits;
+} wg_EncPatch;
+
+typedef struct {
+    wg_SampleHdr hdr;       //offsets get filled in
+    unsigned int data;      //index into data
+    uint32_t     loop;      //loop start from beginning of data, in bytes
+} wg_EncHeader;
+
+//len counts bytes as stored, both channels of stereo included
+//offEnd points at the last one, readers leave that one out
+typedef struct {
+    const int16_t* pcm;     //encoded on write
+    const uint8_t* raw;     //already encoded, copied as is when pcm is NULL
+    uint32_t       len;
+    uint32_t       pad;     //unused bytes after data, taken from raw too, zero after pcm
+} wg_EncData;
+
+typedef struct {
+    wg_BankHeader header;   //size gets filled in, flag byte is kept
+    wg_JunkPCM    junk[16];
+    unsigned int  map[256]; //index into patches
+    wg_EncPatch*  patches;
+    unsigned int  numPatches;
+    wg_EncHeader* headers;
+    unsigned int  numHeaders;
+    wg_EncData*   data;
+    unsigned int  numData;
+    int           isLocalHdrs; //headers go right after first patch using them, not all in one block
+} wg_EncBank;
+
+//nearest 8-bit code for every int16, table is built on first use
+void wg_encodeInit(void);
+void wg_encode(const int16_t* in, uint8_t* out, size_t len);
+
+//raw data points into base, keep it around
+int encBankFromWgbank(wg_EncBank* enc, void* base, size_t len);
+//drops patches not in keep, they become dummies, unused samples go too
+int encBankKeep(wg_EncBank* enc, const uint8_t* keep);
+//same sample data and headers that end up the same are stored once, gaps between data go
+//data is ordered by how many keys of used patches play it, then by first use
+//headers move next to their patches, so a note touches the pages of its split and little else
+int encBankRepack(wg_EncBank* enc);
+uint8_t* encBankBuild(const wg_EncBank* enc, size_t* outLen);
+int encBankWrite(const wg_EncBank* enc, char* fileName);
+void encBankFree(wg_EncBank* enc);
+
+#endif
@@ -1,433 +1,187 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
-#include <stdarg.h>
 #include <string.h>
-#include <assert.h>
-#include <math.h>
 
 #include "common.h"
-#include "wgbank.h"
-#include "wavfile.h"
-#include "names.h"
+#include "pool.h"
+#include "knife.h"
+#include "bank.h"
 
-#define MIDIMAP_OFF sizeof(wg_BankHeader) + 16*sizeof(wg_JunkPCM)
-#define CENTP "%.2f"
-#define MAXPATH 260
-#define PATNAMES b00A5_patNames
-#define SMPNAMES b00A5_smpNames
-
-#define TABWIDTH 4
-void t_fprintf(int nTabs, FILE* out, const char* format, ...) {
-    va_list args;
-    
-    fprintf(out, "%*.s", TABWIDTH*nTabs, "");
-    va_start(args, format);
-    vfprintf(out, format, args);
-    va_end(args);
-}
-
-int checkWgbankHeader(void* base, size_t len) {
-    wg_BankHeader* head;
-    
-    head = base;
-    if (!strcmp(head->magic, "WgTPDHdr")) return 0;
-    if ((head->fileSizeAndFlag & 0x00FFFFFF) > len) return 0;
-    
-    return 1;
-}
+//-----------------------------------------------
+//ARGS
 
-void getSampleName(char* outName, wg_SampleHdr* smpHdr, SampleIdent* identTab) {
-    for (int i=0; identTab[i].offStart !=0 && identTab[i].offEnd; i++) {
-        if ((identTab[i].offStart == smpHdr->offStart) && (identTab[i].offEnd == smpHdr->offEnd)) {
-            sprintf(outName, "%s", identTab[i].name);
-            return;
+int runQuery(char* query, char* arg, void* base, size_t len, size_t fileLen) {
+    char* end;
+    unsigned long val = strtoul(arg, &end, 0);
+    
+    if (end == arg) goto BAD;
+    if (!strcmp(query, "patch")) {
+        //BANK:PROG like -d prints them, bank is 0 or 128 for drums
+        if (*end == ':') {
+            char* prog = end+1;
+            unsigned long num = strtoul(prog, &end, 0);
+            
+            if (end == prog || (val != 0 && val != 128) || num > 127) goto BAD;
+            val += num;
         }
+        if (*end || val > 255) goto BAD;
+        return queryPatch(stdout, base, len, fileLen, val);
+    } else if (!strcmp(query, "sample-at")) {
+        if (*end) goto BAD;
+        return querySampleAt(stdout, base, len, fileLen, val);
     }
     
-    sprintf(outName, "%010u-%010u-%08X-%08X", smpHdr->offStart, smpHdr->offEnd, smpHdr->offStart, smpHdr->offEnd);
+    printf("Unknown query.\n");
+    return 0;
+    BAD:
+        printf("Bad query argument.\n");
+        return 0;
 }
 
-#define SAMPLE_RATE     (22050)
-#define BITS_PER_SAMPLE (16)
-int writeWav(wg_SampleHdr* smpHdr, void* base, char* dest, int isTuned) {
-    wav_FileHeader wFileHdr;
-    wav_FormatHeader wFormHdr;
-    wav_DataHeader wDataHdr;
-    wav_SmplHeader wSmpHdr;
-    wav_SampleLoop wSmpLoop;
-    FILE* fout = 0;
-    int16_t* outBuf = 0;
-    uint8_t* inBuf;
-    
-    int numLoops     = smpHdr->offLoop?1:0;
-    int numChannels  = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
-    size_t smpSize   = numChannels * BITS_PER_SAMPLE/8;
-    size_t smpLen    = (smpHdr->offEnd - smpHdr->offStart) / numChannels;
-    size_t outBufLen = smpLen * smpSize;
-    
-    if (!(outBuf = malloc(outBufLen))) goto ERR;
-    if (!(fout = fopen(dest, "wb"))) goto ERR;
-    inBuf = (uint8_t*)((char*)base + smpHdr->offStart);
+//comma separated patch numbers and ranges
+int parsePatchList(char* list, uint8_t* keep) {
+    char* p = list;
     
-    for (unsigned int i=0; i < smpLen * numChannels; i++) {
-        outBuf[i] = wg_pcmTable[inBuf[i]];
-    }
-    
-    wFileHdr.id_RIFF    = IFFID_RIFF;
-    wFileHdr.filesize   = 4 + sizeof(wav_FormatHeader) + sizeof(wav_DataHeader);
-    wFileHdr.filesize  += sizeof(wav_SmplHeader)+ numLoops*sizeof(wav_SampleLoop) + outBufLen;
-    wFileHdr.id_WAVE    = IFFID_WAVE;
-    
-    wFormHdr.id_fmt         = IFFID_fmt;
-    wFormHdr.hdrlen         = 16;
-    wFormHdr.format         = 1;
-    wFormHdr.channels       = numChannels;
-    wFormHdr.freqHz         = SAMPLE_RATE;
-    wFormHdr.bytessec       = SAMPLE_RATE * smpSize;
-    wFormHdr.samplesize     = smpSize;
-    wFormHdr.bitspersample  = BITS_PER_SAMPLE;
-    
-    wDataHdr.id_data = IFFID_data;
-    wDataHdr.length  = outBufLen;
-    
-    uint32_t absTune = 49*0x100 - smpHdr->tuning;
-    
-    wSmpHdr.smpl_id         = IFFID_smpl;
-    wSmpHdr.smpl_len        = sizeof(wav_SmplHeader) + sizeof(wav_SampleLoop) - 4;
-    wSmpHdr.dwManufacturer  = 0;
-    wSmpHdr.dwProduct       = 0;
-    wSmpHdr.dwSamplePeriod  = 1000000000 / SAMPLE_RATE;
-    //not quite correct
-    wSmpHdr.dwBaseNote      = !isTuned ? 60 :  (absTune) >> 8;
-    //positive only pitch correction
-    wSmpHdr.dwPitchFraction = !isTuned ?  0 :  (~absTune) << 24;
-    wSmpHdr.dwSMPTEFormat   = 0;
-    wSmpHdr.dwSMPTEOffset   = 0;
-    wSmpHdr.dwSampleLoops   = numLoops; // number of Loop structs
-    wSmpHdr.cbSamplerData   = 0;
-    
-    if (wSmpHdr.dwPitchFraction && smpHdr->tuning < 0) wSmpHdr.dwBaseNote--;
-    
-    if (numLoops) {
-        wSmpLoop.dwIdentifier   = 0x00000000;
-        wSmpLoop.dwLoopType     = 0;
-        wSmpLoop.dwLoopStart    = (smpHdr->offLoop - smpHdr->offStart) / numChannels;
-        wSmpLoop.dwLoopEnd      = (smpHdr->offEnd  - smpHdr->offStart) / numChannels;
-        wSmpLoop.dwFraction     = 0;
-        wSmpLoop.dwPlayCount    = 0;
+    while (*p) {
+        char* end;
+        long lo, hi;
+        
+        lo = hi = strtol(p, &end, 10);
+        if (end == p) goto BAD;
+        p = end;
+        if (*p == '-') {
+            p++;
+            hi = strtol(p, &end, 10);
+            if (end == p) goto BAD;
+            p = end;
+        }
+        if (lo < 0 || hi > 255 || lo > hi) goto BAD;
+        for (long i=lo; i <= hi; i++) keep[i] = 1;
+        if (*p == ',') p++;
+        else if (*p) goto BAD;
     }
     
-    fwrite(&wFileHdr, sizeof(wav_FileHeader), 1, fout);
-    fwrite(&wFormHdr, sizeof(wav_FormatHeader), 1, fout);
-    fwrite(&wDataHdr, sizeof(wav_DataHeader), 1, fout);
-    fwrite(outBuf, smpSize, smpLen, fout);
-    fwrite(&wSmpHdr,  sizeof(wav_SmplHeader), 1, fout);
-    fwrite(&wSmpLoop, sizeof(wav_SampleLoop), numLoops, fout);
-    
-    free(outBuf);
-    fclose(fout);
     return 1;
-    ERR:
-        if (outBuf) free(outBuf);
-        if (fout) fclose(fout);
+    BAD:
+        printf("Bad patch list.\n");
         return 0;
 }
 
 //-----------------------------------------------
-//DESCRIBE
+//BATCH
 
-void describeUnkBytes(int nTabs, FILE* out, void* base, void* p, size_t len) {
-    unsigned int off = p - base;
-    
-    for (unsigned int i=0; i<len; i++) {
-        uint8_t u8 = ((uint8_t*)p)[i]; 
-        
-        t_fprintf(nTabs, out, "???? %02Xh, U8 %3u, I8 %4d ", u8, u8, (int8_t)u8);
-        if (!((off+i)&1) && len-i >= 2) {
-            uint16_t u16 = *(uint16_t*)((char*)p+i);
-            
-            fprintf(out, "-┬-> ");
-            fprintf(out, "%04Xh, U16 %5u, I16 %6d", u16, u16, (int16_t)u16);
-        } else {
-            if (i != 0) fprintf(out, "-┘");
-        }
-        fprintf(out, "\n");
-    }
-}
+typedef struct {
+    char*    fileName;
+    char*    mode;
+    wg_Pool* pool;
+    const wg_ExportOpts* opts;
+    int      isCache;
+    size_t   len;
+    unsigned int numWritten;
+    double   tStart, tLoaded, tDone;
+    int      err;
+} BatchJob;
 
-void describeSampleHdr(int nTabs, FILE* out, void* base, wg_SampleHdr* p) {
-    char sampleName[32];
-    char* flagNameTable[8] = {
-        "WG_FLG_BIT1", "WG_FLG_BIT2",    "WG_FLG_FIXEDNOTE", "WG_FLG_BIT4",
-        "WG_FLG_BIT5", "WG_FLG_STEREO",  "WG_FLG_ATONAL",    "WG_FLG_BIT8"
-    };
-    uint32_t lenLoop = (p->offEnd - p->offLoop)  / (p->flags & WG_FLG_STEREO ? 2 : 1);
-    uint32_t lenSamp = (p->offEnd - p->offStart) / (p->flags & WG_FLG_STEREO ? 2 : 1);
-    
-    getSampleName(sampleName, p, SMPNAMES);
-    t_fprintf(nTabs, out, "Sample known as \"%s.wav\"\n", sampleName);
-    
-    t_fprintf(nTabs, out, "* U32 Sample start: %08Xh\n", p->offStart);
-    if (!p->offLoop) {
-        t_fprintf(nTabs, out, "* U32 Sample loop:  DISABLED\n");
-    } else {
-        t_fprintf(nTabs, out, "* U32 Sample loop:  %08Xh (loop len %u samples)\n", p->offLoop, lenLoop);
+//whole bank as one task, its samples go to the same pool and get stolen by idle workers
+void batchTask(void* arg) {
+    BatchJob* job = arg;
+    MappedFile bank = {0};
+    wg_PcmCache cache = {0};
+    wg_ExportOpts opts = *job->opts;
+    char cacheName[MAXPATH];
+    
+    job->tStart = getTime();
+    if (!mapfile(job->fileName, &bank)) {
+        job->err = 2;
+        goto END;
     }
-    t_fprintf(nTabs, out, "* U32 Sample end:   %08Xh (samp len %u samples)\n", p->offEnd, lenSamp);
-    t_fprintf(nTabs, out, "* U16 Volume: %u\n", p->volume);
-    t_fprintf(nTabs, out, "* I16 Relative tuning: "CENTP" semitones\n", (float)p->tuning / 0x100);
-    t_fprintf(nTabs, out, "* U16 Envelope attack  len:    %u\n", p->lenAttack);
-    t_fprintf(nTabs, out, "* U16 Envelope decay   len:    %u\n", p->lenDecay);
-    t_fprintf(nTabs, out, "* U16 Envelope sustain volume: %u\n", p->volSustain);
-    t_fprintf(nTabs, out, "* U16 Envelope release len:    %u\n", p->lenRelease);
-    t_fprintf(nTabs, out, "* U8  Flags:\n");
-    for (unsigned int i=0; i<8; i++) {
-        if (p->flags & (1<<i)) t_fprintf(nTabs+1, out, "%s\n", flagNameTable[i]);
+    job->len = bank.len;
+    if (!checkWgbankHeader(bank.base, bank.len)) {
+        job->err = 3;
+        goto END;
     }
-    describeUnkBytes(nTabs, out, base, &p->unk01, 3);
-}
-
-void describeSplit(int nTabs, FILE* out, void* base, wg_Split* p) {
-    t_fprintf(nTabs, out, "* 2xU8 Note range: %u-%u\n", p->rangeStart, p->rangeEnd);
-    t_fprintf(nTabs, out, "* U8   Drum map index: %u\n", p->mapIndex);
-    t_fprintf(nTabs, out, "* I8   Panning: %i\n", p->pan);
-    describeUnkBytes(nTabs, out, base, &p->unk01, 2);            
-    t_fprintf(nTabs, out, "* I16  Relative tuning: "CENTP" semitones\n", (float)p->tuning / 0x100);
-    t_fprintf(nTabs, out, "* U32  Sample header offset: %08Xh\n", p->smpHeadOff);
-    fprintf(out, "\n");
-}
-
-void describePatch(int nTabs, FILE* out, void* base, wg_Patch* p) {
-    wg_DrumTable* dmap   = (wg_DrumTable*)((char*)p + sizeof(wg_Patch));
-    
-    if (!p->volume) {
-        t_fprintf(nTabs, out, "DUMMY PATCH\n");
-        return;
+    //exports read all of it
+    adviseMapping(&bank, 0, bank.len, MAP_ADV_WILLNEED);
+    if (job->isCache) {
+        sprintf(cacheName, "%.*s"PCM_CACHE_EXT, MAXPATH - 8, job->fileName);
+        if (pcmCacheLoad(&cache, cacheName, bank.base, bank.len)) opts.pcm = &cache;
     }
-    
-    t_fprintf(nTabs, out, "* U16 Volume: %u\n", p->volume);
-    t_fprintf(nTabs, out, "* I16 Relative tuning: "CENTP" semitones\n", (float)p->tuning / 0x100);
-    t_fprintf(nTabs, out, "* I16 Pitch randomization: "CENTP" semitones\n", (float)p->randPitch / 0x100);
-    t_fprintf(nTabs, out, "* U8  Is drumkit: %u\n", p->isDrumKit);
-    describeUnkBytes(nTabs, out, base, &p->unk01, 7);
-    t_fprintf(nTabs, out, "* U16 Split number: %u\n", p->splitNum);
-    
-    if (p->isDrumKit) {
-        t_fprintf(nTabs, out, "Drum map:");
-        for (unsigned int i=0; i<128; i++) {
-            if (i%8 == 0) {
-                fprintf(out, "\n");
-                t_fprintf(nTabs+1, out, "");
-            }
-            fprintf(out, "%3u ", dmap->tab[i]);
-        }
-        fprintf(out, "\n");
+    job->tLoaded = getTime();
+    
+    if (!strcmp(job->mode, "-sfz")) {
+        job->numWritten = dumpSfz(job->fileName, bank.base, bank.len, job->pool, &opts);
+    } else if (!strcmp(job->mode, "-sd")) {
+        job->numWritten = dumpSamples(job->fileName, bank.base, bank.len, job->pool, &opts);
+    } else if (!strcmp(job->mode, "-audition")) {
+        job->numWritten = dumpAudition(job->fileName, bank.base, bank.len, job->pool, &opts);
+    } else if (!dumpSf2(job->fileName, bank.base, bank.len, &opts)) {
+        job->err = 6;
     }
-}
-
-void describeHeader(int nTabs, FILE* out, void* base, wg_BankHeader* p) {
-    t_fprintf(nTabs, out, "Wingroove bank\n");
-    t_fprintf(nTabs, out, "* U24 File size: %06Xh\n", p->fileSizeAndFlag & 0x00FFFFFF);
-    describeUnkBytes(nTabs, out, base, (char*)&p->fileSizeAndFlag + 3, 1);
-    t_fprintf(nTabs, out, "* U16 Bank version %04Xh\n", p->bankVersion);
-    describeUnkBytes(nTabs, out, base, &p->unk01, 2);
     
-    fprintf(out, "\n");
+    END:
+        if (!job->tLoaded) job->tLoaded = getTime();
+        job->tDone = getTime();
+        pcmCacheClose(&cache);
+        unmapfile(&bank);
 }
 
-int describeWgbank(FILE* out, void* base, size_t len) {
-    wg_PatchMap* midiMap = (wg_PatchMap*)((char*)base + MIDIMAP_OFF);
-    
-    describeHeader(0, out, base, base);
-    
-    for (unsigned int i=0; i < 256; i++) {
-        wg_Patch* patch  = (wg_Patch*)((char*)base + midiMap->t[i]);
-        uint32_t splitOff = midiMap->t[i] + sizeof(wg_Patch) + (patch->isDrumKit ? 128 : 0);
-        wg_Split* spBase = (wg_Split*)((char*)base + splitOff);
-        
-        t_fprintf(0, out,  "Patch: %03u:%03u %s\n", i<128?0:128, i&127, PATNAMES[i]);
-        t_fprintf(0, out,  "structure offset: %08Xh\n", midiMap->t[i]);
-        describePatch(1, out, base, patch);
-        t_fprintf(1, out, "Splits:\n\n");
-        
-        for (unsigned int j=0; j < patch->splitNum; j++) {
-            wg_Split*     split  = &spBase[j];
-            wg_SampleHdr* smpHdr = (wg_SampleHdr*)((char*)base + split->smpHeadOff);
-            
-            t_fprintf(2, out, "Split nr: %u\n", j);
-            t_fprintf(2, out,  "structure offset: %08Xh\n", splitOff + j*sizeof(wg_Split));
-            describeSplit(3, out, base, split);
-            t_fprintf(3, out, "Sample header:\n");
-            t_fprintf(3, out,  "structure offset: %08Xh\n", split->smpHeadOff);
-            describeSampleHdr(4, out, base, smpHdr);
-            
-            fprintf(out, "\n");
-        }
-        
-        fprintf(out, "\n\n\n\n");
+//isCache gives every bank its decoded sample cache
+int runBatch(char* mode, char** files, int num, int nThreads, const wg_ExportOpts* opts, int isCache) {
+    BatchJob* jobs;
+    wg_Pool* pool;
+    double t0, tEnd, totalMB = 0;
+    unsigned int totalWritten = 0;
+    int numFailed = 0;
+    
+    if (strcmp(mode, "-sfz") && strcmp(mode, "-sd") && strcmp(mode, "-sf2") && strcmp(mode, "-audition")) {
+        printf("Batch mode does -sfz, -sd, -sf2 and -audition only.\n");
+        return 1;
     }
-    
-    
-    return 1;
-}
-//-----------------------------------------------
-//SAMPDUMP
-
-#define SMP_SUF "_dmp"
-void dumpSamples(char* name, void* base, size_t len) {
-    wg_PatchMap* midiMap = (wg_PatchMap*)((char*)base + MIDIMAP_OFF);
-    char outName[MAXPATH];
-    int doWrite = 0;
-    
-    //!sloppy
-    sprintf(outName, "%s"SMP_SUF, name);
-    makeDir(outName);
-    
-    //we want to delete files first, then write new ones
-    while (doWrite < 2) {
-        for (unsigned int i=0; i < 256; i++) {
-            wg_Patch* patch  = (wg_Patch*)((char*)base + midiMap->t[i]);
-            wg_Split* spBase = (wg_Split*)((char*)patch + sizeof(wg_Patch) + (patch->isDrumKit ? 128 : 0));
-            
-            if (!patch->volume) continue;
-            
-            for (unsigned int j=0; j < patch->splitNum; j++) {
-                char sampleName[64];
-                wg_Split*     split  = &spBase[j];
-                wg_SampleHdr* smpHdr = (wg_SampleHdr*)((char*)base + split->smpHeadOff);
-                
-                getSampleName(sampleName, smpHdr, SMPNAMES);
-                sprintf(outName, "%s"SMP_SUF"/%s.wav", name, sampleName);
-                
-                if (doWrite) {
-                    if(!isFileExist(outName)) writeWav(smpHdr, base, outName, 1);
-                } else {
-                    //good enough
-                    remove(outName);
-                }
-                
-            }
-        }
-        doWrite++;
+    if (!(jobs = calloc(num, sizeof(BatchJob)))) {
+        printf("runBatch(): Out of memory!\n");
+        return 2;
+    }
+    if (!(pool = poolCreate(nThreads))) {
+        free(jobs);
+        return 5;
     }
-}
-
-//-----------------------------------------------
-//SFZDUMP
-
-int toSfzKeytrack(uint8_t flags) {
-    return (flags & WG_FLG_FIXEDNOTE ? 0 : (flags & WG_FLG_ATONAL ? 50 : 100));
-}
-float toSfzPan(int8_t pan) {
-    return ((float)pan * 100) / (pan>=0 ? 127 : 128);
-}
-int toSfzTuneKey(int16_t tune) {
-    return 12 + (int)(tune-1)/256;
-}
-int toSfzTuneCent(int16_t tune) {
-    return (((int)tune&0xFF) * (tune>=0?1:-1)) * 100 / 256;
-}
-float toSfzEnvelope(uint16_t env) {
-    //bad
-    return (float)env/64;
-}
-float toSfzAmpEGVolume(uint16_t vol) {
-    return (float)vol * 100 / 256;
-}
-
-#define SFZ_SUF "_sfz"
-void dumpSfz(char* name, void* base, size_t len) {
-    wg_PatchMap* midiMap = (wg_PatchMap*)((char*)base + MIDIMAP_OFF);
-    char outName[MAXPATH];
-    int doWrite = 0;
     
-    //!sloppy
-    sprintf(outName, "%s"SFZ_SUF, name);
-    makeDir(outName);
-    sprintf(outName, "%s"SFZ_SUF"/samples", name);
-    makeDir(outName);
-    sprintf(outName, "%s"SFZ_SUF"/mel", name);
-    makeDir(outName);
-    sprintf(outName, "%s"SFZ_SUF"/drm", name);
-    makeDir(outName);
+    t0 = getTime();
+    for (int i=0; i < num; i++) {
+        jobs[i].fileName = files[i];
+        jobs[i].mode     = mode;
+        jobs[i].pool     = pool;
+        jobs[i].opts     = opts;
+        jobs[i].isCache  = isCache;
+        poolSubmit(pool, batchTask, &jobs[i]);
+    }
+    poolWait(pool);
+    tEnd = getTime();
     
-    while (doWrite < 2) {
-        for (unsigned int i=0; i < 256; i++) {
-            wg_Patch* patch  = (wg_Patch*)((char*)base + midiMap->t[i]);
-            wg_Split* spBase = (wg_Split*)((char*)patch + sizeof(wg_Patch) + (patch->isDrumKit ? 128 : 0));
-            FILE* sfzout = NULL;
-            
-            if (!patch->volume) continue;
-            sprintf(outName, "%s"SFZ_SUF"/%s/%03u %03u %s.sfz", name, i>>7?"drm":"mel", i&127, i&127, PATNAMES[i]);
-            if (doWrite) {
-                sfzout = fopen(outName, "w");
-                if (!sfzout) continue;
-                //printf("Patch: %03u:%03u %s\n", 128*(i>>7), i&127, PATNAMES[i]);
-                
-                fprintf(sfzout,
-                    "//SFZ exported by WG-Knife, version 0.00000000000001\n"
-                    "\n"
-                    "<group>\n"
-                    "//-----\n"
-                    "\n"
-                    "\n"
-                );
-                
-            } else {
-                remove(outName);
-            }
-            
-            for (unsigned int j=0; j < patch->splitNum; j++) {
-                char sampleName[64];
-                wg_Split*     split  = &spBase[j];
-                wg_SampleHdr* smpHdr = (wg_SampleHdr*)((char*)base + split->smpHeadOff);
-                
-                getSampleName(sampleName, smpHdr, SMPNAMES);
-                sprintf(outName, "%s"SFZ_SUF"/samples/%s.wav", name, sampleName);
-                
-                if (doWrite) {
-                    int numChans = smpHdr->flags & WG_FLG_STEREO ? 2 : 1;
-                    uint32_t loopStart = (smpHdr->offLoop - smpHdr->offStart) / numChans;
-                    uint32_t loopEnd   = (smpHdr->offEnd  - smpHdr->offStart) / numChans;
-                    
-                    if(!isFileExist(outName)) writeWav(smpHdr, base, outName, 0);
-                    
-                    fprintf(sfzout,
-                        "<region>\n"
-                        "sample=../samples/%s.wav\n"
-                        "lokey=%u hikey=%u\n"
-                        "pitch_keytrack=%i\n"
-                        "transpose=%i\n"
-                        "tune=%i\n"
-                        "pan=%f\n"
-                        "loop_mode=%s\n",
-                        sampleName,
-                        split->rangeStart, split->rangeEnd,
-                        toSfzKeytrack(smpHdr->flags),
-                        toSfzTuneKey(smpHdr->tuning + split->tuning),
-                        toSfzTuneCent(smpHdr->tuning + split->tuning),
-                        toSfzPan(split->pan),
-                        smpHdr->offStart ? "loop_continuous" : "no_loop"
-                    );
-                    
-                    if (smpHdr->offLoop) fprintf(sfzout, "loop_start=%u loop_end=%u\n", loopStart, loopEnd);
-                    
-                    fprintf(sfzout, "ampeg_attack=%f\n",  toSfzEnvelope(smpHdr->lenAttack));
-                    fprintf(sfzout, "ampeg_decay=%f\n",   toSfzEnvelope(smpHdr->lenDecay));
-                    fprintf(sfzout, "ampeg_hold=%f\n",    toSfzEnvelope(smpHdr->volSustain));
-                    fprintf(sfzout, "ampeg_release=%f\n", toSfzEnvelope(smpHdr->lenRelease));
-                    
-                    fprintf(sfzout, "\n");
-                } else {
-                    //good enough
-                    remove(outName);
-                }
-            }
-            if (sfzout) fclose(sfzout);
-        }
-        doWrite++;
+    printf("%-32s %9s %9s %9s %9s %9s %9s\n", "bank", "MB", "start ms", "load ms", "export ms", "total ms", "new wavs");
+    for (int i=0; i < num; i++) {
+        BatchJob* job = &jobs[i];
+        
+        printf("%-32s %9.2f %9.1f %9.1f %9.1f %9.1f %9u%s\n",
+            job->fileName, job->len / 1048576.0,
+            (job->tStart  - t0)           * 1000,
+            (job->tLoaded - job->tStart)  * 1000,
+            (job->tDone   - job->tLoaded) * 1000,
+            (job->tDone   - job->tStart)  * 1000,
+            job->numWritten,
+            job->err ? " FAILED" : ""
+        );
+        totalMB      += job->len / 1048576.0;
+        totalWritten += job->numWritten;
+        if (job->err) numFailed++;
     }
+    printf("%d banks, %.2f MB in %.1f ms, %d threads, %u wavs written, %d failed\n",
+        num, totalMB, (tEnd - t0) * 1000, nThreads > 1 ? nThreads : 1, totalWritten, numFailed);
+    
+    poolDestroy(pool);
+    free(jobs);
+    return numFailed ? 8 : 0;
 }
 
 //-----------------------------------------------
@@ -435,14 +189,33 @@ void dumpSfz(char* name, void* base, size_t len) {
 
 #define ERR(X) {err=X;goto _ERR;};
 int main(int argc, char *argv[]) {
-    uint8_t* buf = 0;
-    size_t buflen;
+    MappedFile bank = {0};
+    wg_PcmCache cache = {0};
+    wg_Bank wb;
+    wg_Pool* pool = NULL;
+    uint8_t* buf;
+    size_t buflen, fileLen, dataOff;
+    char* fileName;
+    char cacheName[MAXPATH];
+    wg_ExportOpts opts = {0};
+    wg_Resampler rs = {0};
+    uint8_t keep[256] = {0};
+    int isKeepSet = 0;
+    int isCache = 0;
+    int isHeadOnly;
+    int nThreads = 1;
+    int nFiles, firstOpt;
     int err;
     
     if( argc < 3 ) {
         printf(
             "usage:\n"
-            "  wgknife -ARG FILENAME\n"
+            "  wgknife -ARG [OPTIONS] FILENAME\n"
+            "  wgknife -render [OPTIONS] FILENAME MIDIFILE OUTWAV\n"
+            "  wgknife -trim -p LIST [OPTIONS] FILENAME OUTFILE\n"
+            "  wgknife -repack [OPTIONS] FILENAME OUTFILE\n"
+            "  wgknife -q QUERY ARG [OPTIONS] FILENAME\n"
+            "  wgknife -batch -sfz|-sd|-sf2|-audition [OPTIONS] FILENAME...\n"
             "arguments:\n"
             "  -d: File description\n"
             "    Verbose description of file format.\n"
@@ -451,29 +224,190 @@ int main(int argc, char *argv[]) {
             "    Dump all samples in a folder named after input.\n"
             "  -sfz: Create SFZ.\n"
             "    Outputs all instruments as SFZ in a folder named after input.\n"
+            "  -sf2: Create SoundFont.\n"
+            "    Whole bank as one SF2 file next to input.\n"
+            "  -render: Render MIDI file.\n"
+            "    Plays a Standard MIDI File through the bank into a 44.1kHz stereo WAV.\n"
+            "  -audition: Render every patch.\n"
+            "    One 22.05kHz WAV per patch in a folder named after input, each key it plays\n"
+            "    held for 0.15s every 0.25s, lowest first. Drum kits play their drum map.\n"
+            "  -json: Structure as JSON.\n"
+            "    Same as -d, raw values and offsets only.\n"
+            "  -q: Query, JSON result.\n"
+            "    patch BANK:PROG or patch INDEX: One patch with splits and sample headers.\n"
+            "    sample-at OFFSET: Every split whose sample data covers file offset.\n"
+            "  -trim: Trim bank.\n"
+            "    Writes a bank with only patches from -p, others become dummies.\n"
+            "  -repack: Repack bank.\n"
+            "    Writes a bank with duplicate samples stored once, most played samples first\n"
+            "    and sample headers next to their patches. -p trims it too.\n"
+            "  -batch: Many banks at once.\n"
+            "    Exports every bank with one thread pool, prints timings at the end.\n"
+            "options:\n"
+            "  -j N: Export/render with N threads, 0 for one per CPU. Default is 1, one per CPU for -batch.\n"
+            "  -n NAMEFILE: Extra sample names, \"OFFSTART OFFEND NAME\" per line.\n"
+            "  -p LIST: Patches to keep, like 0-7,24,128. Drums are 128 and up.\n"
+            "  -store DIR: Export each unique sample once into DIR, wavs become hardlinks to it.\n"
+            "  -rate N: Resample exported wavs to N Hz, 44100 or 48000 say. Bank rate is 22050.\n"
+            "  -flac: Export samples as FLAC instead of wav, loop points included.\n"
+            "  -syncio: Write exported files one blocking call at a time, no io_uring.\n"
+            "  -cache: Keep decoded samples in FILENAME"PCM_CACHE_EXT" for exports and renders to map next time.\n"
+            "    Made on first use, made again whenever the bank changes.\n"
+            "  -interp MODE: Interpolation of -render and -audition, nearest, linear, cubic or sinc.\n"
+            "    Default is linear. Others play decoded samples, they turn on -cache.\n"
         );
         ERR(1);
     }
-    
-    buf = loadfile(argv[2], &buflen);
-    if (!buf) ERR(2);
-    if (!checkWgbankHeader(buf, buflen)) ERR(3);
+
+    nameIndexInit(&smpNameIdx);
+    if (!nameIndexAdd(&smpNameIdx, SMPNAMES)) ERR(2);
     
     #define C(X) (!strcmp(argv[1], X) && strlen(argv[1]) == sizeof(X)-1)
-    if        (C("-sfz")) {
-        dumpSfz(argv[2], buf, buflen);
+    #define O(X) (!strcmp(argv[i], X))
+    nFiles   = C("-render") ? 3 : (C("-trim") || C("-repack") ? 2 : 1);
+    firstOpt = C("-q") ? 4 : (C("-batch") ? 3 : 2);
+    if (C("-batch")) {
+        //files are whatever follows the options
+        int i = firstOpt;
+        
+        while (i < argc && (O("-j") || O("-n") || O("-p") || O("-store") || O("-rate") || O("-flac") || O("-syncio") || O("-cache") || O("-interp"))) i += O("-flac") || O("-syncio") || O("-cache") ? 1 : 2;
+        nFiles   = argc - i;
+        nThreads = poolCpuCount();
+    }
+    if (nFiles < 1 || argc < firstOpt + nFiles) {
+        printf("Missing file name.\n");
+        ERR(1);
+    }
+    for (int i=firstOpt; i < argc-nFiles; i++) {
+        if (O("-j") && i+1 < argc-nFiles) {
+            nThreads = atoi(argv[++i]);
+            if (nThreads <= 0) nThreads = poolCpuCount();
+        } else if (O("-n") && i+1 < argc-nFiles) {
+            if (!nameIndexLoad(&smpNameIdx, argv[++i])) ERR(2);
+        } else if (O("-p") && i+1 < argc-nFiles) {
+            if (!parsePatchList(argv[++i], keep)) ERR(1);
+            isKeepSet = 1;
+        } else if (O("-store") && i+1 < argc-nFiles) {
+            opts.store = argv[++i];
+            if (strlen(opts.store) + PATH_ROOM > MAXPATH) {
+                printf("Store folder name is too long.\n");
+                ERR(1);
+            }
+            makeDir(opts.store);
+        } else if (O("-rate") && i+1 < argc-nFiles) {
+            unsigned long rate = strtoul(argv[++i], NULL, 10);
+            
+            //bank rate needs no work
+            resamplerFree(&rs);
+            if (rate != SAMPLE_RATE && !resamplerInit(&rs, SAMPLE_RATE, rate)) ERR(1);
+            opts.rs = rs.coefs ? &rs : NULL;
+        } else if (O("-flac")) {
+            opts.isFlac = 1;
+        } else if (O("-syncio")) {
+            opts.isSyncIo = 1;
+        } else if (O("-cache")) {
+            isCache = 1;
+        } else if (O("-interp") && i+1 < argc-nFiles) {
+            static const char* modes[WG_MIX_NUM_INTERP] = {"linear", "nearest", "cubic", "sinc"};
+            
+            i++;
+            for (opts.interp=0; opts.interp < WG_MIX_NUM_INTERP && strcmp(argv[i], modes[opts.interp]); opts.interp++);
+            if (opts.interp == WG_MIX_NUM_INTERP) {
+                printf("Unknown interpolation.\n");
+                ERR(1);
+            }
+        } else {
+            printf("Unknown option.\n");
+            ERR(1);
+        }
+    }
+    #undef O
+    //other interpolations only play decoded samples, sinc table is made before threads use it
+    if (opts.interp != WG_MIX_LINEAR) isCache = 1;
+    mixInit();
+    //batch only exports, patch lists are for -trim and -repack
+    if (C("-batch") && isKeepSet) {
+        printf("Batch mode doesn't take -p.\n");
+        ERR(1);
+    }
+    //same cleanup as on error
+    if (C("-batch")) ERR(runBatch(argv[2], &argv[argc-nFiles], nFiles, nThreads, &opts, isCache));
+    fileName = argv[argc-nFiles];
+    
+    //describing and lookups never read sample data, only structures are read in for them
+    //pipes and such can't be read like that, they get the whole file
+    isHeadOnly = C("-d") || C("-json") || C("-q");
+    if (!isHeadOnly || !loadBankHead(fileName, &bank, &fileLen)) {
+        if (!mapfile(fileName, &bank)) ERR(2);
+        fileLen = bank.len;
+    }
+    buf    = bank.base;
+    buflen = bank.len;
+    if (!checkWgbankHeader(buf, fileLen) || !bankOpenPart(&wb, buf, buflen, fileLen)) ERR(3);
+    if (!wb.isValid) printf("Broken bank, %s out of bounds at %08Xh. Skipping what doesn't fit.\n", wb.err, wb.errOff);
+    
+    //structures get walked over and over, sample block is only needed for exports
+    dataOff = buflen;
+    if (!isHeadOnly) dataOff = bankDataOff(&wb);
+    adviseMapping(&bank, 0, dataOff, MAP_ADV_WILLNEED);
+    
+    //decoded samples from last time, or made now for next time
+    if (isCache && (C("-sf2") || C("-sfz") || C("-sd") || C("-render") || C("-audition"))) {
+        sprintf(cacheName, "%.*s"PCM_CACHE_EXT, MAXPATH - 8, fileName);
+        if (pcmCacheLoad(&cache, cacheName, buf, buflen)) opts.pcm = &cache;
+    }
+
+    if        (C("-sf2")) {
+        adviseMapping(&bank, dataOff, buflen - dataOff, MAP_ADV_SEQUENTIAL);
+        if (!dumpSf2(fileName, buf, buflen, &opts)) ERR(6);
+    } else if (C("-sfz")) {
+        adviseMapping(&bank, dataOff, buflen - dataOff, MAP_ADV_WILLNEED);
+        if (!(pool = poolCreate(nThreads))) ERR(5);
+        dumpSfz(fileName, buf, buflen, pool, &opts);
     } else if (C("-sd")) {
-        dumpSamples(argv[2], buf, buflen);
+        adviseMapping(&bank, dataOff, buflen - dataOff, MAP_ADV_WILLNEED);
+        if (!(pool = poolCreate(nThreads))) ERR(5);
+        dumpSamples(fileName, buf, buflen, pool, &opts);
+    } else if (C("-audition")) {
+        adviseMapping(&bank, dataOff, buflen - dataOff, MAP_ADV_WILLNEED);
+        if (!(pool = poolCreate(nThreads))) ERR(5);
+        printf("%u patches rendered.\n", dumpAudition(fileName, buf, buflen, pool, &opts));
     } else if (C("-d")) {
-        if (!describeWgbank(stdout, buf, buflen)) ERR(4);
+        if (!describeWgbank(stdout, buf, buflen, fileLen)) ERR(4);
+    } else if (C("-json")) {
+        if (!describeJson(stdout, buf, buflen, fileLen)) ERR(4);
+    } else if (C("-q")) {
+        if (!runQuery(argv[2], argv[3], buf, buflen, fileLen)) ERR(7);
+    } else if (C("-render")) {
+        //voices jump all over sample block
+        adviseMapping(&bank, dataOff, buflen - dataOff, MAP_ADV_WILLNEED);
+        if (!(pool = poolCreate(nThreads))) ERR(5);
+        if (!renderMidi(buf, buflen, &opts, argv[argc-2], argv[argc-1], pool)) ERR(6);
+    } else if (C("-trim")) {
+        if (!isKeepSet) {
+            printf("Missing patch list.\n");
+            ERR(1);
+        }
+        if (!trimBank(buf, buflen, keep, argv[argc-1])) ERR(6);
+    } else if (C("-repack")) {
+        if (!repackBank(buf, buflen, isKeepSet ? keep : NULL, argv[argc-1])) ERR(6);
     } else {
         printf("Unknown argument.\n");
         ERR(1);
     }
     #undef C
     
+    poolDestroy(pool);
+    pcmCacheClose(&cache);
+    unmapfile(&bank);
+    nameIndexFree(&smpNameIdx);
+    resamplerFree(&rs);
     return 0;
     _ERR:
-        if (buf) free(buf);
+        poolDestroy(pool);
+        pcmCacheClose(&cache);
+        unmapfile(&bank);
+        nameIndexFree(&smpNameIdx);
+        resamplerFree(&rs);
         return err;
 }
\ No newline at end of file